@@ -567,6 +567,9 @@ int do_lock_lv(unsigned char command, unsigned char lock_flags, char *resource)
 
 	cmd->partial_activation = 0;
 
+	/* Don't hold devices open between commands */
+	dev_close_all();
+
 	/* clean the pool for another command */
 	dm_pool_empty(cmd->mem);
 	pthread_mutex_unlock(&lvm_lock);
@@ -656,6 +659,7 @@ int do_refresh_cache(void)
 	init_full_scan_done(0);
 	init_ignore_suspended_devices(1);
 	lvmcache_label_scan(cmd, 2);
+	dev_close_all();
 	dm_pool_empty(cmd->mem);
 
 	pthread_mutex_unlock(&lvm_lock);
@@ -20,11 +20,14 @@
 #include "locking.h"
 #include "metadata.h"
 #include "memlock.h"
+#include "segtype.h"
 #include "str_list.h"
 #include "format-text.h"
 #include "format_pool.h"
 #include "format1.h"
 #include "config.h"
+#include "lvm-file.h"
+#include "crc.h"
 
 #include "lvmetad.h"
 
@@ -56,14 +59,9 @@ struct lvmcache_vginfo {
 	char _padding[7];
 	struct lvmcache_vginfo *next; /* Another VG with same name? */
 	char *creation_host;
-	size_t vgmetadata_size;
-	char *vgmetadata;	/* Copy of VG metadata as format_text string */
-	struct dm_config_tree *cft; /* Config tree created from vgmetadata */
-				    /* Lifetime is directly tied to vgmetadata */
-	struct volume_group *cached_vg;
-	unsigned holders;
-	unsigned vg_use_count;	/* Counter of vg reusage */
-	unsigned precommitted;	/* Is vgmetadata live or precommitted? */
+	struct volume_group *cached_vg;	/* Never handed out, only cloned */
+	uint32_t cached_vg_checksum;	/* _vg_checksum() of cached_vg */
+	unsigned precommitted;	/* Is cached_vg live or precommitted? */
 };
 
 static struct dm_hash_table *_pvid_hash = NULL;
@@ -76,6 +74,24 @@ static int _has_scanned = 0;
 static int _vgs_locked = 0;
 static int _vg_global_lock_held = 0;	/* Global lock held when cache wiped? */
 
+/*
+ * Persistent summary of what was found in each metadata area, so that
+ * a later scan can skip reading and parsing the metadata text when the
+ * mda header on disk is unchanged.  Keyed on "major:minor:mda_start".
+ */
+struct mda_summary_entry {
+	uint32_t mdah_checksum;	/* Covers all raw_locns incl. text checksum */
+	int seen;		/* Found during this scan? */
+	struct mda_summary summary;
+};
+
+static struct {
+	struct dm_pool *mem;
+	struct dm_hash_table *entries;
+	const char *file;
+	int dirty;
+} _mda_summaries;
+
 int lvmcache_init(void)
 {
 	/*
@@ -127,22 +143,169 @@ void lvmcache_seed_infos_from_lvmetad(struct cmd_context *cmd)
 /* Volume Group metadata cache functions */
 static void _free_cached_vgmetadata(struct lvmcache_vginfo *vginfo)
 {
-	if (!vginfo || !vginfo->vgmetadata)
+	if (!vginfo || !vginfo->cached_vg)
 		return;
 
-	dm_free(vginfo->vgmetadata);
+	if (!dm_pool_unlock(vginfo->cached_vg->vgmem,
+			    detect_internal_vg_cache_corruption()))
+		stack;
+
+	release_vg(vginfo->cached_vg);
+	vginfo->cached_vg = NULL;
+
+	log_debug_cache("Metadata cache: VG %s wiped.", vginfo->vgname);
+}
+
+#define _crc_val(crc, v) calc_crc((crc), (const uint8_t *) &(v), sizeof(v))
+
+static uint32_t _crc_str(uint32_t crc, const char *str)
+{
+	return str ? calc_crc(crc, (const uint8_t *) str, strlen(str) + 1) :
+		     _crc_val(crc, str);
+}
+
+static uint32_t _crc_tags(uint32_t crc, const struct dm_list *tags)
+{
+	const struct str_list *sl;
+
+	dm_list_iterate_items(sl, tags)
+		crc = _crc_str(crc, sl->str);
+
+	return _crc_str(crc, NULL);
+}
+
+static uint32_t _crc_areas(uint32_t crc, const struct lv_segment_area *areas,
+			   uint32_t area_count)
+{
+	uint32_t s;
+
+	if (!areas)
+		return crc;
 
-	vginfo->vgmetadata = NULL;
+	for (s = 0; s < area_count; s++) {
+		crc = _crc_val(crc, areas[s].type);
+		if (areas[s].type == AREA_PV) {
+			crc = _crc_val(crc, areas[s].u.pv.pvseg->pv->id);
+			crc = _crc_val(crc, areas[s].u.pv.pvseg->pe);
+		} else if (areas[s].type == AREA_LV) {
+			crc = _crc_str(crc, areas[s].u.lv.lv->name);
+			crc = _crc_val(crc, areas[s].u.lv.le);
+		}
+	}
 
-	/* Release also cached config tree */
-	if (vginfo->cft) {
-		dm_config_destroy(vginfo->cft);
-		vginfo->cft = NULL;
+	return crc;
+}
+
+static uint32_t _crc_lv_name(uint32_t crc, const struct logical_volume *lv)
+{
+	return _crc_str(crc, lv ? lv->name : NULL);
+}
+
+static uint32_t _crc_lv_segment(uint32_t crc, const struct lv_segment *seg)
+{
+	const struct lv_thin_message *tmsg;
+
+	crc = _crc_str(crc, seg->segtype->name);
+	crc = _crc_val(crc, seg->le);
+	crc = _crc_val(crc, seg->len);
+	crc = _crc_val(crc, seg->status);
+	crc = _crc_val(crc, seg->stripe_size);
+	crc = _crc_val(crc, seg->writebehind);
+	crc = _crc_val(crc, seg->min_recovery_rate);
+	crc = _crc_val(crc, seg->max_recovery_rate);
+	crc = _crc_val(crc, seg->area_count);
+	crc = _crc_val(crc, seg->area_len);
+	crc = _crc_val(crc, seg->chunk_size);
+	crc = _crc_val(crc, seg->region_size);
+	crc = _crc_val(crc, seg->extents_copied);
+	crc = _crc_val(crc, seg->transaction_id);
+	crc = _crc_val(crc, seg->low_water_mark);
+	crc = _crc_val(crc, seg->zero_new_blocks);
+	crc = _crc_val(crc, seg->discards);
+	crc = _crc_val(crc, seg->device_id);
+	crc = _crc_lv_name(crc, seg->origin);
+	crc = _crc_lv_name(crc, seg->cow);
+	crc = _crc_lv_name(crc, seg->log_lv);
+	crc = _crc_lv_name(crc, seg->metadata_lv);
+	crc = _crc_lv_name(crc, seg->external_lv);
+	crc = _crc_lv_name(crc, seg->pool_lv);
+	crc = _crc_lv_name(crc, seg->replicator);
+	crc = _crc_lv_name(crc, seg->rlog_lv);
+	crc = _crc_tags(crc, &seg->tags);
+	crc = _crc_areas(crc, seg->areas, seg->area_count);
+	crc = _crc_areas(crc, seg->meta_areas, seg->area_count);
+
+	dm_list_iterate_items(tmsg, &seg->thin_messages) {
+		crc = _crc_val(crc, tmsg->type);
+		if (tmsg->type == DM_THIN_MESSAGE_CREATE_SNAP ||
+		    tmsg->type == DM_THIN_MESSAGE_CREATE_THIN)
+			crc = _crc_lv_name(crc, tmsg->u.lv);
+		else
+			crc = _crc_val(crc, tmsg->u.delete_id);
 	}
 
-	log_debug_cache("Metadata cache: VG %s wiped.", vginfo->vgname);
+	return crc;
+}
 
-	release_vg(vginfo->cached_vg);
+/*
+ * Checksum of the VG fields its metadata text is made from, so a VG
+ * stored again under the same seqno is recognised without exporting it.
+ * Text kept by 'unknown' segments is not covered.
+ */
+static uint32_t _vg_checksum(const struct volume_group *vg)
+{
+	const struct pv_list *pvl;
+	const struct lv_list *lvl;
+	const struct physical_volume *pv;
+	const struct logical_volume *lv;
+	const struct lv_segment *seg;
+	uint32_t crc = INITIAL_CRC;
+
+	crc = _crc_str(crc, vg->name);
+	crc = _crc_val(crc, vg->id);
+	crc = _crc_val(crc, vg->seqno);
+	crc = _crc_val(crc, vg->status);
+	crc = _crc_val(crc, vg->alloc);
+	crc = _crc_val(crc, vg->profile);
+	crc = _crc_val(crc, vg->extent_size);
+	crc = _crc_val(crc, vg->max_lv);
+	crc = _crc_val(crc, vg->max_pv);
+	crc = _crc_val(crc, vg->mda_copies);
+	crc = _crc_str(crc, vg->system_id);
+	crc = _crc_tags(crc, &vg->tags);
+
+	dm_list_iterate_items(pvl, &vg->pvs) {
+		pv = pvl->pv;
+		crc = _crc_val(crc, pv->id);
+		crc = _crc_val(crc, pv->dev);
+		crc = _crc_val(crc, pv->status);
+		crc = _crc_val(crc, pv->size);
+		crc = _crc_val(crc, pv->pe_start);
+		crc = _crc_val(crc, pv->pe_count);
+		crc = _crc_val(crc, pv->ba_start);
+		crc = _crc_val(crc, pv->ba_size);
+		crc = _crc_tags(crc, &pv->tags);
+	}
+
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		lv = lvl->lv;
+		crc = _crc_str(crc, lv->name);
+		crc = _crc_val(crc, lv->lvid);
+		crc = _crc_val(crc, lv->status);
+		crc = _crc_val(crc, lv->alloc);
+		crc = _crc_val(crc, lv->profile);
+		crc = _crc_val(crc, lv->read_ahead);
+		crc = _crc_val(crc, lv->major);
+		crc = _crc_val(crc, lv->minor);
+		crc = _crc_val(crc, lv->timestamp);
+		crc = _crc_str(crc, lv->hostname);
+		crc = _crc_tags(crc, &lv->tags);
+
+		dm_list_iterate_items(seg, &lv->segments)
+			crc = _crc_lv_segment(crc, seg);
+	}
+
+	return crc;
 }
 
 /*
@@ -152,28 +315,34 @@ static void _store_metadata(struct volume_group *vg, unsigned precommitted)
 {
 	char uuid[64] __attribute__((aligned(8)));
 	struct lvmcache_vginfo *vginfo;
-	char *data;
-	size_t size;
+	struct volume_group *cached_vg;
+	uint32_t checksum;
 
 	if (!(vginfo = lvmcache_vginfo_from_vgid((const char *)&vg->id))) {
 		stack;
 		return;
 	}
 
-	if (!(size = export_vg_to_buffer(vg, &data))) {
-		stack;
-		_free_cached_vgmetadata(vginfo);
-		return;
-	}
+	checksum = _vg_checksum(vg);
 
-	/* Avoid reparsing of the same data string */
-	if (vginfo->vgmetadata && vginfo->vgmetadata_size == size &&
-	    strcmp(vginfo->vgmetadata, data) == 0)
-		dm_free(data);
-	else {
+	/* Keep the cached copy if the VG did not change */
+	if (!vginfo->cached_vg || vginfo->cached_vg->seqno != vg->seqno ||
+	    vginfo->cached_vg_checksum != checksum) {
 		_free_cached_vgmetadata(vginfo);
-		vginfo->vgmetadata_size = size;
-		vginfo->vgmetadata = data;
+
+		if (!(cached_vg = vg_clone(vg, vg->fid))) {
+			stack;
+			return;
+		}
+
+		if (!dm_pool_lock(cached_vg->vgmem, detect_internal_vg_cache_corruption())) {
+			stack;
+			release_vg(cached_vg);
+			return;
+		}
+
+		vginfo->cached_vg = cached_vg;
+		vginfo->cached_vg_checksum = checksum;
 	}
 
 	vginfo->precommitted = precommitted;
@@ -183,8 +352,8 @@ static void _store_metadata(struct volume_group *vg, unsigned precommitted)
 		return;
 	}
 
-	log_debug_cache("Metadata cache: VG %s (%s) stored (%" PRIsize_t " bytes%s).",
-			vginfo->vgname, uuid, size,
+	log_debug_cache("Metadata cache: VG %s (%s) stored (seqno %" PRIu32 "%s).",
+			vginfo->vgname, uuid, vg->seqno,
 			precommitted ? ", precommitted" : "");
 }
 
@@ -247,7 +416,7 @@ static void _drop_metadata(const char *vgname, int drop_precommitted)
 	 * already invalidated the PV labels (before caching it)
 	 * and we must not do it again.
 	 */
-	if (!drop_precommitted && vginfo->precommitted && !vginfo->vgmetadata)
+	if (!drop_precommitted && vginfo->precommitted && !vginfo->cached_vg)
 		log_error(INTERNAL_ERROR "metadata commit (or revert) missing before "
 			  "dropping metadata from cache.");
 
@@ -652,6 +821,292 @@ static int _scan_invalid(void)
 	return 1;
 }
 
+static void _mda_summary_key(char *buf, size_t len, const struct device *dev,
+			     uint64_t mda_start)
+{
+	if (dm_snprintf(buf, len, "%d:%d:%" PRIu64, (int) MAJOR(dev->dev),
+			(int) MINOR(dev->dev), mda_start) < 0)
+		*buf = '\0';
+}
+
+static int _mda_summary_insert(const char *key, uint32_t mdah_checksum,
+			       const struct mda_summary *summary, int seen)
+{
+	struct mda_summary_entry *e;
+
+	if (!(e = dm_hash_lookup(_mda_summaries.entries, key))) {
+		if (!(e = dm_pool_zalloc(_mda_summaries.mem, sizeof(*e))) ||
+		    !dm_hash_insert(_mda_summaries.entries, key, e)) {
+			log_error("Failed to add metadata summary for %s.", key);
+			return 0;
+		}
+	}
+
+	e->mdah_checksum = mdah_checksum;
+	e->seen = seen;
+	e->summary = *summary;
+
+	if (!(e->summary.vgname = dm_pool_strdup(_mda_summaries.mem, summary->vgname)) ||
+	    (summary->creation_host &&
+	     !(e->summary.creation_host = dm_pool_strdup(_mda_summaries.mem,
+							 summary->creation_host)))) {
+		log_error("Failed to copy metadata summary for %s.", key);
+		dm_hash_remove(_mda_summaries.entries, key);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void _mda_summary_load(struct cmd_context *cmd)
+{
+	struct dm_config_tree *cft;
+	const struct dm_config_node *cn;
+	struct mda_summary summary;
+	const char *key, *vgid;
+	uint64_t checksum;
+	struct stat info;
+
+	if (_mda_summaries.entries || !cmd->mda_summary_file)
+		return;
+
+	if (!(_mda_summaries.mem = dm_pool_create("mda_summaries", 4096)) ||
+	    !(_mda_summaries.entries = dm_hash_create(128))) {
+		log_error("Failed to create metadata summary cache.");
+		if (_mda_summaries.mem)
+			dm_pool_destroy(_mda_summaries.mem);
+		_mda_summaries.mem = NULL;
+		return;
+	}
+
+	_mda_summaries.file = cmd->mda_summary_file;
+	_mda_summaries.dirty = 0;
+
+	if (stat(_mda_summaries.file, &info))
+		return;
+
+	if (!(cft = config_open(CONFIG_FILE, _mda_summaries.file, 1))) {
+		stack;
+		return;
+	}
+
+	if (!config_file_read(cft) ||
+	    !(cn = dm_config_find_node(cft->root, "mda_summary_cache"))) {
+		log_very_verbose("Ignoring invalid metadata summary cache %s.",
+				 _mda_summaries.file);
+		goto out;
+	}
+
+	for (cn = cn->child; cn; cn = cn->sib) {
+		memset(&summary, 0, sizeof(summary));
+		if (!dm_config_get_str(cn, "key", &key) ||
+		    !dm_config_get_uint64(cn, "checksum", &checksum) ||
+		    !dm_config_get_str(cn, "vgname", &summary.vgname) ||
+		    !dm_config_get_str(cn, "vgid", &vgid) ||
+		    strlen(vgid) != ID_LEN ||
+		    !dm_config_get_uint64(cn, "status", &summary.vgstatus) ||
+		    !dm_config_get_uint64(cn, "free_sectors", &summary.free_sectors)) {
+			log_very_verbose("Ignoring incomplete entry %s in %s.",
+					 cn->key, _mda_summaries.file);
+			continue;
+		}
+		memcpy(&summary.vgid, vgid, ID_LEN);
+		(void) dm_config_get_str(cn, "creation_host",
+					 (const char **) &summary.creation_host);
+		if (!_mda_summary_insert(key, (uint32_t) checksum, &summary, 0))
+			break;
+	}
+
+	log_very_verbose("Loaded metadata summaries from %s.", _mda_summaries.file);
+out:
+	config_destroy(cft);
+}
+
+static void _mda_summary_save(struct cmd_context *cmd)
+{
+	struct dm_hash_node *n;
+	struct mda_summary_entry *e;
+	char vgid[ID_LEN + 1];
+	char buf[2 * PATH_MAX];
+	char *tmp_file;
+	unsigned i = 0;
+	FILE *fp;
+	int lockfd;
+
+	if (!_mda_summaries.entries || !_mda_summaries.dirty || !cmd->dump_filter)
+		return;
+
+	if ((lockfd = fcntl_lock_file(_mda_summaries.file, F_WRLCK, 0)) < 0) {
+		stack;
+		return;
+	}
+
+	tmp_file = alloca(strlen(_mda_summaries.file) + 5);
+	sprintf(tmp_file, "%s.tmp", _mda_summaries.file);
+
+	if (!(fp = fopen(tmp_file, "w"))) {
+		if (errno != EROFS && errno != EACCES)
+			log_sys_error("fopen", tmp_file);
+		goto out;
+	}
+
+	fprintf(fp, "# This file is automatically maintained by lvm.\n\n");
+	fprintf(fp, "mda_summary_cache {\n");
+
+	/* Only keep what the last scan saw: anything else is stale. */
+	dm_hash_iterate(n, _mda_summaries.entries) {
+		e = dm_hash_get_data(_mda_summaries.entries, n);
+		if (!e->seen)
+			continue;
+		memcpy(vgid, &e->summary.vgid, ID_LEN);
+		vgid[ID_LEN] = '\0';
+		fprintf(fp, "\tmda%u {\n", i++);
+		fprintf(fp, "\t\tkey = \"%s\"\n", dm_hash_get_key(_mda_summaries.entries, n));
+		fprintf(fp, "\t\tchecksum = %" PRIu32 "\n", e->mdah_checksum);
+		dm_escape_double_quotes(buf, e->summary.vgname);
+		fprintf(fp, "\t\tvgname = \"%s\"\n", buf);
+		fprintf(fp, "\t\tvgid = \"%s\"\n", vgid);
+		fprintf(fp, "\t\tstatus = %" PRIu64 "\n", e->summary.vgstatus);
+		if (e->summary.creation_host) {
+			dm_escape_double_quotes(buf, e->summary.creation_host);
+			fprintf(fp, "\t\tcreation_host = \"%s\"\n", buf);
+		}
+		fprintf(fp, "\t\tfree_sectors = %" PRIu64 "\n", e->summary.free_sectors);
+		fprintf(fp, "\t}\n");
+	}
+
+	fprintf(fp, "}\n");
+	if (lvm_fclose(fp, tmp_file))
+		goto_out;
+
+	if (rename(tmp_file, _mda_summaries.file))
+		log_error("%s: rename to %s failed: %s", tmp_file,
+			  _mda_summaries.file, strerror(errno));
+	else
+		_mda_summaries.dirty = 0;
+out:
+	fcntl_unlock_file(lockfd);
+}
+
+static void _mda_summary_destroy(void)
+{
+	if (_mda_summaries.entries)
+		dm_hash_destroy(_mda_summaries.entries);
+	if (_mda_summaries.mem)
+		dm_pool_destroy(_mda_summaries.mem);
+	memset(&_mda_summaries, 0, sizeof(_mda_summaries));
+}
+
+int lvmcache_find_mda_summary(const struct device *dev, uint64_t mda_start,
+			      uint32_t mdah_checksum, struct mda_summary *summary)
+{
+	struct mda_summary_entry *e;
+	char key[64];
+
+	if (!_mda_summaries.entries)
+		return 0;
+
+	_mda_summary_key(key, sizeof(key), dev, mda_start);
+
+	if (!(e = dm_hash_lookup(_mda_summaries.entries, key)))
+		return 0;
+
+	if (e->mdah_checksum != mdah_checksum) {
+		log_debug_metadata("%s: Metadata area at %" PRIu64 " changed "
+				   "since it was last summarised.",
+				   dev_name(dev), mda_start);
+		return 0;
+	}
+
+	log_debug_metadata("%s: Using summary of unchanged metadata area at %"
+			   PRIu64 " for %s.", dev_name(dev), mda_start,
+			   e->summary.vgname);
+	e->seen = 1;
+	*summary = e->summary;
+
+	return 1;
+}
+
+void lvmcache_add_mda_summary(const struct device *dev, uint64_t mda_start,
+			      uint32_t mdah_checksum,
+			      const struct mda_summary *summary)
+{
+	char key[64];
+
+	if (!_mda_summaries.entries)
+		return;
+
+	_mda_summary_key(key, sizeof(key), dev, mda_start);
+
+	if (_mda_summary_insert(key, mdah_checksum, summary, 1))
+		_mda_summaries.dirty = 1;
+}
+
+/*
+ * Is udev's record of the device only good enough to put it at the
+ * back of the queue?  The record may be stale (an event still queued
+ * or --noudevsync just after pvcreate), so such devices are read last
+ * rather than skipped.
+ */
+static int _read_later(struct cmd_context *cmd, struct device *dev)
+{
+	if (!cmd->udev_device_info || (dev->flags & DEV_REGULAR) ||
+	    dev_udev_classify(cmd->dev_types, dev) != UDEV_DEV_OTHER)
+		return 0;
+
+	log_debug_devs("%s: udev reports a non-LVM signature: "
+		       "reading label last", dev_name(dev));
+
+	return 1;
+}
+
+static void _scan_dev(struct device **devs, unsigned *count, struct device *dev)
+{
+	devs[(*count)++] = dev;
+
+	if (*count == LABEL_SCAN_BATCH) {
+		(void) label_read_batch(devs, *count);
+		*count = 0;
+	}
+}
+
+/*
+ * Hand the devices to label_read_batch in groups small enough
+ * to stay well clear of the open file descriptor limit.
+ */
+static void _label_scan_batched(struct cmd_context *cmd, struct dev_iter *iter)
+{
+	struct device *devs[LABEL_SCAN_BATCH];
+	struct device **later = NULL, **grown;
+	struct device *dev;
+	unsigned count = 0, later_count = 0, later_size = 0, size, i;
+
+	while ((dev = dev_iter_get(iter))) {
+		if (_read_later(cmd, dev)) {
+			if (later_count == later_size) {
+				size = later_size ? later_size * 2 : LABEL_SCAN_BATCH;
+				if ((grown = dm_realloc(later, sizeof(*later) * size))) {
+					later = grown;
+					later_size = size;
+				}
+			}
+			/* Without memory for the list, read it straight away */
+			if (later_count < later_size) {
+				later[later_count++] = dev;
+				continue;
+			}
+		}
+		_scan_dev(devs, &count, dev);
+	}
+
+	for (i = 0; i < later_count; i++)
+		_scan_dev(devs, &count, later[i]);
+
+	(void) label_read_batch(devs, count);
+
+	dm_free(later);
+}
+
 int lvmcache_label_scan(struct cmd_context *cmd, int full_scan)
 {
 	struct label *label;
@@ -688,11 +1143,18 @@ int lvmcache_label_scan(struct cmd_context *cmd, int full_scan)
 		goto out;
 	}
 
-	while ((dev = dev_iter_get(iter)))
-		(void) label_read(dev, &label, UINT64_C(0));
+	_mda_summary_load(cmd);
+
+	if (find_config_tree_bool(cmd, devices_async_label_scan_CFG, NULL))
+		_label_scan_batched(cmd, iter);
+	else
+		while ((dev = dev_iter_get(iter)))
+			(void) label_read(dev, &label, UINT64_C(0));
 
 	dev_iter_destroy(iter);
 
+	_mda_summary_save(cmd);
+
 	_has_scanned = 1;
 
 	/* Perform any format-specific scanning e.g. text files */
@@ -722,7 +1184,7 @@ struct volume_group *lvmcache_get_vg(struct cmd_context *cmd, const char *vgname
 				     const char *vgid, unsigned precommitted)
 {
 	struct lvmcache_vginfo *vginfo;
-	struct volume_group *vg = NULL;
+	struct volume_group *vg;
 	struct format_instance *fid;
 	struct format_instance_ctx fic;
 
@@ -735,12 +1197,12 @@ struct volume_group *lvmcache_get_vg(struct cmd_context *cmd, const char *vgname
 	if (lvmetad_active() && !precommitted) {
 		/* Still serve the locally cached VG if available */
 		if (vgid && (vginfo = lvmcache_vginfo_from_vgid(vgid)) &&
-		    vginfo->vgmetadata && (vg = vginfo->cached_vg))
+		    vginfo->cached_vg)
 			goto out;
 		return lvmetad_vg_lookup(cmd, vgname, vgid);
 	}
 
-	if (!vgid || !(vginfo = lvmcache_vginfo_from_vgid(vgid)) || !vginfo->vgmetadata)
+	if (!vgid || !(vginfo = lvmcache_vginfo_from_vgid(vgid)) || !vginfo->cached_vg)
 		return NULL;
 
 	if (!_vginfo_is_valid(vginfo))
@@ -762,73 +1224,25 @@ struct volume_group *lvmcache_get_vg(struct cmd_context *cmd, const char *vgname
 	    (!precommitted && vginfo->precommitted && !critical_section()))
 		return NULL;
 
-	/* Use already-cached VG struct when available */
-	if ((vg = vginfo->cached_vg))
-		goto out;
-
+out:
 	fic.type = FMT_INSTANCE_MDAS | FMT_INSTANCE_AUX_MDAS;
 	fic.context.vg_ref.vg_name = vginfo->vgname;
 	fic.context.vg_ref.vg_id = vgid;
 	if (!(fid = vginfo->fmt->ops->create_instance(vginfo->fmt, &fic)))
 		return_NULL;
 
-	/* Build config tree from vgmetadata, if not yet cached */
-	if (!vginfo->cft &&
-	    !(vginfo->cft =
-	      dm_config_from_string(vginfo->vgmetadata)))
-		goto_bad;
-
-	if (!(vg = import_vg_from_config_tree(vginfo->cft, fid)))
-		goto_bad;
-
-	/* Cache VG struct for reuse */
-	vginfo->cached_vg = vg;
-	vginfo->holders = 1;
-	vginfo->vg_use_count = 0;
-	vg->vginfo = vginfo;
-
-	if (!dm_pool_lock(vg->vgmem, detect_internal_vg_cache_corruption()))
-		goto_bad;
+	/* Every caller gets its own copy of the cached VG */
+	if (!(vg = vg_clone(vginfo->cached_vg, fid))) {
+		fid->fmt->ops->destroy_instance(fid);
+		return_NULL;
+	}
 
-out:
-	vginfo->holders++;
-	vginfo->vg_use_count++;
-	log_debug_cache("Using cached %smetadata for VG %s with %u holder(s).",
+	log_debug_cache("Using cached %smetadata for VG %s.",
 			vginfo->precommitted ? "pre-committed " : "",
-			vginfo->vgname, vginfo->holders);
+			vginfo->vgname);
 
 	return vg;
-
-bad:
-	_free_cached_vgmetadata(vginfo);
-	return NULL;
-}
-
-// #if 0
-int lvmcache_vginfo_holders_dec_and_test_for_zero(struct lvmcache_vginfo *vginfo)
-{
-	log_debug_cache("VG %s decrementing %d holder(s) at %p.",
-			vginfo->cached_vg->name, vginfo->holders, vginfo->cached_vg);
-
-	if (--vginfo->holders)
-		return 0;
-
-	if (vginfo->vg_use_count > 1)
-		log_debug_cache("VG %s reused %d times.",
-				vginfo->cached_vg->name, vginfo->vg_use_count);
-
-	/* Debug perform crc check only when it's been used more then once */
-	if (!dm_pool_unlock(vginfo->cached_vg->vgmem,
-			    detect_internal_vg_cache_corruption() &&
-			    (vginfo->vg_use_count > 1)))
-		stack;
-
-	vginfo->cached_vg->vginfo = NULL;
-	vginfo->cached_vg = NULL;
-
-	return 1;
 }
-// #endif
 
 struct dm_list *lvmcache_get_vgids(struct cmd_context *cmd,
 				   int include_internal)
@@ -1635,9 +2049,11 @@ void lvmcache_destroy(struct cmd_context *cmd, int retain_orphans)
 		log_error(INTERNAL_ERROR "_vginfos list should be empty");
 	dm_list_init(&_vginfos);
 
-	if (retain_orphans)
+	if (retain_orphans) {
 		if (!init_lvmcache_orphans(cmd))
 			stack;
+	} else
+		_mda_summary_destroy();
 }
 
 int lvmcache_pvid_is_locked(const char *pvid) {
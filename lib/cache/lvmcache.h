@@ -39,6 +39,15 @@ struct disk_locn;
 
 struct lvmcache_vginfo;
 
+/* What a scan learns from one metadata area */
+struct mda_summary {
+	const char *vgname;
+	struct id vgid;
+	uint64_t vgstatus;
+	char *creation_host;
+	uint64_t free_sectors;
+};
+
 int lvmcache_init(void);
 void lvmcache_allow_reads_with_lvmetad(void);
 
@@ -62,6 +71,13 @@ int lvmcache_update_vgname_and_id(struct lvmcache_info *info,
 				  uint32_t vgstatus, const char *hostname);
 int lvmcache_update_vg(struct volume_group *vg, unsigned precommitted);
 
+/* Persistent per-mda summaries valid while the mda header is unchanged */
+int lvmcache_find_mda_summary(const struct device *dev, uint64_t mda_start,
+			      uint32_t mdah_checksum, struct mda_summary *summary);
+void lvmcache_add_mda_summary(const struct device *dev, uint64_t mda_start,
+			      uint32_t mdah_checksum,
+			      const struct mda_summary *summary);
+
 void lvmcache_lock_vgname(const char *vgname, int read_only);
 void lvmcache_unlock_vgname(const char *vgname);
 int lvmcache_verify_lock_order(const char *vgname);
@@ -69,9 +85,6 @@ int lvmcache_verify_lock_order(const char *vgname);
 /* Queries */
 const struct format_type *lvmcache_fmt_from_vgname(struct cmd_context *cmd, const char *vgname, const char *vgid, unsigned revalidate_labels);
 
-/* Decrement and test if there are still vg holders in vginfo. */
-int lvmcache_vginfo_holders_dec_and_test_for_zero(struct lvmcache_vginfo *vginfo);
-
 struct lvmcache_vginfo *lvmcache_vginfo_from_vgname(const char *vgname,
 					   const char *vgid);
 struct lvmcache_vginfo *lvmcache_vginfo_from_vgid(const char *vgid);
@@ -428,6 +428,8 @@ static int _process_config(struct cmd_context *cmd)
 	init_detect_internal_vg_cache_corruption
 		(find_config_tree_bool(cmd, global_detect_internal_vg_cache_corruption_CFG, NULL));
 
+	init_full_vg_validation(find_config_tree_bool(cmd, global_full_vg_validation_CFG, NULL));
+
 	lvmetad_disconnect();
 
 	lvmetad_socket = getenv("LVM_LVMETAD_SOCKET");
@@ -734,6 +736,9 @@ static int _init_dev_cache(struct cmd_context *cmd)
 	init_dev_disable_after_error_count(
 		find_config_tree_int(cmd, devices_disable_after_error_count_CFG, NULL));
 
+	init_dev_block_cache_size(
+		find_config_tree_int(cmd, devices_block_cache_size_CFG, NULL));
+
 	if (!dev_cache_init(cmd))
 		return_0;
 
@@ -817,11 +822,11 @@ static int _init_dev_cache(struct cmd_context *cmd)
 	return 1;
 }
 
-#define MAX_FILTERS 6
+#define MAX_FILTERS 7
 
 static struct dev_filter *_init_filter_components(struct cmd_context *cmd)
 {
-	int nr_filt = 0;
+	int nr_filt = 0, nr_pinned;
 	const struct dm_config_node *cn;
 	struct dev_filter *filters[MAX_FILTERS] = { 0 };
 	struct dev_filter *composite;
@@ -832,10 +837,24 @@ static struct dev_filter *_init_filter_components(struct cmd_context *cmd)
 	 * Update MAX_FILTERS definition above when adding new filters.
 	 */
 
+	/*
+	 * udev filter. Optional, non-critical.
+	 * Listed first because it does no I/O at all.
+	 */
+	cmd->udev_device_info = 0;
+	if (find_config_tree_bool(cmd, devices_obtain_device_info_from_udev_CFG, NULL) &&
+	    !_check_disable_udev("read all devices to classify them") &&
+	    udev_is_running()) {
+		if ((filters[nr_filt] = udev_filter_create(cmd->dev_types,
+				find_config_tree_bool(cmd, devices_multipath_component_detection_CFG, NULL)))) {
+			cmd->udev_device_info = 1;
+			nr_filt++;
+		}
+	}
+
 	/*
 	 * sysfs filter. Only available on 2.6 kernels.  Non-critical.
-	 * Listed first because it's very efficient at eliminating
-	 * unavailable devices.
+	 * Very efficient at eliminating unavailable devices.
 	 */
 	if (find_config_tree_bool(cmd, devices_sysfs_scan_CFG, NULL)) {
 		if ((filters[nr_filt] = sysfs_filter_create()))
@@ -859,6 +878,9 @@ static struct dev_filter *_init_filter_components(struct cmd_context *cmd)
 	}
 	nr_filt++;
 
+	/* Filters above never open the device: keep them first. */
+	nr_pinned = nr_filt;
+
 	/* mpath component filter. Optional, non-critical. */
 	if (find_config_tree_bool(cmd, devices_multipath_component_detection_CFG, NULL)) {
 		if ((filters[nr_filt] = mpath_filter_create(cmd->dev_types)))
@@ -879,7 +901,7 @@ static struct dev_filter *_init_filter_components(struct cmd_context *cmd)
 			nr_filt++;
 	}
 
-	if (!(composite = composite_filter_create(nr_filt, filters)))
+	if (!(composite = composite_filter_create(nr_filt, nr_pinned, 1, filters)))
 		goto_bad;
 
 	return composite;
@@ -946,6 +968,14 @@ static int _init_filters(struct cmd_context *cmd, unsigned load_persistent_cache
 	if (!*cmd->system_dir)
 		cmd->dump_filter = 0;
 
+	/* The metadata summaries live alongside the filter cache */
+	cmd->mda_summary_file = NULL;
+	if (find_config_tree_bool(cmd, devices_metadata_summary_cache_CFG, NULL) &&
+	    !(cmd->mda_summary_file = dm_pool_alloc(cmd->libmem, strlen(dev_cache) + 5)))
+		log_verbose("Failed to allocate metadata summary cache filename.");
+	else if (cmd->mda_summary_file)
+		sprintf((char *) cmd->mda_summary_file, "%s.mda", dev_cache);
+
 	/*
 	 * Only load persistent filter device cache on startup if it is newer
 	 * than the config file and this is not a long-lived process. Also avoid
@@ -966,7 +996,7 @@ static int _init_filters(struct cmd_context *cmd, unsigned load_persistent_cache
 	else {
 		toplevel_components[0] = cmd->lvmetad_filter;
 		toplevel_components[1] = f4;
-		if (!(cmd->filter = composite_filter_create(2, toplevel_components)))
+		if (!(cmd->filter = composite_filter_create(2, 2, 0, toplevel_components)))
 			goto_bad;
 	}
 
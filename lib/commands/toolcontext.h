@@ -91,6 +91,7 @@ struct cmd_context {
 	unsigned si_unit_consistency:1;
 	unsigned metadata_read_only:1;
 	unsigned threaded:1;		/* Set if running within a thread e.g. clvmd */
+	unsigned udev_device_info:1;	/* Trust udev db to classify devices */
 
 	unsigned independent_metadata_areas:1;	/* Active formats have MDAs outside PVs */
 
@@ -98,6 +99,7 @@ struct cmd_context {
 	struct dev_filter *filter;
 	struct dev_filter *lvmetad_filter;
 	int dump_filter;	/* Dump filter when exiting? */
+	const char *mda_summary_file;	/* NULL unless devices/metadata_summary_cache */
 
 	struct dm_list config_files; /* master lvm config + any existing tag configs */
 	struct profile_params *profile_params; /* profile handling params including loaded profile configs */
@@ -22,6 +22,7 @@
 #include "str_list.h"
 #include "toolcontext.h"
 #include "lvm-file.h"
+#include "lvm-compress.h"
 #include "memlock.h"
 
 #include <sys/stat.h>
@@ -362,11 +363,14 @@ int override_config_tree_from_profile(struct cmd_context *cmd,
 	return 1;
 }
 
-int config_file_read_fd(struct dm_config_tree *cft, struct device *dev,
-			off_t offset, size_t size, off_t offset2, size_t size2,
-			checksum_fn_t checksum_fn, uint32_t checksum)
+int config_file_read_fd_sections(struct dm_config_tree *cft, struct device *dev,
+				 off_t offset, size_t size, off_t offset2, size_t size2,
+				 checksum_fn_t checksum_fn, uint32_t checksum,
+				 unsigned compressed, config_text_fn text_fn,
+				 dm_config_section_fn section_fn, void *baton)
 {
-	char *fb, *fe;
+	char *fb, *fe, *text;
+	size_t text_size;
 	int r = 0;
 	int use_mmap = 1;
 	off_t mmap_offset = 0;
@@ -374,7 +378,7 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev,
 	struct config_source *cs = dm_config_get_custom(cft);
 
 	if ((cs->type != CONFIG_FILE) && (cs->type != CONFIG_PROFILE)) {
-		log_error(INTERNAL_ERROR "config_file_read_fd: expected file or profile config source, "
+		log_error(INTERNAL_ERROR "config_file_read_fd_sections: expected file or profile config source, "
 					 "found %s config source.", _config_source_names[cs->type]);
 		return 0;
 	}
@@ -394,7 +398,8 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev,
 		}
 		fb = fb + mmap_offset;
 	} else {
-		if (!(buf = dm_malloc(size + size2))) {
+		/* The tree is parsed in place so it owns the buffer */
+		if (!(buf = dm_pool_alloc(dm_config_memory(cft), size + size2))) {
 			log_error("Failed to allocate circular buffer.");
 			return 0;
 		}
@@ -413,15 +418,35 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev,
 	}
 
 	fe = fb + size + size2;
-	if (!dm_config_parse(cft, fb, fe))
+	if (compressed) {
+		/* The uncompressed copy is allocated from the tree's pool too */
+		if (!uncompress_metadata(dm_config_memory(cft), fb, size + size2,
+					 &text, &text_size))
+			goto_out;
+	} else if (use_mmap) {
+		if (!dm_config_parse(cft, fb, fe))
+			goto_out;
+		r = 1;
+		goto out;
+	} else {
+		text = fb;
+		text_size = size + size2;
+	}
+
+	if (section_fn && text_fn && !text_fn(text, text + text_size, baton))
+		section_fn = NULL;
+
+	if (!dm_config_parse_sections(cft, text, text + text_size,
+				      section_fn, baton))
 		goto_out;
 
 	r = 1;
 
       out:
-	if (!use_mmap)
-		dm_free(buf);
-	else {
+	if (!use_mmap) {
+		if (!r)
+			dm_pool_free(dm_config_memory(cft), buf);
+	} else {
 		/* unmap the file */
 		if (munmap(fb - mmap_offset, size + mmap_offset)) {
 			log_sys_error("munmap", dev_name(dev));
@@ -432,6 +457,14 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev,
 	return r;
 }
 
+int config_file_read_fd(struct dm_config_tree *cft, struct device *dev,
+			off_t offset, size_t size, off_t offset2, size_t size2,
+			checksum_fn_t checksum_fn, uint32_t checksum)
+{
+	return config_file_read_fd_sections(cft, dev, offset, size, offset2, size2,
+					    checksum_fn, checksum, 0, NULL, NULL, NULL);
+}
+
 int config_file_read(struct dm_config_tree *cft)
 {
 	const char *filename = NULL;
@@ -161,6 +161,18 @@ struct dm_config_tree *config_open(config_source_t source, const char *filename,
 int config_file_read_fd(struct dm_config_tree *cft, struct device *dev,
 			off_t offset, size_t size, off_t offset2, size_t size2,
 			checksum_fn_t checksum_fn, uint32_t checksum);
+/*
+ * Offers sections to section_fn as they are parsed unless the file is mmapped.
+ * If text_fn is set, it sees the whole text first and section_fn is only
+ * used if it returns 1.
+ * Compressed data is checksummed as stored and uncompressed before parsing.
+ */
+typedef int (*config_text_fn) (const char *start, const char *end, void *baton);
+int config_file_read_fd_sections(struct dm_config_tree *cft, struct device *dev,
+				 off_t offset, size_t size, off_t offset2, size_t size2,
+				 checksum_fn_t checksum_fn, uint32_t checksum,
+				 unsigned compressed, config_text_fn text_fn,
+				 dm_config_section_fn section_fn, void *baton);
 int config_file_read(struct dm_config_tree *cft);
 struct dm_config_tree *config_file_open_and_read(const char *config_file, config_source_t source);
 int config_write(struct dm_config_tree *cft,
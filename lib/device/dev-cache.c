@@ -18,6 +18,7 @@
 #include "btree.h"
 #include "config.h"
 #include "toolcontext.h"
+#include "dev-type.h"
 
 #include <unistd.h>
 #include <sys/param.h>
@@ -38,9 +39,13 @@ static struct {
 	struct dm_hash_table *names;
 	struct btree *devices;
 	struct dm_regex *preferred_names_matcher;
+	struct dev_types *dev_types;
 	const char *dev_dir;
 
 	int has_scanned;
+	int from_sysfs;		/* Enumerate devices from sysfs */
+	int names_scanned;	/* Scan directories walked since enumeration */
+	int links_scanned;	/* <dev_dir>/disk links added since enumeration */
 	struct dm_list dirs;
 	struct dm_list files;
 
@@ -62,6 +67,7 @@ static void _dev_init(struct device *dev, int max_error_count)
 
 	dm_list_init(&dev->aliases);
 	dm_list_init(&dev->open_list);
+	dm_list_init(&dev->cached_blocks);
 }
 
 struct device *dev_create_file(const char *filename, struct device *dev,
@@ -634,6 +640,259 @@ static int _insert(const char *path, int rec, int check_with_udev_db)
 	return r;
 }
 
+/*
+ * Build the list of devices from the kernel's own list in sysfs.
+ * Only the device numbers are recorded here: the names are looked up
+ * by _resolve_names() once a device is actually going to be used.
+ */
+static int _insert_sysfs_devs(void)
+{
+	const char *sysfs_dir = dm_sysfs_dir();
+	char path[PATH_MAX];
+	struct dirent *dirent;
+	struct device *dev;
+	unsigned major, minor;
+	dev_t d;
+	DIR *dr;
+	int r = 1;
+
+	if (!sysfs_dir || !*sysfs_dir)
+		return 0;
+
+	if (dm_snprintf(path, sizeof(path), "%s/dev/block", sysfs_dir) < 0) {
+		log_error("sysfs block device directory path too long.");
+		return 0;
+	}
+
+	if (!(dr = opendir(path))) {
+		log_sys_very_verbose("opendir", path);
+		return 0;
+	}
+
+	while ((dirent = readdir(dr))) {
+		if (sscanf(dirent->d_name, "%u:%u", &major, &minor) != 2)
+			continue;
+
+		d = MKDEV((dev_t)major, minor);
+		if (btree_lookup(_cache.devices, (uint32_t) d))
+			continue;
+
+		if (!(dev = _dev_create(d))) {
+			r = 0;
+			break;
+		}
+
+		dev->flags |= DEV_NAMES_PENDING;
+
+		if (!btree_insert(_cache.devices, (uint32_t) d, dev)) {
+			log_error("Couldn't insert device into binary tree.");
+			_free(dev);
+			r = 0;
+			break;
+		}
+	}
+
+	if (closedir(dr))
+		log_sys_error("closedir", path);
+
+	return r;
+}
+
+/* Is path inside one of the directories we were told to scan? */
+static int _in_scan_dirs(const char *path)
+{
+	struct dir_list *dl;
+	size_t len;
+
+	dm_list_iterate_items(dl, &_cache.dirs) {
+		len = strlen(dl->dir);
+		if (!strncmp(path, dl->dir, len) &&
+		    (path[len] == '/' || (len && dl->dir[len - 1] == '/')))
+			return 1;
+	}
+
+	return 0;
+}
+
+static void _insert_name_if_same_dev(struct device *dev, const char *path)
+{
+	struct stat info;
+
+	if (!_in_scan_dirs(path))
+		return;
+
+	if (stat(path, &info) < 0 || !S_ISBLK(info.st_mode) ||
+	    info.st_rdev != dev->dev)
+		return;
+
+	if (!_insert_dev(path, info.st_rdev))
+		stack;
+}
+
+/*
+ * Without udev, guess the names from the kernel's name for the device
+ * and its device-mapper name.  Returns 0 if nothing matched.
+ */
+static int _insert_sysfs_names(struct device *dev)
+{
+	const char *sysfs_dir = dm_sysfs_dir();
+	char sysfs_path[PATH_MAX], target[PATH_MAX], name[PATH_MAX];
+	char path[PATH_MAX];
+	struct dir_list *dl;
+	const char *kname;
+	char *p;
+	ssize_t len;
+	FILE *fp;
+
+	if (dm_snprintf(sysfs_path, sizeof(sysfs_path), "%s/dev/block/%d:%d",
+			sysfs_dir, (int) MAJOR(dev->dev), (int) MINOR(dev->dev)) < 0)
+		return_0;
+
+	if ((len = readlink(sysfs_path, target, sizeof(target) - 1)) < 0) {
+		log_sys_very_verbose("readlink", sysfs_path);
+		return 0;
+	}
+	target[len] = '\0';
+
+	/* Kernel names use '!' for '/', e.g. cciss!c0d0 */
+	kname = (p = strrchr(target, '/')) ? p + 1 : target;
+	for (p = target; *p; p++)
+		if (*p == '!')
+			*p = '/';
+
+	dm_list_iterate_items(dl, &_cache.dirs)
+		if (dm_snprintf(path, sizeof(path), "%s/%s", dl->dir, kname) >= 0) {
+			_collapse_slashes(path);
+			_insert_name_if_same_dev(dev, path);
+		}
+
+	if (dm_snprintf(sysfs_path, sizeof(sysfs_path), "%s/dev/block/%d:%d/dm/name",
+			sysfs_dir, (int) MAJOR(dev->dev), (int) MINOR(dev->dev)) >= 0 &&
+	    (fp = fopen(sysfs_path, "r"))) {
+		if (fgets(name, sizeof(name), fp) &&
+		    (p = strchr(name, '\n'))) {
+			*p = '\0';
+			if (dm_snprintf(path, sizeof(path), "%s/%s", dm_dir(), name) >= 0)
+				_insert_name_if_same_dev(dev, path);
+		}
+		if (fclose(fp))
+			log_sys_debug("fclose", sysfs_path);
+	}
+
+	return !dm_list_empty(&dev->aliases);
+}
+
+#ifdef UDEV_SYNC_SUPPORT
+static int _insert_udev_names(struct device *dev)
+{
+	struct udev *udev;
+	struct udev_device *device;
+	struct udev_list_entry *symlink_entry;
+	const char *name;
+
+	if (!(udev = udev_get_library_context()) ||
+	    !(device = udev_device_new_from_devnum(udev, 'b', dev->dev)))
+		return 0;
+
+	if ((name = udev_device_get_devnode(device)))
+		(void) _insert(name, 0, 0);
+
+	udev_list_entry_foreach(symlink_entry, udev_device_get_devlinks_list_entry(device))
+		if ((name = udev_list_entry_get_name(symlink_entry)))
+			(void) _insert(name, 0, 0);
+
+	udev_device_unref(device);
+
+	return !dm_list_empty(&dev->aliases);
+}
+#endif
+
+/*
+ * The persistent names in <dev_dir>/disk/by-id, by-path, by-uuid etc.
+ * can't be guessed from sysfs.  Add every link there that points at a
+ * device already listed, so filters written against them still match.
+ */
+static void _insert_disk_links(void)
+{
+	char path[PATH_MAX], subdir[PATH_MAX], link[PATH_MAX];
+	struct dirent *sub, *ent;
+	struct stat info;
+	DIR *d, *sd;
+
+	_cache.links_scanned = 1;
+
+	if (dm_snprintf(path, sizeof(path), "%s/disk", _cache.dev_dir) < 0)
+		return;
+
+	_collapse_slashes(path);
+
+	if (!_in_scan_dirs(path) || !(d = opendir(path)))
+		return;
+
+	while ((sub = readdir(d))) {
+		if (sub->d_name[0] == '.' ||
+		    dm_snprintf(subdir, sizeof(subdir), "%s/%s", path, sub->d_name) < 0 ||
+		    !(sd = opendir(subdir)))
+			continue;
+
+		while ((ent = readdir(sd))) {
+			if (ent->d_name[0] == '.' ||
+			    dm_snprintf(link, sizeof(link), "%s/%s", subdir, ent->d_name) < 0)
+				continue;
+
+			if (stat(link, &info) < 0 || !S_ISBLK(info.st_mode) ||
+			    !btree_lookup(_cache.devices, (uint32_t) info.st_rdev) ||
+			    dm_hash_lookup(_cache.names, link))
+				continue;
+
+			if (!_insert_dev(link, info.st_rdev))
+				stack;
+		}
+
+		if (closedir(sd))
+			log_sys_debug("closedir", subdir);
+	}
+
+	if (closedir(d))
+		log_sys_debug("closedir", path);
+}
+
+/*
+ * Look up the names of a device found by _insert_sysfs_devs().
+ * If the cheap lookups find nothing, fall back to walking the scan
+ * directories once, which names every device in one go.
+ */
+static void _resolve_names(struct device *dev)
+{
+	struct dir_list *dl;
+
+	if (!(dev->flags & DEV_NAMES_PENDING))
+		return;
+
+	dev->flags &= ~DEV_NAMES_PENDING;
+
+	if (_cache.names_scanned)
+		return;
+
+#ifdef UDEV_SYNC_SUPPORT
+	if (obtain_device_list_from_udev() && _insert_udev_names(dev))
+		return;
+#endif
+	if (!_cache.links_scanned)
+		_insert_disk_links();
+
+	if (_insert_sysfs_names(dev))
+		return;
+
+	log_debug_devs("Device %d:%d not found by name: scanning directories",
+		       (int) MAJOR(dev->dev), (int) MINOR(dev->dev));
+
+	dm_list_iterate_items(dl, &_cache.dirs)
+		(void) _insert_dir(dl->dir);
+
+	_cache.names_scanned = 1;
+}
+
 static void _full_scan(int dev_scan)
 {
 	struct dir_list *dl;
@@ -641,7 +900,12 @@ static void _full_scan(int dev_scan)
 	if (_cache.has_scanned && !dev_scan)
 		return;
 
-	_insert_dirs(&_cache.dirs);
+	dev_sysfs_map_invalidate();
+
+	if (_cache.from_sysfs && _insert_sysfs_devs())
+		_cache.names_scanned = _cache.links_scanned = 0;
+	else
+		_insert_dirs(&_cache.dirs);
 
 	dm_list_iterate_items(dl, &_cache.files)
 		_insert_file(dl->dir);
@@ -745,6 +1009,10 @@ int dev_cache_init(struct cmd_context *cmd)
 		goto bad;
 	}
 
+	_cache.dev_types = cmd->dev_types;
+	_cache.from_sysfs = find_config_tree_bool(cmd, devices_obtain_device_list_from_sysfs_CFG, NULL);
+	_cache.names_scanned = _cache.links_scanned = 0;
+
 	dm_list_init(&_cache.dirs);
 	dm_list_init(&_cache.files);
 
@@ -771,9 +1039,14 @@ static void _check_for_open_devices(void)
 
 void dev_cache_exit(void)
 {
+	dev_close_all();
+
 	if (_cache.names)
 		_check_for_open_devices();
 
+	dev_block_cache_exit();
+	dev_sysfs_map_exit();
+
 	if (_cache.preferred_names_matcher)
 		_cache.preferred_names_matcher = NULL;
 
@@ -788,6 +1061,7 @@ void dev_cache_exit(void)
 	}
 
 	_cache.devices = NULL;
+	_cache.dev_types = NULL;
 	_cache.has_scanned = 0;
 	dm_list_init(&_cache.dirs);
 	dm_list_init(&_cache.files);
@@ -930,35 +1204,28 @@ struct device *dev_cache_get(const char *name, struct dev_filter *f)
 
 static struct device *_dev_cache_seek_devt(dev_t dev)
 {
-	struct device *d = NULL;
-	struct dm_hash_node *n = dm_hash_get_first(_cache.names);
-	while (n) {
-		d = dm_hash_get_data(_cache.names, n);
-		if (d->dev == dev)
-			return d;
-		n = dm_hash_get_next(_cache.names, n);
-	}
-	return NULL;
+	struct device *d;
+
+	/* Loopfiles are stored under made-up device numbers */
+	if (!(d = (struct device *) btree_lookup(_cache.devices, (uint32_t) dev)) ||
+	    (d->flags & DEV_REGULAR))
+		return NULL;
+
+	_resolve_names(d);
+
+	return dm_list_empty(&d->aliases) ? NULL : d;
 }
 
-/*
- * TODO This is very inefficient. We probably want a hash table indexed by
- * major:minor for keys to speed up these lookups.
- */
 struct device *dev_cache_get_by_devt(dev_t dev, struct dev_filter *f)
 {
 	struct device *d = _dev_cache_seek_devt(dev);
 
-	if (d && (d->flags & DEV_REGULAR))
-		return d;
-
 	if (!d) {
 		_full_scan(0);
 		d = _dev_cache_seek_devt(dev);
 	}
 
-	return (d && (!f || (d->flags & DEV_REGULAR) ||
-		      f->passes_filter(f, d))) ? d : NULL;
+	return (d && (!f || f->passes_filter(f, d))) ? d : NULL;
 }
 
 struct dev_iter *dev_iter_create(struct dev_filter *f, int dev_scan)
@@ -1007,6 +1274,18 @@ struct device *dev_iter_get(struct dev_iter *iter)
 {
 	while (iter->current) {
 		struct device *d = _iter_next(iter);
+
+		if (d->flags & DEV_NAMES_PENDING) {
+			/* Don't look up names of devices the type filter drops */
+			if (iter->filter && _cache.dev_types &&
+			    !_cache.dev_types->dev_type_array[MAJOR(d->dev)].max_partitions)
+				continue;
+			_resolve_names(d);
+		}
+
+		if (dm_list_empty(&d->aliases))
+			continue;
+
 		if (!iter->filter || (d->flags & DEV_REGULAR) ||
 		    iter->filter->passes_filter(iter->filter, d)) {
 			log_debug_devs("Using %s", dev_name(d));
@@ -27,8 +27,10 @@ struct dev_filter {
 	void (*destroy) (struct dev_filter * f);
 	void (*wipe) (struct dev_filter * f);
 	int (*dump) (struct dev_filter * f, int merge_existing);
+	void (*report) (struct dev_filter * f);
 	void *private;
 	unsigned use_count;
+	const char *name;	/* Used when reporting filter statistics */
 };
 
 /*
@@ -16,16 +16,19 @@
 #include "lib.h"
 #include "lvm-types.h"
 #include "device.h"
+#include "dev-type.h"
 #include "metadata.h"
 #include "lvmcache.h"
 #include "memlock.h"
 #include "locking.h"
+#include "lvm-string.h"
 
 #include <limits.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/resource.h>
 
 #ifdef linux
 #  define u64 uint64_t		/* Missing without __KERNEL__ */
@@ -54,7 +57,29 @@
 #  endif
 #endif
 
+#ifdef linux
+#  include <sys/syscall.h>
+#  include <linux/aio_abi.h>
+#  ifdef __NR_io_setup
+#    define AIO_SUPPORT		/* Native kernel AIO via raw syscalls */
+#  endif
+#endif
+
+/*
+ * Devices that are no longer in use may be left open until the end of
+ * the command (see dev_keep_open()) so the label scan, metadata reads
+ * and commits share one descriptor.  Idle devices are moved to the
+ * end of _open_devices, so the least recently used come first when
+ * too many are open.
+ */
+#define KEEP_OPEN_MAX	4096
+
 static DM_LIST_INIT(_open_devices);
+static unsigned _open_count;
+static unsigned _open_max;
+
+static int _write_queued(const struct device_area *where);
+static void _flush_write_batch(void);
 
 /*-----------------------------------------------------------------
  * The standard io loop that keeps submitting an io until it's
@@ -229,6 +254,278 @@ out:
 	return r;
 }
 
+/*-----------------------------------------------------------------
+ * Block cache.
+ *
+ * Reads are served from a bounded set of aligned blocks kept in
+ * LRU order, so the label and metadata sectors that several layers
+ * read in turn only come from disk once.  Blocks only live while
+ * their device is open: closing it drops them, so nothing cached
+ * outlives the locks that made it valid.  Writes go to disk first
+ * and then update any cached copy.
+ *---------------------------------------------------------------*/
+#define BCACHE_BLOCK_SHIFT	12
+#define BCACHE_BLOCK_SIZE	(1 << BCACHE_BLOCK_SHIFT)
+#define BCACHE_BLOCK_MASK	(BCACHE_BLOCK_SIZE - 1)
+
+struct dev_block {
+	struct dm_list lru;		/* On _bcache.lru or _bcache.free */
+	struct dm_list dev_list;	/* On dev->cached_blocks */
+	struct dev_block *hash_next;
+	struct device *dev;
+	uint64_t index;			/* Block number on dev */
+	char *data;
+};
+
+static struct {
+	unsigned nr_blocks;
+	unsigned hash_mask;
+	struct dev_block *blocks;
+	struct dev_block **hash;
+	char *mem;
+	struct dm_list lru;		/* Most recently used first */
+	struct dm_list free;
+	uint64_t hits;
+	uint64_t misses;
+} _bcache;
+
+static int _bcache_init(void)
+{
+	unsigned i, nr_blocks, nr_buckets = 1;
+	char *data;
+
+	if (_bcache.nr_blocks)
+		return 1;
+
+	if (dev_block_cache_size() <= 0)
+		return 0;
+
+	/* Anything below a couple of blocks is not worth the bother */
+	nr_blocks = ((unsigned) dev_block_cache_size() << 10) >> BCACHE_BLOCK_SHIFT;
+	if (nr_blocks < 2)
+		return 0;
+
+	while (nr_buckets < nr_blocks)
+		nr_buckets <<= 1;
+
+	if (!(_bcache.blocks = dm_zalloc(nr_blocks * sizeof(*_bcache.blocks))) ||
+	    !(_bcache.hash = dm_zalloc(nr_buckets * sizeof(*_bcache.hash))) ||
+	    !(_bcache.mem = dm_malloc((size_t) nr_blocks * BCACHE_BLOCK_SIZE +
+				      BCACHE_BLOCK_MASK))) {
+		log_error("Failed to allocate %d KiB device block cache.",
+			  dev_block_cache_size());
+		dm_free(_bcache.blocks);
+		dm_free(_bcache.hash);
+		memset(&_bcache, 0, sizeof(_bcache));
+		/* Carry on uncached */
+		init_dev_block_cache_size(0);
+		return 0;
+	}
+
+	dm_list_init(&_bcache.lru);
+	dm_list_init(&_bcache.free);
+
+	data = (char *) ((((uintptr_t) _bcache.mem) + BCACHE_BLOCK_MASK) &
+			 ~(uintptr_t) BCACHE_BLOCK_MASK);
+	for (i = 0; i < nr_blocks; i++) {
+		_bcache.blocks[i].data = data + ((size_t) i << BCACHE_BLOCK_SHIFT);
+		dm_list_init(&_bcache.blocks[i].dev_list);
+		dm_list_add(&_bcache.free, &_bcache.blocks[i].lru);
+	}
+
+	_bcache.nr_blocks = nr_blocks;
+	_bcache.hash_mask = nr_buckets - 1;
+
+	return 1;
+}
+
+void dev_block_cache_exit(void)
+{
+	if (!_bcache.nr_blocks)
+		return;
+
+	log_debug_devs("Device block cache: %" PRIu64 " hits, %" PRIu64
+		       " blocks read.", _bcache.hits, _bcache.misses);
+
+	dm_free(_bcache.blocks);
+	dm_free(_bcache.hash);
+	dm_free(_bcache.mem);
+	memset(&_bcache, 0, sizeof(_bcache));
+}
+
+static unsigned _bcache_hash(const struct device *dev, uint64_t index)
+{
+	uint64_t h = ((uintptr_t) dev >> 4) ^ index;
+
+	return (unsigned) ((h * UINT64_C(0x9e3779b97f4a7c15)) >> 32) & _bcache.hash_mask;
+}
+
+static struct dev_block *_bcache_lookup(const struct device *dev, uint64_t index)
+{
+	struct dev_block *b;
+
+	for (b = _bcache.hash[_bcache_hash(dev, index)]; b; b = b->hash_next)
+		if (b->dev == dev && b->index == index)
+			return b;
+
+	return NULL;
+}
+
+static void _bcache_release(struct dev_block *b)
+{
+	struct dev_block **bp = &_bcache.hash[_bcache_hash(b->dev, b->index)];
+
+	while (*bp != b)
+		bp = &(*bp)->hash_next;
+	*bp = b->hash_next;
+
+	dm_list_del(&b->dev_list);
+	dm_list_move(&_bcache.free, &b->lru);
+	b->dev = NULL;
+}
+
+static void _bcache_invalidate_dev(struct device *dev)
+{
+	struct dev_block *b, *tmp;
+
+	dm_list_iterate_items_gen_safe(b, tmp, &dev->cached_blocks, dev_list)
+		_bcache_release(b);
+}
+
+/*
+ * Store 'count' blocks starting at block 'index' of 'dev'.
+ */
+static void _bcache_store(struct device *dev, uint64_t index, unsigned count,
+			  const char *data)
+{
+	struct dev_block *b;
+	unsigned h;
+
+	for (; count; count--, index++, data += BCACHE_BLOCK_SIZE) {
+		if (!(b = _bcache_lookup(dev, index))) {
+			if (dm_list_empty(&_bcache.free))
+				_bcache_release(dm_list_struct_base(dm_list_last(&_bcache.lru),
+								    struct dev_block, lru));
+			b = dm_list_struct_base(dm_list_first(&_bcache.free),
+						struct dev_block, lru);
+			b->dev = dev;
+			b->index = index;
+			h = _bcache_hash(dev, index);
+			b->hash_next = _bcache.hash[h];
+			_bcache.hash[h] = b;
+			dm_list_add(&dev->cached_blocks, &b->dev_list);
+		}
+
+		memcpy(b->data, data, BCACHE_BLOCK_SIZE);
+		dm_list_del(&b->lru);
+		dm_list_add_h(&_bcache.lru, &b->lru);
+	}
+}
+
+static int _bcache_fill(struct device *dev, uint64_t index, unsigned count)
+{
+	struct device_area where;
+	char *buf, *aligned;
+	int r = 0;
+
+	where.dev = dev;
+	where.start = index << BCACHE_BLOCK_SHIFT;
+	where.size = (uint64_t) count << BCACHE_BLOCK_SHIFT;
+
+	if (!(buf = dm_malloc((size_t) where.size + BCACHE_BLOCK_MASK)))
+		return_0;
+
+	aligned = (char *) ((((uintptr_t) buf) + BCACHE_BLOCK_MASK) &
+			    ~(uintptr_t) BCACHE_BLOCK_MASK);
+
+	if (_io(&where, aligned, 0)) {
+		_bcache_store(dev, index, count, aligned);
+		_bcache.misses += count;
+		r = 1;
+	}
+
+	dm_free(buf);
+
+	return r;
+}
+
+/*
+ * Returns 0 if the read could not be served from the cache,
+ * in which case the caller falls back to uncached io.
+ */
+static int _bcache_read(struct device_area *where, char *buffer)
+{
+	uint64_t index, last, offset;
+	size_t len, left = (size_t) where->size;
+	unsigned run;
+	struct dev_block *b;
+
+	if (!where->size || !_bcache_init())
+		return 0;
+
+	index = where->start >> BCACHE_BLOCK_SHIFT;
+	last = (where->start + where->size - 1) >> BCACHE_BLOCK_SHIFT;
+	offset = where->start & BCACHE_BLOCK_MASK;
+
+	/* Large reads would only flush everything else out */
+	if (last - index >= _bcache.nr_blocks / 2)
+		return 0;
+
+	for (; index <= last; index++, offset = 0) {
+		if ((b = _bcache_lookup(where->dev, index)))
+			_bcache.hits++;
+		else {
+			for (run = 1; index + run <= last &&
+			     !_bcache_lookup(where->dev, index + run); run++)
+				;
+			if (!_bcache_fill(where->dev, index, run) ||
+			    !(b = _bcache_lookup(where->dev, index)))
+				return 0;
+		}
+
+		dm_list_del(&b->lru);
+		dm_list_add_h(&_bcache.lru, &b->lru);
+
+		len = BCACHE_BLOCK_SIZE - (size_t) offset;
+		if (len > left)
+			len = left;
+		memcpy(buffer, b->data + offset, len);
+		buffer += len;
+		left -= len;
+	}
+
+	return 1;
+}
+
+/*
+ * Bring any cached copy of the region into line with what was
+ * just written to disk.
+ */
+static void _bcache_write(struct device_area *where, const char *buffer)
+{
+	uint64_t index, last, offset;
+	size_t len, left = (size_t) where->size;
+	struct dev_block *b;
+
+	if (!_bcache.nr_blocks || dm_list_empty(&where->dev->cached_blocks) ||
+	    !where->size)
+		return;
+
+	index = where->start >> BCACHE_BLOCK_SHIFT;
+	last = (where->start + where->size - 1) >> BCACHE_BLOCK_SHIFT;
+	offset = where->start & BCACHE_BLOCK_MASK;
+
+	for (; index <= last; index++, offset = 0) {
+		len = BCACHE_BLOCK_SIZE - (size_t) offset;
+		if (len > left)
+			len = left;
+		if ((b = _bcache_lookup(where->dev, index)))
+			memcpy(b->data + offset, buffer, len);
+		buffer += len;
+		left -= len;
+	}
+}
+
 static int _dev_get_size_file(const struct device *dev, uint64_t *size)
 {
 	const char *name = dev_name(dev);
@@ -316,6 +613,7 @@ static int _dev_discard_blocks(struct device *dev, uint64_t offset_bytes, uint64
 
 	log_debug_devs("Discarding %" PRIu64 " bytes offset %" PRIu64 " bytes on %s.",
 		       size_bytes, offset_bytes, dev_name(dev));
+	_bcache_invalidate_dev(dev);
 	if (ioctl(dev->fd, BLKDISCARD, &discard_range) < 0) {
 		log_error("%s: BLKDISCARD ioctl at offset %" PRIu64 " size %" PRIu64 " failed: %s.",
 			  dev_name(dev), offset_bytes, size_bytes, strerror(errno));
@@ -411,6 +709,111 @@ void dev_flush(struct device *dev)
 	sync();
 }
 
+static void _close(struct device *dev)
+{
+	if (close(dev->fd))
+		log_sys_error("close", dev_name(dev));
+	dev->fd = -1;
+	dev->block_size = -1;
+	dm_list_del(&dev->open_list);
+	_open_count--;
+	_bcache_invalidate_dev(dev);
+
+	log_debug_devs("Closed %s", dev_name(dev));
+
+	if (dev->flags & DEV_ALLOCED) {
+		dm_free((void *) dm_list_item(dev->aliases.n, struct str_list)->
+			 str);
+		dm_free(dev->aliases.n);
+		dm_free(dev);
+	}
+}
+
+/* Leave half the descriptors for everything else */
+static unsigned _keep_open_max(void)
+{
+	struct rlimit rlim;
+
+	if (_open_max)
+		return _open_max;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) < 0) {
+		log_sys_debug("getrlimit", "RLIMIT_NOFILE");
+		rlim.rlim_cur = 1024;
+	}
+
+	if (rlim.rlim_cur == RLIM_INFINITY || rlim.rlim_cur / 2 > KEEP_OPEN_MAX)
+		_open_max = KEEP_OPEN_MAX;
+	else if (!(_open_max = (unsigned) rlim.rlim_cur / 2))
+		_open_max = 1;
+
+	return _open_max;
+}
+
+/*
+ * Holding an LV open would stop it being deactivated, so only
+ * devices whose dm uuid (if any) is not LVM's are kept open.
+ */
+static int _dev_may_keep_open(struct device *dev)
+{
+	const char *sysfs_dir = dm_sysfs_dir();
+	char path[PATH_MAX], uuid[sizeof(UUID_PREFIX)];
+	FILE *fp;
+
+	if (dev->flags & DEV_ALLOCED)
+		return 0;
+
+	if (dev->flags & (DEV_REGULAR | DEV_KEEP_OPEN_TESTED))
+		return (dev->flags & DEV_NO_KEEP_OPEN) ? 0 : 1;
+
+	dev->flags |= DEV_KEEP_OPEN_TESTED;
+
+	if (!sysfs_dir || !*sysfs_dir ||
+	    dm_snprintf(path, sizeof(path), "%s/dev/block/%d:%d/dm/uuid",
+			sysfs_dir, (int) MAJOR(dev->dev),
+			(int) MINOR(dev->dev)) < 0) {
+		dev->flags |= DEV_NO_KEEP_OPEN;
+		return 0;
+	}
+
+	/* Not a dm device */
+	if (!(fp = fopen(path, "r")))
+		return 1;
+
+	if (!fgets(uuid, sizeof(uuid), fp) ||
+	    !strncmp(uuid, UUID_PREFIX, sizeof(UUID_PREFIX) - 1))
+		dev->flags |= DEV_NO_KEEP_OPEN;
+
+	if (fclose(fp))
+		log_sys_debug("fclose", path);
+
+	return (dev->flags & DEV_NO_KEEP_OPEN) ? 0 : 1;
+}
+
+static void _keep_open(struct device *dev)
+{
+	/* Cached blocks last only as long as the device is in use */
+	_bcache_invalidate_dev(dev);
+	dm_list_move(&_open_devices, &dev->open_list);
+}
+
+/* Make room for another descriptor by closing idle devices */
+static void _close_idle_devices(void)
+{
+	struct device *dev, *tmp;
+
+	if (_open_count < _keep_open_max())
+		return;
+
+	dm_list_iterate_items_gen_safe(dev, tmp, &_open_devices, open_list) {
+		if (dev->open_count > 0 || lvmcache_pvid_is_locked(dev->pvid))
+			continue;
+		_close(dev);
+		if (_open_count < _keep_open_max())
+			return;
+	}
+}
+
 int dev_open_flags(struct device *dev, int flags, int direct, int quiet)
 {
 	struct stat buf;
@@ -467,6 +870,9 @@ int dev_open_flags(struct device *dev, int flags, int direct, int quiet)
 		flags |= O_NOATIME;
 #endif
 
+	if (dev_keep_open())
+		_close_idle_devices();
+
 	if ((dev->fd = open(name, flags, 0777)) < 0) {
 #ifdef O_DIRECT_SUPPORT
 		if (direct && !(dev->flags & DEV_O_DIRECT_TESTED)) {
@@ -519,6 +925,7 @@ int dev_open_flags(struct device *dev, int flags, int direct, int quiet)
 		dev->end = lseek(dev->fd, (off_t) 0, SEEK_END);
 
 	dm_list_add(&_open_devices, &dev->open_list);
+	_open_count++;
 
 	log_debug_devs("Opened %s %s%s%s", dev_name(dev),
 		       dev->flags & DEV_OPENED_RW ? "RW" : "RO",
@@ -568,24 +975,6 @@ int dev_test_excl(struct device *dev)
 	return r;
 }
 
-static void _close(struct device *dev)
-{
-	if (close(dev->fd))
-		log_sys_error("close", dev_name(dev));
-	dev->fd = -1;
-	dev->block_size = -1;
-	dm_list_del(&dev->open_list);
-
-	log_debug_devs("Closed %s", dev_name(dev));
-
-	if (dev->flags & DEV_ALLOCED) {
-		dm_free((void *) dm_list_item(dev->aliases.n, struct str_list)->
-			 str);
-		dm_free(dev->aliases.n);
-		dm_free(dev);
-	}
-}
-
 static int _dev_close(struct device *dev, int immediate)
 {
 
@@ -595,6 +984,17 @@ static int _dev_close(struct device *dev, int immediate)
 		return 0;
 	}
 
+	/*
+	 * Queued writes need the descriptor.  Each one drops the reference
+	 * taken when it was queued, so hold another across the flush to
+	 * stop that closing or releasing the device underneath us.
+	 */
+	if (immediate && (dev->flags & DEV_WRITES_QUEUED)) {
+		dev->open_count++;
+		_flush_write_batch();
+		dev->open_count--;
+	}
+
 #ifndef O_DIRECT_SUPPORT
 	if (dev->flags & DEV_ACCESSED_W)
 		dev_flush(dev);
@@ -607,10 +1007,20 @@ static int _dev_close(struct device *dev, int immediate)
 		log_debug_devs("%s: Immediate close attempt while still referenced",
 			       dev_name(dev));
 
-	/* Close unless device is known to belong to a locked VG */
-	if (immediate ||
-	    (dev->open_count < 1 && !lvmcache_pvid_is_locked(dev->pvid)))
-		_close(dev);
+	/*
+	 * Close unless device is known to belong to a locked VG
+	 * or is being kept open for the rest of the command.
+	 */
+	if (immediate) {
+		if (dev->fd >= 0)
+			_close(dev);
+	}
+	else if (dev->open_count < 1 && !lvmcache_pvid_is_locked(dev->pvid)) {
+		if (dev_keep_open() && _dev_may_keep_open(dev))
+			_keep_open(dev);
+		else
+			_close(dev);
+	}
 
 	return 1;
 }
@@ -651,6 +1061,30 @@ static void _dev_inc_error_count(struct device *dev)
 			 dev->max_error_count, dev_name(dev));
 }
 
+/*
+ * Data just read by a batch that dev_read() serves without going
+ * to the block cache or the disk.  See dev_set_read_window().
+ */
+static struct {
+	struct device *dev;
+	uint64_t start;
+	uint64_t size;
+	const char *buf;
+} _read_window;
+
+void dev_set_read_window(const struct device_read_req *req)
+{
+	if (!req || !req->result) {
+		_read_window.dev = NULL;
+		return;
+	}
+
+	_read_window.dev = req->where.dev;
+	_read_window.start = req->where.start;
+	_read_window.size = req->where.size;
+	_read_window.buf = req->buf;
+}
+
 int dev_read(struct device *dev, uint64_t offset, size_t len, void *buffer)
 {
 	struct device_area where;
@@ -668,6 +1102,18 @@ int dev_read(struct device *dev, uint64_t offset, size_t len, void *buffer)
 
 	// fprintf(stderr, "READ: %s, %lld, %d\n", dev_name(dev), offset, len);
 
+	if (_write_queued(&where))
+		_flush_write_batch();
+
+	if (_read_window.dev == dev && offset >= _read_window.start &&
+	    offset + len <= _read_window.start + _read_window.size) {
+		memcpy(buffer, _read_window.buf + (offset - _read_window.start), len);
+		return 1;
+	}
+
+	if (_bcache_read(&where, buffer))
+		return 1;
+
 	ret = _aligned_io(&where, buffer, 0);
 	if (!ret)
 		_dev_inc_error_count(dev);
@@ -704,6 +1150,433 @@ int dev_read_circular(struct device *dev, uint64_t offset, size_t len,
 	return 1;
 }
 
+#ifdef AIO_SUPPORT
+/*
+ * Submit all the reads or writes to the kernel at once and reap them
+ * as they complete.  Returns 0 if AIO is not usable at all, so the
+ * caller can fall back to synchronous io.  Requests that completed
+ * but failed get result -1, those never submitted are left with 0.
+ */
+static int _aio_batch(struct device_read_req *reqs, unsigned count,
+		      int should_write)
+{
+	aio_context_t ctx = 0;
+	struct device_read_req *req;
+	struct iocb *iocbs = NULL, **iocbps = NULL;
+	struct io_event *events = NULL;
+	unsigned i, nr = 0, submitted = 0, inflight = 0;
+	long n;
+	int r = 0;
+
+	if (syscall(__NR_io_setup, count, &ctx) < 0) {
+		log_debug_devs("io_setup for %u %s failed: %s", count,
+			       should_write ? "writes" : "reads", strerror(errno));
+		return 0;
+	}
+
+	if (!(iocbs = dm_zalloc(count * sizeof(*iocbs))) ||
+	    !(iocbps = dm_malloc(count * sizeof(*iocbps))) ||
+	    !(events = dm_malloc(count * sizeof(*events)))) {
+		log_error("Failed to allocate AIO control blocks.");
+		goto out;
+	}
+
+	for (i = 0; i < count; i++) {
+		reqs[i].result = 0;
+
+		if (!reqs[i].where.dev->open_count ||
+		    !_dev_is_valid(reqs[i].where.dev))
+			continue;
+
+		iocbs[nr].aio_data = i;
+		iocbs[nr].aio_lio_opcode = should_write ? IOCB_CMD_PWRITE : IOCB_CMD_PREAD;
+		iocbs[nr].aio_fildes = dev_fd(reqs[i].where.dev);
+		iocbs[nr].aio_buf = (uintptr_t) reqs[i].buf;
+		iocbs[nr].aio_nbytes = reqs[i].where.size;
+		iocbs[nr].aio_offset = reqs[i].where.start;
+		iocbps[nr] = &iocbs[nr];
+		nr++;
+	}
+
+	while (submitted < nr || inflight) {
+		if (submitted < nr) {
+			n = syscall(__NR_io_submit, ctx, (long) (nr - submitted),
+				    iocbps + submitted);
+			if (n < 0 && (errno != EAGAIN || !inflight)) {
+				log_debug_devs("io_submit failed: %s",
+					       strerror(errno));
+				/* Leave the rest to the synchronous path */
+				nr = submitted;
+			} else if (n > 0) {
+				submitted += n;
+				inflight += n;
+			}
+		}
+
+		if (!inflight)
+			continue;
+
+		do
+			n = syscall(__NR_io_getevents, ctx, 1L, (long) inflight,
+				    events, NULL);
+		while (n < 0 && errno == EINTR);
+
+		if (n < 0) {
+			log_error("io_getevents failed: %s", strerror(errno));
+			goto out;
+		}
+
+		/* Completed requests that failed are not retried */
+		for (i = 0; i < (unsigned) n; i++) {
+			req = &reqs[events[i].data];
+			if (events[i].res == (int64_t) req->where.size)
+				req->result = 1;
+			else {
+				log_debug_devs("%s: %s of %" PRIu64 " bytes at %"
+					       PRIu64 " failed.", dev_name(req->where.dev),
+					       should_write ? "Write" : "Read",
+					       req->where.size, req->where.start);
+				req->result = -1;
+			}
+		}
+
+		inflight -= n;
+	}
+
+	r = 1;
+out:
+	if (syscall(__NR_io_destroy, ctx) < 0)
+		log_sys_debug("io_destroy", "");
+	dm_free(iocbs);
+	dm_free(iocbps);
+	dm_free(events);
+
+	return r;
+}
+#endif
+
+/*
+ * Read several regions, possibly on different devices, in one go.
+ * All devices must already be open.  Each request records its own
+ * result; any read that could not be submitted asynchronously goes
+ * through the normal synchronous path, but one that failed is not
+ * read a second time.
+ */
+int dev_read_batch(struct device_read_req *reqs, unsigned count)
+{
+	unsigned i;
+	int aio = 0;
+
+	if (!count)
+		return 1;
+
+	for (i = 0; i < count; i++)
+		if (_write_queued(&reqs[i].where)) {
+			_flush_write_batch();
+			break;
+		}
+
+#ifdef AIO_SUPPORT
+	aio = _aio_batch(reqs, count, 0);
+#endif
+
+	for (i = 0; i < count; i++) {
+		if (aio && reqs[i].result) {
+			if (reqs[i].result < 0) {
+				reqs[i].result = 0;
+				_dev_inc_error_count(reqs[i].where.dev);
+			}
+			continue;
+		}
+		reqs[i].result = dev_read(reqs[i].where.dev, reqs[i].where.start,
+					  (size_t) reqs[i].where.size, reqs[i].buf);
+	}
+
+	return 1;
+}
+
+/*
+ * Offer the data from a successful batched read to the block cache,
+ * so that later dev_read calls on the same region need no I/O.
+ * Blocks are dropped when a device goes out of use, so nothing is
+ * stored unless the device stays open after the caller closes it:
+ * someone else holds it or its VG is locked.
+ */
+void dev_cache_read_req(const struct device_read_req *req)
+{
+	struct device *dev = req->where.dev;
+
+	if (!req->result || dev->fd < 0 ||
+	    (dev->open_count < 2 && !lvmcache_pvid_is_locked(dev->pvid)) ||
+	    !_bcache_init() ||
+	    ((req->where.start | req->where.size) & BCACHE_BLOCK_MASK) ||
+	    (req->where.size >> BCACHE_BLOCK_SHIFT) >= _bcache.nr_blocks / 2)
+		return;
+
+	_bcache_store(req->where.dev, req->where.start >> BCACHE_BLOCK_SHIFT,
+		      (unsigned) (req->where.size >> BCACHE_BLOCK_SHIFT),
+		      req->buf);
+}
+
+/*-----------------------------------------------------------------
+ * Write batches.
+ *
+ * Between dev_write_batch_begin() and dev_write_batch_end(),
+ * dev_write() only queues a block aligned copy of the data.  Ending
+ * the batch reads any partial blocks at the ends of the queued
+ * regions together, then issues all the writes together and waits
+ * for every one of them.  Writes to many devices then cost about one
+ * round trip, while writes from separate batches still reach the
+ * disk in order.  Reading or writing a region that overlaps a queued
+ * write, or closing its device, flushes the batch early.
+ *---------------------------------------------------------------*/
+struct queued_write {
+	struct dm_list list;
+	struct device_area where;	/* Region the caller wrote */
+	struct device_area widened;	/* Block aligned region written */
+	unsigned block_size;
+	int head_req;			/* Index of partial block reads or -1 */
+	int tail_req;
+	char *buf;			/* Block aligned data for widened */
+	char *edge;			/* Space for the two partial blocks */
+	char *mem;
+	int *failed;			/* Set if the write fails */
+};
+
+static DM_LIST_INIT(_queued_writes);
+static unsigned _write_batch_depth;
+static unsigned _write_batch_failed;
+static int *_write_batch_track;
+
+static int _write_queued(const struct device_area *where)
+{
+	struct queued_write *qw;
+
+	if (!(where->dev->flags & DEV_WRITES_QUEUED))
+		return 0;
+
+	dm_list_iterate_items(qw, &_queued_writes)
+		if (qw->where.dev == where->dev &&
+		    qw->widened.start < where->start + where->size &&
+		    where->start < qw->widened.start + qw->widened.size)
+			return 1;
+
+	return 0;
+}
+
+static void _merge_edges(struct queued_write *qw,
+			 const struct device_read_req *reqs)
+{
+	uint64_t head = qw->where.start - qw->widened.start;
+	uint64_t end = head + qw->where.size;
+	uint64_t tail = qw->widened.size - qw->block_size;
+	const char *tail_buf;
+
+	/* FIXME pre-extend the file */
+	if (qw->head_req >= 0) {
+		if (reqs[qw->head_req].result)
+			memcpy(qw->buf, qw->edge, (size_t) head);
+		else
+			memset(qw->buf, '\n', (size_t) head);
+	}
+
+	if (end == qw->widened.size)
+		return;
+
+	if (qw->tail_req >= 0) {
+		tail_buf = reqs[qw->tail_req].buf;
+		if (!reqs[qw->tail_req].result)
+			tail_buf = NULL;
+	} else
+		/* Same block as the head */
+		tail_buf = reqs[qw->head_req].result ? qw->edge : NULL;
+
+	if (tail_buf)
+		memcpy(qw->buf + end, tail_buf + (end - tail),
+		       (size_t) (qw->widened.size - end));
+	else
+		memset(qw->buf + end, '\n', (size_t) (qw->widened.size - end));
+}
+
+static void _flush_write_batch(void)
+{
+	struct dm_list writes;
+	struct queued_write *qw, *tmp;
+	struct device_read_req *reqs = NULL;
+	unsigned i = 0, nr = 0, count = 0;
+	int aio = 0, ok;
+
+	if (dm_list_empty(&_queued_writes))
+		return;
+
+	/* Anything queued from here on belongs to the next flush */
+	dm_list_init(&writes);
+	dm_list_splice(&writes, &_queued_writes);
+
+	dm_list_iterate_items(qw, &writes) {
+		qw->where.dev->flags &= ~DEV_WRITES_QUEUED;
+		count++;
+	}
+
+	if (!(reqs = dm_zalloc(2 * count * sizeof(*reqs))))
+		log_error("Failed to allocate write batch.");
+
+	/* Read the partial blocks at either end so they are preserved */
+	dm_list_iterate_items(qw, &writes) {
+		qw->head_req = qw->tail_req = -1;
+		if (!reqs)
+			continue;
+		if (qw->where.start != qw->widened.start) {
+			reqs[nr].where.dev = qw->where.dev;
+			reqs[nr].where.start = qw->widened.start;
+			reqs[nr].where.size = qw->block_size;
+			reqs[nr].buf = qw->edge;
+			qw->head_req = (int) nr++;
+		}
+		if ((qw->where.start + qw->where.size !=
+		     qw->widened.start + qw->widened.size) &&
+		    (qw->head_req < 0 || qw->widened.size > qw->block_size)) {
+			reqs[nr].where.dev = qw->where.dev;
+			reqs[nr].where.start = qw->widened.start +
+				qw->widened.size - qw->block_size;
+			reqs[nr].where.size = qw->block_size;
+			reqs[nr].buf = qw->edge + qw->block_size;
+			qw->tail_req = (int) nr++;
+		}
+	}
+
+	if (nr && !dev_read_batch(reqs, nr))
+		stack;
+
+	if (reqs) {
+		dm_list_iterate_items(qw, &writes) {
+			_merge_edges(qw, reqs);
+			reqs[i].where = qw->widened;
+			reqs[i].buf = qw->buf;
+			reqs[i].result = 0;
+			i++;
+		}
+#ifdef AIO_SUPPORT
+		aio = _aio_batch(reqs, count, 1);
+#endif
+	}
+
+	log_debug_devs("Wrote %u queued region(s)%s.", count,
+		       aio ? " concurrently" : "");
+
+	i = 0;
+	dm_list_iterate_items_safe(qw, tmp, &writes) {
+		if (reqs && aio && reqs[i].result)
+			ok = (reqs[i].result > 0);
+		else if (reqs)
+			ok = _io(&qw->widened, qw->buf, 1);
+		else
+			/* No memory for the batch: write the way dev_write would */
+			ok = _aligned_io(&qw->where, qw->buf + (qw->where.start -
+							       qw->widened.start), 1);
+
+		if (ok)
+			_bcache_write(&qw->where, qw->buf + (qw->where.start -
+							   qw->widened.start));
+		else {
+			_write_batch_failed++;
+			if (qw->failed)
+				*qw->failed = 1;
+			_dev_inc_error_count(qw->where.dev);
+			_bcache_invalidate_dev(qw->where.dev);
+		}
+
+		i++;
+		dm_list_del(&qw->list);
+		/* Drop the reference taken by _queue_write() */
+		if (!_dev_close(qw->where.dev, 0))
+			stack;
+		dm_free(qw->mem);
+		dm_free(qw);
+	}
+
+	dm_free(reqs);
+}
+
+static int _queue_write(struct device_area *where, const char *buffer)
+{
+	struct queued_write *qw;
+	unsigned int block_size = 0;
+	uintptr_t mask;
+
+	if (!(where->dev->flags & DEV_REGULAR) &&
+	    !_get_block_size(where->dev, &block_size))
+		return_0;
+
+	if (!block_size)
+		block_size = lvm_getpagesize();
+
+	if (!(qw = dm_zalloc(sizeof(*qw))))
+		return_0;
+
+	_widen_region(block_size, where, &qw->widened);
+
+	/* Data, the two partial end blocks and room to align */
+	if (!(qw->mem = dm_malloc((size_t) qw->widened.size + 3 * block_size))) {
+		dm_free(qw);
+		return_0;
+	}
+
+	/* Keep writes to the same blocks in order */
+	if (_write_queued(&qw->widened))
+		_flush_write_batch();
+
+	mask = block_size - 1;
+	qw->buf = (char *) ((((uintptr_t) qw->mem) + mask) & ~mask);
+	qw->edge = qw->buf + qw->widened.size;
+	qw->block_size = block_size;
+	qw->where = *where;
+	qw->failed = _write_batch_track;
+	memcpy(qw->buf + (where->start - qw->widened.start), buffer,
+	       (size_t) where->size);
+
+	where->dev->open_count++;
+	where->dev->flags |= DEV_WRITES_QUEUED;
+	dm_list_add(&_queued_writes, &qw->list);
+
+	return 1;
+}
+
+void dev_write_batch_begin(void)
+{
+	if (!_write_batch_depth++)
+		_write_batch_failed = 0;
+}
+
+unsigned dev_write_batch_end(void)
+{
+	unsigned failed;
+
+	if (!_write_batch_depth) {
+		log_error(INTERNAL_ERROR "Write batch ended without starting.");
+		return 0;
+	}
+
+	_flush_write_batch();
+	failed = _write_batch_failed;
+
+	if (!--_write_batch_depth) {
+		_write_batch_failed = 0;
+		_write_batch_track = NULL;
+	}
+
+	return failed;
+}
+
+/*
+ * Lets the caller tell which of its writes failed.  Every batch is
+ * flushed by dev_write_batch_end(), so 'failed' need only outlive that.
+ */
+void dev_write_batch_track(int *failed)
+{
+	_write_batch_track = failed;
+}
+
 /* FIXME If O_DIRECT can't extend file, dev_extend first; dev_truncate after.
  *       But fails if concurrent processes writing
  */
@@ -742,9 +1615,19 @@ int dev_write(struct device *dev, uint64_t offset, size_t len, void *buffer)
 
 	dev->flags |= DEV_ACCESSED_W;
 
+	if (_write_batch_depth && !test_mode()) {
+		if (_queue_write(&where, buffer))
+			return 1;
+		/* Fall back to writing now, after anything already queued */
+		_flush_write_batch();
+	}
+
 	ret = _aligned_io(&where, buffer, 1);
-	if (!ret)
+	if (!ret) {
 		_dev_inc_error_count(dev);
+		_bcache_invalidate_dev(dev);
+	} else if (!test_mode())
+		_bcache_write(&where, buffer);
 
 	return ret;
 }
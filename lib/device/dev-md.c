@@ -16,116 +16,11 @@
 #include "lib.h"
 #include "dev-type.h"
 #include "metadata.h"
-#include "xlate.h"
 
 #ifdef linux
 
-/* Lifted from <linux/raid/md_p.h> because of difficulty including it */
-
-#define MD_SB_MAGIC 0xa92b4efc
-#define MD_RESERVED_BYTES (64 * 1024ULL)
-#define MD_RESERVED_SECTORS (MD_RESERVED_BYTES / 512)
-#define MD_NEW_SIZE_SECTORS(x) ((x & ~(MD_RESERVED_SECTORS - 1)) \
-				- MD_RESERVED_SECTORS)
 #define MD_MAX_SYSFS_SIZE 64
 
-static int _dev_has_md_magic(struct device *dev, uint64_t sb_offset)
-{
-	uint32_t md_magic;
-
-	/* Version 1 is little endian; version 0.90.0 is machine endian */
-	if (dev_read(dev, sb_offset, sizeof(uint32_t), &md_magic) &&
-	    ((md_magic == xlate32(MD_SB_MAGIC)) ||
-	     (md_magic == MD_SB_MAGIC)))
-		return 1;
-
-	return 0;
-}
-
-/*
- * Calculate the position of the superblock.
- * It is always aligned to a 4K boundary and
- * depending on minor_version, it can be:
- * 0: At least 8K, but less than 12K, from end of device
- * 1: At start of device
- * 2: 4K from start of device.
- */
-typedef enum {
-	MD_MINOR_VERSION_MIN,
-	MD_MINOR_V0 = MD_MINOR_VERSION_MIN,
-	MD_MINOR_V1,
-	MD_MINOR_V2,
-	MD_MINOR_VERSION_MAX = MD_MINOR_V2
-} md_minor_version_t;
-
-static uint64_t _v1_sb_offset(uint64_t size, md_minor_version_t minor_version)
-{
-	uint64_t uninitialized_var(sb_offset);
-
-	switch(minor_version) {
-	case MD_MINOR_V0:
-		sb_offset = (size - 8 * 2) & ~(4 * 2 - 1ULL);
-		break;
-	case MD_MINOR_V1:
-		sb_offset = 0;
-		break;
-	case MD_MINOR_V2:
-		sb_offset = 4 * 2;
-		break;
-	}
-	sb_offset <<= SECTOR_SHIFT;
-
-	return sb_offset;
-}
-
-/*
- * Returns -1 on error
- */
-int dev_is_md(struct device *dev, uint64_t *sb)
-{
-	int ret = 1;
-	md_minor_version_t minor;
-	uint64_t size, sb_offset;
-
-	if (!dev_get_size(dev, &size)) {
-		stack;
-		return -1;
-	}
-
-	if (size < MD_RESERVED_SECTORS * 2)
-		return 0;
-
-	if (!dev_open_readonly(dev)) {
-		stack;
-		return -1;
-	}
-
-	/* Check if it is an md component device. */
-	/* Version 0.90.0 */
-	sb_offset = MD_NEW_SIZE_SECTORS(size) << SECTOR_SHIFT;
-	if (_dev_has_md_magic(dev, sb_offset))
-		goto out;
-
-	minor = MD_MINOR_VERSION_MIN;
-	/* Version 1, try v1.0 -> v1.2 */
-	do {
-		sb_offset = _v1_sb_offset(size, minor);
-		if (_dev_has_md_magic(dev, sb_offset))
-			goto out;
-	} while (++minor <= MD_MINOR_VERSION_MAX);
-
-	ret = 0;
-
-out:
-	if (!dev_close(dev))
-		stack;
-
-	if (ret && sb)
-		*sb = sb_offset;
-
-	return ret;
-}
-
 static int _md_sysfs_attribute_snprintf(char *path, size_t size,
 					struct dev_types *dt,
 					struct device *blkdev,
@@ -327,12 +222,6 @@ unsigned long dev_md_stripe_width(struct dev_types *dt, struct device *dev)
 
 #else
 
-int dev_is_md(struct device *dev __attribute__((unused)),
-	      uint64_t *sb __attribute__((unused)))
-{
-	return 0;
-}
-
 unsigned long dev_md_stripe_width(struct dev_types *dt __attribute__((unused)),
 				  struct device *dev __attribute__((unused)))
 {
@@ -0,0 +1,369 @@
+/*
+ * Copyright (C) 2004 Luca Berra
+ * Copyright (C) 2004-2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "lib.h"
+#include "dev-type.h"
+#include "metadata.h"
+#include "xlate.h"
+
+/*
+ * Every foreign signature LVM looks for is described by an entry in
+ * _signatures below.  A probe works out where all the requested
+ * signatures could be on the device, reads those places in as few
+ * aligned requests as possible and then checks each entry against
+ * the data.  Entries of the same type are tried in table order and
+ * the first match wins.
+ */
+
+#define SIGNATURE_ALIGN		4096
+#define SIGNATURE_MASK		(SIGNATURE_ALIGN - 1)
+
+/* Regions closer together than this are read as one */
+#define SIGNATURE_MERGE_GAP	(64 * 1024)
+
+/* Lifted from <linux/raid/md_p.h> because of difficulty including it */
+#define MD_SB_MAGIC 0xa92b4efc
+#define MD_RESERVED_BYTES (64 * 1024ULL)
+#define MD_RESERVED_SECTORS (MD_RESERVED_BYTES / 512)
+#define MD_NEW_SIZE_SECTORS(x) ((x & ~(MD_RESERVED_SECTORS - 1)) \
+				- MD_RESERVED_SECTORS)
+
+#define SWAP_SIGNATURE_SIZE 10
+
+#define LUKS_SIGNATURE "LUKS\xba\xbe"
+#define LUKS_SIGNATURE_SIZE 6
+
+/* See linux/genhd.h and fs/partitions/msdos */
+#define PART_MAGIC 0xAA55
+#define PART_OFFSET UINT64_C(0x1BE)
+
+struct partition {
+	uint8_t boot_ind;
+	uint8_t head;
+	uint8_t sector;
+	uint8_t cyl;
+	uint8_t sys_ind;	/* partition type */
+	uint8_t end_head;
+	uint8_t end_sector;
+	uint8_t end_cyl;
+	uint32_t start_sect;
+	uint32_t nr_sects;
+} __attribute__((packed));
+
+struct signature_def {
+	dev_sig_t type;
+	uint64_t min_size;		/* Bytes */
+	uint64_t offset;		/* Bytes, unless locate is set */
+	uint64_t (*locate)(uint64_t size);	/* Offset given size in sectors */
+	size_t len;
+	int (*match)(const char *buf);
+};
+
+static int _md_match(const char *buf)
+{
+	uint32_t md_magic;
+
+	memcpy(&md_magic, buf, sizeof(md_magic));
+
+	/* Version 1 is little endian; version 0.90.0 is machine endian */
+	return ((md_magic == xlate32(MD_SB_MAGIC)) ||
+		(md_magic == MD_SB_MAGIC)) ? 1 : 0;
+}
+
+/* Version 0.90.0 */
+static uint64_t _md_v0_90_offset(uint64_t size)
+{
+	return MD_NEW_SIZE_SECTORS(size) << SECTOR_SHIFT;
+}
+
+/* Version 1.0: at least 8K, but less than 12K, from end of device */
+static uint64_t _md_v1_0_offset(uint64_t size)
+{
+	return ((size - 8 * 2) & ~(4 * 2 - 1ULL)) << SECTOR_SHIFT;
+}
+
+static int _swap_match(const char *buf)
+{
+	if (memcmp(buf, "SWAP-SPACE", 10) == 0 ||
+            memcmp(buf, "SWAPSPACE2", 10) == 0)
+		return 1;
+
+	if (memcmp(buf, "S1SUSPEND", 9) == 0 ||
+	    memcmp(buf, "S2SUSPEND", 9) == 0 ||
+	    memcmp(buf, "ULSUSPEND", 9) == 0 ||
+	    memcmp(buf, "\xed\xc3\x02\xe9\x98\x56\xe5\x0c", 8) == 0)
+		return 1;
+
+	return 0;
+}
+
+static int _luks_match(const char *buf)
+{
+	return memcmp(buf, LUKS_SIGNATURE, LUKS_SIGNATURE_SIZE) ? 0 : 1;
+}
+
+static int _msdos_match(const char *buf)
+{
+	int ret = 0;
+	unsigned p;
+	struct {
+		uint8_t skip[PART_OFFSET];
+		struct partition part[4];
+		uint16_t magic;
+	} __attribute__((packed)) table; /* sizeof() == SECTOR_SIZE */
+
+	memcpy(&table, buf, sizeof(table));
+
+	if (table.magic != xlate16(PART_MAGIC))
+		return 0;
+
+	for (p = 0; p < 4; ++p) {
+		/* Table is invalid if boot indicator not 0 or 0x80 */
+		if (table.part[p].boot_ind & 0x7f)
+			return 0;
+		/* Must have at least one non-empty partition */
+		if (table.part[p].nr_sects)
+			ret = 1;
+	}
+
+	return ret;
+}
+
+#define MD_SIG(offset, locate) \
+	{ DEV_SIG_MD, MD_RESERVED_BYTES * 2, offset, locate, sizeof(uint32_t), _md_match }
+
+/*
+ * Swap signatures sit at the end of the first page.
+ * 32k pagesize is skipped since this does not seem to be supported.
+ */
+#define SWAP_SIG(page) \
+	{ DEV_SIG_SWAP, page, page - SWAP_SIGNATURE_SIZE, NULL, SWAP_SIGNATURE_SIZE, _swap_match }
+
+static const struct signature_def _signatures[] = {
+	MD_SIG(0, _md_v0_90_offset),
+	MD_SIG(0, _md_v1_0_offset),
+	MD_SIG(0, NULL),		/* Version 1.1: at start of device */
+	MD_SIG(4096, NULL),		/* Version 1.2: 4K from start */
+	SWAP_SIG(0x1000),
+	SWAP_SIG(0x2000),
+	SWAP_SIG(0x4000),
+	SWAP_SIG(0x10000),
+	{ DEV_SIG_LUKS, LUKS_SIGNATURE_SIZE, 0, NULL, LUKS_SIGNATURE_SIZE, _luks_match },
+	{ DEV_SIG_PARTITION_TABLE, SECTOR_SIZE, 0, NULL, SECTOR_SIZE, _msdos_match },
+};
+
+#define NUM_SIGNATURES DM_ARRAY_SIZE(_signatures)
+
+static int _cmp_req(const void *a, const void *b)
+{
+	const struct device_read_req *ra = a, *rb = b;
+
+	if (ra->where.start < rb->where.start)
+		return -1;
+
+	return (ra->where.start > rb->where.start) ? 1 : 0;
+}
+
+static const struct device_read_req *_find_req(const struct device_read_req *reqs,
+					       unsigned count, uint64_t offset,
+					       size_t len)
+{
+	unsigned i;
+
+	for (i = 0; i < count; i++)
+		if (offset >= reqs[i].where.start &&
+		    offset + len <= reqs[i].where.start + reqs[i].where.size)
+			return &reqs[i];
+
+	return NULL;
+}
+
+/*
+ * Look for the signature types in 'types' (a mask of DEV_SIG_MASK()
+ * values) on 'dev'.  Returns 0 if the device could not be examined at
+ * all.  Types whose data could not be read are set in sigs->failed.
+ */
+int dev_probe_signatures(struct device *dev, unsigned types,
+			 struct dev_signatures *sigs)
+{
+	struct device_read_req reqs[NUM_SIGNATURES];
+	uint64_t offsets[NUM_SIGNATURES];
+	const struct signature_def *sd;
+	const struct device_read_req *req;
+	uint64_t size, dev_bytes, end, total = 0;
+	unsigned i, count = 0, merged;
+	char *buf, *aligned;
+
+	memset(sigs, 0, sizeof(*sigs));
+	sigs->probed = types;
+
+	if (!dev_get_size(dev, &size))
+		return_0;
+
+	dev_bytes = size << SECTOR_SHIFT;
+
+	/* Gather the aligned regions that need reading */
+	for (i = 0; i < NUM_SIGNATURES; i++) {
+		sd = &_signatures[i];
+		offsets[i] = UINT64_MAX;
+
+		if (!(types & DEV_SIG_MASK(sd->type)) || dev_bytes < sd->min_size)
+			continue;
+
+		offsets[i] = sd->locate ? sd->locate(size) : sd->offset;
+		if (offsets[i] + sd->len > dev_bytes) {
+			offsets[i] = UINT64_MAX;
+			continue;
+		}
+
+		reqs[count].where.dev = dev;
+		reqs[count].where.start = offsets[i] & ~(uint64_t) SIGNATURE_MASK;
+		end = (offsets[i] + sd->len + SIGNATURE_MASK) & ~(uint64_t) SIGNATURE_MASK;
+		if (end > dev_bytes)
+			end = dev_bytes;
+		reqs[count].where.size = end - reqs[count].where.start;
+		count++;
+	}
+
+	if (!count)
+		return 1;
+
+	/* Coalesce neighbouring regions */
+	qsort(reqs, count, sizeof(*reqs), _cmp_req);
+
+	for (i = 1, merged = 0; i < count; i++) {
+		end = reqs[merged].where.start + reqs[merged].where.size;
+		if (reqs[i].where.start <= end + SIGNATURE_MERGE_GAP) {
+			if (reqs[i].where.start + reqs[i].where.size > end)
+				reqs[merged].where.size = reqs[i].where.start +
+					reqs[i].where.size - reqs[merged].where.start;
+		} else
+			reqs[++merged] = reqs[i];
+	}
+	count = merged + 1;
+
+	for (i = 0; i < count; i++)
+		total += reqs[i].where.size;
+
+	if (!(buf = dm_malloc((size_t) total + SIGNATURE_MASK))) {
+		log_error("Failed to allocate signature probe buffer for %s.",
+			  dev_name(dev));
+		return 0;
+	}
+
+	aligned = (char *) ((((uintptr_t) buf) + SIGNATURE_MASK) &
+			    ~(uintptr_t) SIGNATURE_MASK);
+
+	for (i = 0; i < count; i++) {
+		reqs[i].buf = aligned;
+		reqs[i].result = 0;
+		aligned += reqs[i].where.size;
+	}
+
+	if (!dev_open_readonly(dev)) {
+		dm_free(buf);
+		return_0;
+	}
+
+	log_debug_devs("%s: Probing for signatures with %u read%s.",
+		       dev_name(dev), count, (count == 1) ? "" : "s");
+
+	if (!dev_read_batch(reqs, count))
+		stack;
+
+	for (i = 0; i < count; i++)
+		dev_cache_read_req(&reqs[i]);
+
+	if (!dev_close(dev))
+		stack;
+
+	/* Match every entry against what was read */
+	for (i = 0; i < NUM_SIGNATURES; i++) {
+		sd = &_signatures[i];
+
+		if (offsets[i] == UINT64_MAX ||
+		    (sigs->found & DEV_SIG_MASK(sd->type)))
+			continue;
+
+		if (!(req = _find_req(reqs, count, offsets[i], sd->len)) ||
+		    !req->result) {
+			sigs->failed |= DEV_SIG_MASK(sd->type);
+			continue;
+		}
+
+		if (sd->match(req->buf + (offsets[i] - req->where.start))) {
+			sigs->found |= DEV_SIG_MASK(sd->type);
+			sigs->offset[sd->type] = offsets[i];
+		}
+	}
+
+	dm_free(buf);
+
+	return 1;
+}
+
+/*
+ * Single type probes.
+ * Return 1 if the signature was found, 0 if not and -1 on error.
+ */
+static int _dev_has_signature(struct device *dev, dev_sig_t type,
+			      uint64_t *signature, int read_error)
+{
+	struct dev_signatures sigs;
+
+	if (!dev_probe_signatures(dev, DEV_SIG_MASK(type), &sigs)) {
+		stack;
+		return -1;
+	}
+
+	if (sigs.found & DEV_SIG_MASK(type)) {
+		if (signature)
+			*signature = sigs.offset[type];
+		return 1;
+	}
+
+	if (sigs.failed & DEV_SIG_MASK(type))
+		return read_error;
+
+	return 0;
+}
+
+/*
+ * Returns -1 on error
+ */
+int dev_is_md(struct device *dev, uint64_t *sb)
+{
+	/* An unreadable superblock location is not an md superblock */
+	return _dev_has_signature(dev, DEV_SIG_MD, sb, 0);
+}
+
+int dev_is_swap(struct device *dev, uint64_t *signature)
+{
+	*signature = 0;
+
+	return _dev_has_signature(dev, DEV_SIG_SWAP, signature, -1);
+}
+
+int dev_is_luks(struct device *dev, uint64_t *signature)
+{
+	*signature = 0;
+
+	return _dev_has_signature(dev, DEV_SIG_LUKS, signature, -1);
+}
+
+int dev_has_partition_table(struct device *dev)
+{
+	return (_dev_has_signature(dev, DEV_SIG_PARTITION_TABLE, NULL, 0) == 1);
+}
@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "lib.h"
+#include "dev-type.h"
+
+/* Bumped whenever the snapshot is discarded */
+static unsigned _generation;
+
+unsigned dev_sysfs_map_generation(void)
+{
+	return _generation;
+}
+
+#ifdef linux
+
+#include <dirent.h>
+
+/*
+ * A snapshot of the block devices the kernel knows about, taken from
+ * /sys/dev/block the first time anything asks after a device scan.
+ * It records which devices are partitions of which, and which devices
+ * hold which.  Attributes are read on first use and remembered until
+ * the next scan, so only use it for ones that can't change (the size
+ * can: see dev_sysfs_size()).
+ */
+struct sysfs_attr {
+	struct sysfs_attr *next;
+	const char *name;
+	int present;
+	uint64_t value;
+};
+
+struct sysfs_dev {
+	dev_t dev;
+	dev_t parent;		/* Whole device if this is a partition */
+	int is_partition;
+	unsigned partitions;	/* Number of partitions of this device */
+	unsigned holder_count;
+	dev_t *holders;
+	const char *kname;
+	const char *parent_kname;
+	struct sysfs_attr *attrs;
+	struct sysfs_dev *next;
+};
+
+static struct {
+	struct dm_pool *mem;
+	struct dm_hash_table *devs;	/* Indexed by dev_t */
+	struct sysfs_dev *list;
+	int built;		/* 1 if usable, -1 if sysfs unavailable */
+} _map;
+
+void dev_sysfs_map_exit(void)
+{
+	if (_map.devs)
+		dm_hash_destroy(_map.devs);
+	if (_map.mem)
+		dm_pool_destroy(_map.mem);
+
+	_map.devs = NULL;
+	_map.mem = NULL;
+	_map.list = NULL;
+	_map.built = 0;
+}
+
+void dev_sysfs_map_invalidate(void)
+{
+	if (_map.built)
+		log_debug_devs("Discarding sysfs device snapshot.");
+
+	dev_sysfs_map_exit();
+	_generation++;
+}
+
+static struct sysfs_dev *_find(dev_t dev)
+{
+	return dm_hash_lookup_binary(_map.devs, &dev, sizeof(dev));
+}
+
+static struct sysfs_dev *_find_kname(struct dm_hash_table *knames, const char *kname)
+{
+	return kname ? dm_hash_lookup(knames, kname) : NULL;
+}
+
+/*
+ * The symlink target ends in .../block/<disk> for a whole device
+ * and in .../block/<disk>/<partition> for a partition.
+ */
+static int _add_dev(struct dm_hash_table *knames, const char *sys_block,
+		    const char *entry)
+{
+	char path[PATH_MAX], target[PATH_MAX];
+	struct sysfs_dev *sd;
+	unsigned major, minor;
+	char *kname, *parent;
+	ssize_t len;
+
+	if (sscanf(entry, "%u:%u", &major, &minor) != 2)
+		return 1;
+
+	if (dm_snprintf(path, sizeof(path), "%s/%s", sys_block, entry) < 0)
+		return_0;
+
+	if ((len = readlink(path, target, sizeof(target) - 1)) < 0) {
+		log_sys_very_verbose("readlink", path);
+		return 1;
+	}
+	target[len] = '\0';
+
+	if (!(kname = strrchr(target, '/')))
+		return 1;
+	*kname++ = '\0';
+	parent = strrchr(target, '/');
+	parent = parent ? parent + 1 : target;
+
+	if (!(sd = dm_pool_zalloc(_map.mem, sizeof(*sd))) ||
+	    !(sd->kname = dm_pool_strdup(_map.mem, kname)))
+		return_0;
+
+	if (strcmp(parent, "block") &&
+	    !(sd->parent_kname = dm_pool_strdup(_map.mem, parent)))
+		return_0;
+
+	sd->dev = MKDEV((dev_t)major, minor);
+
+	if (!dm_hash_insert_binary(_map.devs, &sd->dev, sizeof(sd->dev), sd) ||
+	    !dm_hash_insert(knames, sd->kname, sd))
+		return_0;
+
+	sd->next = _map.list;
+	_map.list = sd;
+
+	return 1;
+}
+
+static int _add_holders(struct dm_hash_table *knames, const char *sys_block,
+			struct sysfs_dev *sd)
+{
+	char path[PATH_MAX];
+	struct sysfs_dev *holder;
+	struct dirent *d;
+	unsigned count = 0;
+	DIR *dr;
+	int r = 1;
+
+	if (dm_snprintf(path, sizeof(path), "%s/%d:%d/holders", sys_block,
+			(int) MAJOR(sd->dev), (int) MINOR(sd->dev)) < 0)
+		return_0;
+
+	/* Partitions have no holders directory on some kernels */
+	if (!(dr = opendir(path)))
+		return 1;
+
+	if (!dm_pool_begin_object(_map.mem, 4 * sizeof(dev_t))) {
+		log_error("dm_pool_begin_object failed");
+		r = 0;
+		goto out;
+	}
+
+	while ((d = readdir(dr)))
+		if ((holder = _find_kname(knames, d->d_name))) {
+			if (!dm_pool_grow_object(_map.mem, &holder->dev, sizeof(dev_t))) {
+				log_error("dm_pool_grow_object failed");
+				dm_pool_abandon_object(_map.mem);
+				r = 0;
+				goto out;
+			}
+			count++;
+		}
+
+	if (count) {
+		sd->holders = dm_pool_end_object(_map.mem);
+		sd->holder_count = count;
+	} else
+		dm_pool_abandon_object(_map.mem);
+out:
+	if (closedir(dr))
+		log_sys_debug("closedir", path);
+
+	return r;
+}
+
+static int _build(void)
+{
+	const char *sysfs_dir = dm_sysfs_dir();
+	struct dm_hash_table *knames = NULL;
+	char sys_block[PATH_MAX];
+	struct sysfs_dev *sd, *parent;
+	struct dirent *d;
+	DIR *dr = NULL;
+	int r = 0;
+
+	if (_map.built)
+		return (_map.built > 0);
+
+	_map.built = -1;
+
+	if (!sysfs_dir || !*sysfs_dir)
+		return 0;
+
+	if (dm_snprintf(sys_block, sizeof(sys_block), "%s/dev/block", sysfs_dir) < 0)
+		return_0;
+
+	if (!(dr = opendir(sys_block))) {
+		log_sys_very_verbose("opendir", sys_block);
+		return 0;
+	}
+
+	if (!(_map.mem = dm_pool_create("sysfs device map", 4096)) ||
+	    !(_map.devs = dm_hash_create(128)) ||
+	    !(knames = dm_hash_create(128)))
+		goto_out;
+
+	while ((d = readdir(dr)))
+		if (!_add_dev(knames, sys_block, d->d_name))
+			goto_out;
+
+	for (sd = _map.list; sd; sd = sd->next) {
+		if ((parent = _find_kname(knames, sd->parent_kname))) {
+			sd->is_partition = 1;
+			sd->parent = parent->dev;
+			parent->partitions++;
+		}
+
+		if (!_add_holders(knames, sys_block, sd))
+			goto_out;
+	}
+
+	log_debug_devs("Took sysfs snapshot of block devices.");
+	_map.built = 1;
+	r = 1;
+
+out:
+	if (closedir(dr))
+		log_sys_debug("closedir", sys_block);
+
+	if (knames)
+		dm_hash_destroy(knames);
+
+	if (!r) {
+		dev_sysfs_map_exit();
+		_map.built = -1;
+	}
+
+	return r;
+}
+
+/*
+ * A device that appeared after the snapshot was taken is not in it:
+ * retake the snapshot if sysfs knows the device now.
+ */
+static struct sysfs_dev *_get(dev_t dev)
+{
+	char path[PATH_MAX];
+	struct sysfs_dev *sd;
+
+	if (!_build())
+		return NULL;
+
+	if ((sd = _find(dev)))
+		return sd;
+
+	if (dm_snprintf(path, sizeof(path), "%s/dev/block/%d:%d", dm_sysfs_dir(),
+			(int) MAJOR(dev), (int) MINOR(dev)) < 0 ||
+	    access(path, F_OK))
+		return NULL;
+
+	log_debug_devs("Device %d:%d is missing from sysfs snapshot.",
+		       (int) MAJOR(dev), (int) MINOR(dev));
+	dev_sysfs_map_invalidate();
+
+	return _build() ? _find(dev) : NULL;
+}
+
+/*
+ * Returns 0 if the device is unknown, 1 if it is a whole device
+ * and 2 if it is a partition, with the whole device in 'parent'.
+ */
+int dev_sysfs_parent(dev_t dev, dev_t *parent)
+{
+	struct sysfs_dev *sd;
+
+	if (!(sd = _get(dev)))
+		return 0;
+
+	*parent = sd->is_partition ? sd->parent : dev;
+
+	return sd->is_partition ? 2 : 1;
+}
+
+int dev_sysfs_partition_count(dev_t dev)
+{
+	struct sysfs_dev *sd;
+
+	return (sd = _get(dev)) ? (int) sd->partitions : -1;
+}
+
+int dev_sysfs_holders(dev_t dev, const dev_t **holders)
+{
+	struct sysfs_dev *sd;
+
+	if (!(sd = _get(dev)))
+		return -1;
+
+	*holders = sd->holders;
+
+	return (int) sd->holder_count;
+}
+
+static int _read_attr(dev_t dev, const char *attribute, uint64_t *value)
+{
+	const char *sysfs_dir = dm_sysfs_dir();
+	char path[PATH_MAX], buffer[64];
+	FILE *fp;
+	int r = 0;
+
+	if (dm_snprintf(path, sizeof(path), "%s/dev/block/%d:%d/%s", sysfs_dir,
+			(int) MAJOR(dev), (int) MINOR(dev), attribute) < 0) {
+		log_error("dm_snprintf %s failed", attribute);
+		return 0;
+	}
+
+	if (!(fp = fopen(path, "r"))) {
+		if (errno != ENOENT)
+			log_sys_error("fopen", path);
+		return 0;
+	}
+
+	if (!fgets(buffer, sizeof(buffer), fp))
+		log_sys_error("fgets", path);
+	else if (sscanf(buffer, "%" PRIu64, value) != 1)
+		log_error("sysfs file %s not in expected format: %s", path,
+			  buffer);
+	else
+		r = 1;
+
+	if (fclose(fp))
+		log_sys_error("fclose", path);
+
+	return r;
+}
+
+/*
+ * Numeric sysfs attribute of a device.  Attributes a partition does not
+ * have itself (such as queue/) are taken from its whole device.
+ */
+int dev_sysfs_attribute(dev_t dev, const char *attribute, uint64_t *value)
+{
+	struct sysfs_dev *sd;
+	struct sysfs_attr *sa;
+
+	if (!(sd = _get(dev)))
+		return 0;
+
+	for (sa = sd->attrs; sa; sa = sa->next)
+		if (!strcmp(sa->name, attribute))
+			break;
+
+	if (!sa) {
+		if (!(sa = dm_pool_zalloc(_map.mem, sizeof(*sa))) ||
+		    !(sa->name = dm_pool_strdup(_map.mem, attribute)))
+			return_0;
+
+		sa->present = _read_attr(dev, attribute, &sa->value);
+		sa->next = sd->attrs;
+		sd->attrs = sa;
+	}
+
+	if (sa->present) {
+		*value = sa->value;
+		return 1;
+	}
+
+	if (sd->is_partition)
+		return dev_sysfs_attribute(sd->parent, attribute, value);
+
+	return 0;
+}
+
+#else
+
+void dev_sysfs_map_invalidate(void)
+{
+	_generation++;
+}
+
+void dev_sysfs_map_exit(void)
+{
+}
+
+int dev_sysfs_parent(dev_t dev, dev_t *parent)
+{
+	return 0;
+}
+
+int dev_sysfs_partition_count(dev_t dev)
+{
+	return -1;
+}
+
+int dev_sysfs_holders(dev_t dev, const dev_t **holders)
+{
+	return -1;
+}
+
+int dev_sysfs_attribute(dev_t dev, const char *attribute, uint64_t *value)
+{
+	return 0;
+}
+
+#endif
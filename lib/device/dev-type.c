@@ -246,24 +246,6 @@ int major_is_scsi_device(struct dev_types *dt, int major)
 	return (dt->dev_type_array[major].flags & PARTITION_SCSI_DEVICE) ? 1 : 0;
 }
 
-/* See linux/genhd.h and fs/partitions/msdos */
-#define PART_MAGIC 0xAA55
-#define PART_MAGIC_OFFSET UINT64_C(0x1FE)
-#define PART_OFFSET UINT64_C(0x1BE)
-
-struct partition {
-	uint8_t boot_ind;
-	uint8_t head;
-	uint8_t sector;
-	uint8_t cyl;
-	uint8_t sys_ind;	/* partition type */
-	uint8_t end_head;
-	uint8_t end_sector;
-	uint8_t end_cyl;
-	uint32_t start_sect;
-	uint32_t nr_sects;
-} __attribute__((packed));
-
 static int _is_partitionable(struct dev_types *dt, struct device *dev)
 {
 	int parts = major_max_partitions(dt, MAJOR(dev->dev));
@@ -278,44 +260,16 @@ static int _is_partitionable(struct dev_types *dt, struct device *dev)
 	return 1;
 }
 
-static int _has_partition_table(struct device *dev)
-{
-	int ret = 0;
-	unsigned p;
-	struct {
-		uint8_t skip[PART_OFFSET];
-		struct partition part[4];
-		uint16_t magic;
-	} __attribute__((packed)) buf; /* sizeof() == SECTOR_SIZE */
-
-	if (!dev_read(dev, UINT64_C(0), sizeof(buf), &buf))
-		return_0;
-
-	/* FIXME Check for other types of partition table too */
-
-	/* Check for msdos partition table */
-	if (buf.magic == xlate16(PART_MAGIC)) {
-		for (p = 0; p < 4; ++p) {
-			/* Table is invalid if boot indicator not 0 or 0x80 */
-			if (buf.part[p].boot_ind & 0x7f) {
-				ret = 0;
-				break;
-			}
-			/* Must have at least one non-empty partition */
-			if (buf.part[p].nr_sects)
-				ret = 1;
-		}
-	}
-
-	return ret;
-}
-
 int dev_is_partitioned(struct dev_types *dt, struct device *dev)
 {
 	if (!_is_partitionable(dt, dev))
 		return 0;
 
-	return _has_partition_table(dev);
+	/* Partitions the kernel already found need no read */
+	if (dev_sysfs_partition_count(dev->dev) > 0)
+		return 1;
+
+	return dev_has_partition_table(dev);
 }
 
 /*
@@ -325,14 +279,13 @@ int dev_is_partitioned(struct dev_types *dt, struct device *dev)
  *   A: knowing the number of partitions allowed for the dev and also
  *      which major:minor number represents the primary and partition device
  *      (by using the dev_types->dev_type_array)
- *   B: by the existence of the 'partition' sysfs attribute
- *      (/dev/block/<major>:<minor>/partition)
+ *   B: by where the device sits in sysfs: a partition's directory
+ *      lives inside that of its primary device (see dev-sysfs.c)
  *
  * Method A is tried first, then method B as a fallback if A fails.
  *
- * N.B. Method B can only do the decision based on the pure existence of
- *      the 'partition' sysfs item. There's no direct scan for partition
- *      tables whatsoever!
+ * N.B. Method B only looks at the sysfs layout. There's no direct
+ *      scan for partition tables whatsoever!
  *
  * Returns:
  *   0 on error
@@ -341,15 +294,9 @@ int dev_is_partitioned(struct dev_types *dt, struct device *dev)
  */
 int dev_get_primary_dev(struct dev_types *dt, struct device *dev, dev_t *result)
 {
-	const char *sysfs_dir = dm_sysfs_dir();
 	int major = (int) MAJOR(dev->dev);
 	int minor = (int) MINOR(dev->dev);
-	char path[PATH_MAX+1];
-	char temp_path[PATH_MAX+1];
-	char buffer[64];
-	struct stat info;
-	FILE *fp = NULL;
-	int parts, residue, size, ret = 0;
+	int parts, residue, ret = 0;
 
 	/*
 	 * Try to get the primary dev out of the
@@ -368,159 +315,115 @@ int dev_get_primary_dev(struct dev_types *dt, struct device *dev, dev_t *result)
 
 	/*
 	 * If we can't get the primary dev out of the list of known device
-	 * types, try to look at sysfs directly then. This is more complex
-	 * way and it also requires certain sysfs layout to be present
-	 * which might not be there in old kernels!
+	 * types, look it up in the sysfs snapshot.  Devices missing from
+	 * it are treated as primary devices.
 	 */
-
-	/* check if dev is a partition */
-	if (dm_snprintf(path, PATH_MAX, "%s/dev/block/%d:%d/partition",
-			sysfs_dir, major, minor) < 0) {
-		log_error("dm_snprintf partition failed");
-		goto out;
-	}
-
-	if (stat(path, &info) == -1) {
-		if (errno != ENOENT)
-			log_sys_error("stat", path);
+	if (!(ret = dev_sysfs_parent(dev->dev, result))) {
 		*result = dev->dev;
 		ret = 1;
-		goto out; /* dev is not a partition! */
-
-	}
-
-	/*
-	 * extract parent's path from the partition's symlink, e.g.:
-	 * - readlink /sys/dev/block/259:0 = ../../block/md0/md0p1
-	 * - dirname ../../block/md0/md0p1 = ../../block/md0
-	 * - basename ../../block/md0/md0  = md0
-	 * Parent's 'dev' sysfs attribute  = /sys/block/md0/dev
-	 */
-	if ((size = readlink(dirname(path), temp_path, PATH_MAX)) < 0) {
-		log_sys_error("readlink", path);
-		goto out;
 	}
+out:
+	return ret;
+}
 
-	temp_path[size] = '\0';
-
-	if (dm_snprintf(path, PATH_MAX, "%s/block/%s/dev",
-			sysfs_dir, basename(dirname(temp_path))) < 0) {
-		log_error("dm_snprintf dev failed");
-		goto out;
-	}
+#ifdef UDEV_SYNC_SUPPORT
 
-	/* finally, parse 'dev' attribute and create corresponding dev_t */
-	if (stat(path, &info) == -1) {
-		if (errno == ENOENT)
-			log_error("sysfs file %s does not exist", path);
+int dev_udev_classify(struct dev_types *dt, struct device *dev)
+{
+	struct udev *udev;
+	struct udev_device *device;
+	const char *value;
+	int r = UDEV_DEV_UNKNOWN;
+
+	if (!(udev = udev_get_library_context()) ||
+	    !(device = udev_device_new_from_devnum(udev, 'b', dev->dev)))
+		return UDEV_DEV_UNKNOWN;
+
+	if ((value = udev_device_get_property_value(device, "DM_MULTIPATH_DEVICE_PATH")) &&
+	    !strcmp(value, "1"))
+		r = UDEV_DEV_MPATH_COMPONENT;
+	else if ((MAJOR(dev->dev) == dt->device_mapper_major) &&
+		 (value = udev_device_get_property_value(device, "DM_UUID")) &&
+		 !strncmp(value, UUID_PREFIX, sizeof(UUID_PREFIX) - 1) &&
+		 strchr(value + sizeof(UUID_PREFIX) - 1, '-'))
+		/*
+		 * LV layers (-real, -cow, -tpool...) are private for good.
+		 * DM_UDEV_DISABLE_OTHER_RULES_FLAG is not used: it is also
+		 * set while a device is suspended or not yet set up, and a
+		 * rejection is remembered by the filters.
+		 */
+		r = UDEV_DEV_PRIVATE;
+	else if ((value = udev_device_get_property_value(device, "ID_FS_TYPE")) && *value) {
+		if (!strcmp(value, "LVM2_member"))
+			r = UDEV_DEV_PV;
+		else if (!strcmp(value, "linux_raid_member"))
+			r = UDEV_DEV_MD_COMPONENT;
 		else
-			log_sys_error("stat", path);
-		goto out;
+			r = UDEV_DEV_OTHER;
 	}
 
-	fp = fopen(path, "r");
-	if (!fp) {
-		log_sys_error("fopen", path);
-		goto out;
-	}
+	udev_device_unref(device);
 
-	if (!fgets(buffer, sizeof(buffer), fp)) {
-		log_sys_error("fgets", path);
-		goto out;
-	}
+	return r;
+}
 
-	if (sscanf(buffer, "%d:%d", &major, &minor) != 2) {
-		log_error("sysfs file %s not in expected MAJ:MIN format: %s",
-			  path, buffer);
-		goto out;
-	}
-	*result = MKDEV((dev_t)major, minor);
-	ret = 2;
-out:
-	if (fp && fclose(fp))
-		log_sys_error("fclose", path);
+#else
 
-	return ret;
+int dev_udev_classify(struct dev_types *dt, struct device *dev)
+{
+	return UDEV_DEV_UNKNOWN;
 }
 
+#endif
+
 #ifdef linux
 
-static unsigned long _dev_topology_attribute(struct dev_types *dt,
-					     const char *attribute,
-					     struct device *dev)
+/*
+ * Size in sectors as reported by sysfs, without opening the device.
+ */
+int dev_sysfs_size(struct device *dev, uint64_t *size)
 {
 	const char *sysfs_dir = dm_sysfs_dir();
-	static const char sysfs_fmt_str[] = "%s/dev/block/%d:%d/%s";
-	char path[PATH_MAX+1], buffer[64];
+	char path[PATH_MAX], buffer[64];
 	FILE *fp;
-	struct stat info;
-	dev_t uninitialized_var(primary);
-	unsigned long result = 0UL;
-
-	if (!attribute || !*attribute)
-		return_0;
+	int r = 0;
 
 	if (!sysfs_dir || !*sysfs_dir)
+		return 0;
+
+	if (dm_snprintf(path, sizeof(path), "%s/dev/block/%d:%d/size", sysfs_dir,
+			(int) MAJOR(dev->dev), (int) MINOR(dev->dev)) < 0)
 		return_0;
 
-	if (dm_snprintf(path, PATH_MAX, sysfs_fmt_str, sysfs_dir,
-			(int)MAJOR(dev->dev), (int)MINOR(dev->dev),
-			attribute) < 0) {
-		log_error("dm_snprintf %s failed", attribute);
+	if (!(fp = fopen(path, "r")))
 		return 0;
-	}
 
-	/*
-	 * check if the desired sysfs attribute exists
-	 * - if not: either the kernel doesn't have topology support
-	 *   or the device could be a partition
-	 */
-	if (stat(path, &info) == -1) {
-		if (errno != ENOENT) {
-			log_sys_error("stat", path);
-			return 0;
-		}
-		if (!dev_get_primary_dev(dt, dev, &primary))
-			return 0;
-
-		/* get attribute from partition's primary device */
-		if (dm_snprintf(path, PATH_MAX, sysfs_fmt_str, sysfs_dir,
-				(int)MAJOR(primary), (int)MINOR(primary),
-				attribute) < 0) {
-			log_error("primary dm_snprintf %s failed", attribute);
-			return 0;
-		}
-		if (stat(path, &info) == -1) {
-			if (errno != ENOENT)
-				log_sys_error("stat", path);
-			return 0;
-		}
-	}
+	if (fgets(buffer, sizeof(buffer), fp) &&
+	    sscanf(buffer, "%" PRIu64, size) == 1)
+		r = 1;
 
-	if (!(fp = fopen(path, "r"))) {
-		log_sys_error("fopen", path);
-		return 0;
-	}
+	if (fclose(fp))
+		log_sys_debug("fclose", path);
 
-	if (!fgets(buffer, sizeof(buffer), fp)) {
-		log_sys_error("fgets", path);
-		goto out;
-	}
+	return r;
+}
 
-	if (sscanf(buffer, "%lu", &result) != 1) {
-		log_error("sysfs file %s not in expected format: %s", path,
-			  buffer);
-		goto out;
-	}
+static unsigned long _dev_topology_attribute(struct dev_types *dt,
+					     const char *attribute,
+					     struct device *dev)
+{
+	uint64_t result;
 
-	log_very_verbose("Device %s %s is %lu bytes.",
-			 dev_name(dev), attribute, result);
+	if (!attribute || !*attribute)
+		return_0;
 
-out:
-	if (fclose(fp))
-		log_sys_error("fclose", path);
+	if (!dev_sysfs_attribute(dev->dev, attribute, &result))
+		return 0;
 
-	return result >> SECTOR_SHIFT;
+	log_very_verbose("Device %s %s is %" PRIu64 " bytes.",
+			 dev_name(dev), attribute, result);
+
+	return (unsigned long) (result >> SECTOR_SHIFT);
 }
 
 unsigned long dev_alignment_offset(struct dev_types *dt, struct device *dev)
@@ -550,6 +453,11 @@ unsigned long dev_discard_granularity(struct dev_types *dt, struct device *dev)
 
 #else
 
+int dev_sysfs_size(struct device *dev, uint64_t *size)
+{
+	return 0;
+}
+
 int dev_get_primary_dev(struct dev_types *dt, struct device *dev, dev_t *result)
 {
 	return 0;
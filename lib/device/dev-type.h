@@ -53,10 +53,47 @@ int dev_subsystem_part_major(struct dev_types *dt, struct device *dev);
 const char *dev_subsystem_name(struct dev_types *dt, struct device *dev);
 int major_is_scsi_device(struct dev_types *dt, int major);
 
-/* Signature/superblock recognition with position returned where found. */
+/*
+ * Signature/superblock recognition (dev-signature.c).
+ * A probe reads everything the requested types need in one batch.
+ */
+typedef enum {
+	DEV_SIG_MD,
+	DEV_SIG_SWAP,
+	DEV_SIG_LUKS,
+	DEV_SIG_PARTITION_TABLE,
+	DEV_SIG_COUNT
+} dev_sig_t;
+
+#define DEV_SIG_MASK(type)	(1U << (type))
+
+struct dev_signatures {
+	unsigned probed;	/* Types looked for */
+	unsigned found;		/* Types present */
+	unsigned failed;	/* Types that could not be read */
+	uint64_t offset[DEV_SIG_COUNT];	/* Where each found type is */
+};
+
+int dev_probe_signatures(struct device *dev, unsigned types,
+			 struct dev_signatures *sigs);
+
+/* Single type probes with position returned where found. */
 int dev_is_md(struct device *dev, uint64_t *sb);
 int dev_is_swap(struct device *dev, uint64_t *signature);
 int dev_is_luks(struct device *dev, uint64_t *signature);
+int dev_has_partition_table(struct device *dev);
+
+/*
+ * What the udev database says about a device, without any I/O to it.
+ * Devices udev has not classified are UDEV_DEV_UNKNOWN.
+ */
+#define UDEV_DEV_UNKNOWN	0
+#define UDEV_DEV_PV		1	/* Carries an LVM2 label */
+#define UDEV_DEV_OTHER		2	/* Carries some other known signature */
+#define UDEV_DEV_MD_COMPONENT	3
+#define UDEV_DEV_MPATH_COMPONENT	4
+#define UDEV_DEV_PRIVATE	5	/* LV layer, never used directly */
+int dev_udev_classify(struct dev_types *dt, struct device *dev);
 
 /* Type-specific device properties */
 unsigned long dev_md_stripe_width(struct dev_types *dt, struct device *dev);
@@ -66,7 +103,20 @@ int major_max_partitions(struct dev_types *dt, int major);
 int dev_is_partitioned(struct dev_types *dt, struct device *dev);
 int dev_get_primary_dev(struct dev_types *dt, struct device *dev, dev_t *result);
 
+/*
+ * Snapshot of the sysfs block device graph (dev-sysfs.c).
+ * Built on first use and discarded when the device cache rescans.
+ */
+void dev_sysfs_map_invalidate(void);
+void dev_sysfs_map_exit(void);
+unsigned dev_sysfs_map_generation(void);
+int dev_sysfs_parent(dev_t dev, dev_t *parent);
+int dev_sysfs_partition_count(dev_t dev);
+int dev_sysfs_holders(dev_t dev, const dev_t **holders);
+int dev_sysfs_attribute(dev_t dev, const char *attribute, uint64_t *value);
+
 /* Various device properties */
+int dev_sysfs_size(struct device *dev, uint64_t *size);
 unsigned long dev_alignment_offset(struct dev_types *dt, struct device *dev);
 unsigned long dev_minimum_io_size(struct dev_types *dt, struct device *dev);
 unsigned long dev_optimal_io_size(struct dev_types *dt, struct device *dev);
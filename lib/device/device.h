@@ -27,6 +27,10 @@
 #define DEV_OPENED_EXCL		0x00000010	/* Opened EXCL */
 #define DEV_O_DIRECT		0x00000020	/* Use O_DIRECT */
 #define DEV_O_DIRECT_TESTED	0x00000040	/* DEV_O_DIRECT is reliable */
+#define DEV_NAMES_PENDING	0x00000080	/* Aliases not looked up yet */
+#define DEV_NO_KEEP_OPEN	0x00000100	/* Close as soon as unused */
+#define DEV_KEEP_OPEN_TESTED	0x00000200	/* DEV_NO_KEEP_OPEN is reliable */
+#define DEV_WRITES_QUEUED	0x00000400	/* Has writes in the current batch */
 
 /*
  * All devices in LVM will be represented by one of these.
@@ -46,6 +50,7 @@ struct device {
 	uint32_t flags;
 	uint64_t end;
 	struct dm_list open_list;
+	struct dm_list cached_blocks;	/* Held by the dev-io block cache */
 
 	char pvid[ID_LEN + 1];
 	char _padding[7];
@@ -62,6 +67,17 @@ struct device_area {
 	uint64_t size;		/* Bytes */
 };
 
+/*
+ * One element of a batch of reads submitted together.
+ * Region and buffer should be page aligned so they can be
+ * issued directly against an O_DIRECT descriptor.
+ */
+struct device_read_req {
+	struct device_area where;
+	char *buf;
+	int result;		/* Set to 1 if the read succeeded */
+};
+
 /*
  * All io should use these routines.
  */
@@ -88,10 +104,25 @@ const char *dev_name(const struct device *dev);
 int dev_read(struct device *dev, uint64_t offset, size_t len, void *buffer);
 int dev_read_circular(struct device *dev, uint64_t offset, size_t len,
 		      uint64_t offset2, size_t len2, char *buf);
+int dev_read_batch(struct device_read_req *reqs, unsigned count);
+void dev_cache_read_req(const struct device_read_req *req);
+/* Serve dev_read() from a successful req's buffer until called with NULL */
+void dev_set_read_window(const struct device_read_req *req);
 int dev_write(struct device *dev, uint64_t offset, size_t len, void *buffer);
+
+/*
+ * Writes in between are queued and issued together when the batch ends.
+ * Returns the number of those writes that failed.
+ */
+void dev_write_batch_begin(void);
+unsigned dev_write_batch_end(void);
+/* Writes queued from now on set *failed to 1 if they fail */
+void dev_write_batch_track(int *failed);
+
 int dev_append(struct device *dev, size_t len, char *buffer);
 int dev_set(struct device *dev, uint64_t offset, size_t len, int value);
 void dev_flush(struct device *dev);
+void dev_block_cache_exit(void);
 
 struct device *dev_create_file(const char *filename, struct device *dev,
 			       struct str_list *alias, int use_malloc);
@@ -16,38 +16,174 @@
 #include "lib.h"
 #include "filter.h"
 
+#include <sys/time.h>
+
+/* Reconsider the order of the filters after this many devices */
+#define COMPOSITE_REORDER_INTERVAL 8
+
+struct filter_stats {
+	struct dev_filter *filter;
+	unsigned calls;
+	unsigned rejects;
+	uint64_t usecs;		/* Total time spent in the filter */
+};
+
+/*
+ * Verdict remembered for a device number.  It is only reused until the
+ * device cache next rescans (which retakes the sysfs snapshot) and
+ * while the device keeps the same preferred name.
+ */
+struct filter_verdict {
+	unsigned generation;
+	const char *name;
+	int passes;
+};
+
+struct composite {
+	struct filter_stats *stats;	/* In order of evaluation */
+	unsigned count;
+	unsigned pinned;		/* Leading filters never reordered */
+	unsigned calls;
+	unsigned memo_hits;
+	struct dm_pool *mem;		/* NULL unless memoizing */
+	struct dm_hash_table *verdicts;
+};
+
+/*
+ * For a chain of filters that must all pass, evaluating them in order
+ * of increasing cost per rejection minimises the expected cost.
+ */
+static uint64_t _cost_per_reject(const struct filter_stats *fs)
+{
+	return (fs->usecs + 1) / (fs->rejects + 1);
+}
+
+static uint64_t _now_usecs(void)
+{
+	struct timeval tv;
+
+	if (gettimeofday(&tv, NULL))
+		return 0;
+
+	return (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int _cmp_cost(const void *a, const void *b)
+{
+	uint64_t ca = _cost_per_reject((const struct filter_stats *) a);
+	uint64_t cb = _cost_per_reject((const struct filter_stats *) b);
+
+	return (ca < cb) ? -1 : (ca > cb) ? 1 : 0;
+}
+
+static int _run_filters(struct composite *c, struct device *dev)
+{
+	struct filter_stats *fs;
+	uint64_t start;
+	unsigned i;
+	int r = 1;
+
+	for (i = 0; i < c->count; i++) {
+		fs = &c->stats[i];
+		start = _now_usecs();
+		r = fs->filter->passes_filter(fs->filter, dev);
+		fs->usecs += _now_usecs() - start;
+		fs->calls++;
+		if (!r) {
+			fs->rejects++;
+			break;	/* No 'stack': a filter, not an error. */
+		}
+	}
+
+	if (!(++c->calls % COMPOSITE_REORDER_INTERVAL) && c->count > c->pinned)
+		qsort(c->stats + c->pinned, c->count - c->pinned,
+		      sizeof(*c->stats), _cmp_cost);
+
+	return r;
+}
+
 static int _and_p(struct dev_filter *f, struct device *dev)
 {
-	struct dev_filter **filters;
+	struct composite *c = (struct composite *) f->private;
+	struct filter_verdict *v;
+	unsigned generation = dev_sysfs_map_generation();
+	int r;
 
-	for (filters = (struct dev_filter **) f->private; *filters; ++filters)
-		if (!(*filters)->passes_filter(*filters, dev))
-			return 0;	/* No 'stack': a filter, not an error. */
+	if (!c->verdicts || (dev->flags & DEV_REGULAR))
+		return _run_filters(c, dev);
 
-	return 1;
+	if ((v = dm_hash_lookup_binary(c->verdicts, &dev->dev, sizeof(dev->dev)))) {
+		if (v->generation == generation && v->name == dev_name(dev)) {
+			c->memo_hits++;
+			return v->passes;
+		}
+	} else if (!(v = dm_pool_alloc(c->mem, sizeof(*v))) ||
+		   !dm_hash_insert_binary(c->verdicts, &dev->dev, sizeof(dev->dev), v)) {
+		log_error("Failed to remember filter verdict.");
+		return _run_filters(c, dev);
+	}
+
+	r = _run_filters(c, dev);
+
+	v->generation = generation;
+	v->name = dev_name(dev);
+	v->passes = r;
+
+	return r;
+}
+
+static void _report(struct dev_filter *f)
+{
+	struct composite *c = (struct composite *) f->private;
+	unsigned i;
+
+	for (i = 0; i < c->count; i++)
+		if (c->stats[i].filter->report)
+			c->stats[i].filter->report(c->stats[i].filter);
+
+	if (!c->calls)
+		return;
+
+	for (i = 0; i < c->count; i++)
+		log_verbose("Filter %s: %u devices checked, %u rejected in %"
+			    PRIu64 " us.", c->stats[i].filter->name ? : "unnamed",
+			    c->stats[i].calls, c->stats[i].rejects,
+			    c->stats[i].usecs);
+
+	if (c->verdicts)
+		log_verbose("Filter verdicts reused for %u of %u devices.",
+			    c->memo_hits, c->memo_hits + c->calls);
 }
 
 static void _composite_destroy(struct dev_filter *f)
 {
-	struct dev_filter **filters;
+	struct composite *c = (struct composite *) f->private;
+	unsigned i;
 
 	if (f->use_count)
 		log_error(INTERNAL_ERROR "Destroying composite filter while in use %u times.", f->use_count);
 
-	for (filters = (struct dev_filter **) f->private; *filters; ++filters)
-		(*filters)->destroy(*filters);
+	for (i = 0; i < c->count; i++)
+		c->stats[i].filter->destroy(c->stats[i].filter);
+
+	if (c->verdicts)
+		dm_hash_destroy(c->verdicts);
+	if (c->mem)
+		dm_pool_destroy(c->mem);
 
-	dm_free(f->private);
+	dm_free(c->stats);
+	dm_free(c);
 	dm_free(f);
 }
 
 static int _dump(struct dev_filter *f, int merge_existing)
 {
-	struct dev_filter **filters;
+	struct composite *c = (struct composite *) f->private;
+	unsigned i;
 
-	for (filters = (struct dev_filter **) f->private; *filters; ++filters)
-		if ((*filters)->dump &&
-		    !(*filters)->dump(*filters, merge_existing))
+	for (i = 0; i < c->count; i++)
+		if (c->stats[i].filter->dump &&
+		    !c->stats[i].filter->dump(c->stats[i].filter, merge_existing))
 			return_0;
 
 	return 1;
@@ -55,42 +191,82 @@ static int _dump(struct dev_filter *f, int merge_existing)
 
 static void _wipe(struct dev_filter *f)
 {
-	struct dev_filter **filters;
+	struct composite *c = (struct composite *) f->private;
+	unsigned i;
+
+	for (i = 0; i < c->count; i++)
+		if (c->stats[i].filter->wipe)
+			c->stats[i].filter->wipe(c->stats[i].filter);
+
+	if (!c->verdicts)
+		return;
+
+	dm_hash_destroy(c->verdicts);
+	dm_pool_empty(c->mem);
 
-	for (filters = (struct dev_filter **) f->private; *filters; ++filters)
-		if ((*filters)->wipe)
-			(*filters)->wipe(*filters);
+	if (!(c->verdicts = dm_hash_create(128)))
+		log_error("Composite filter verdict cache reallocation failed.");
 }
 
-struct dev_filter *composite_filter_create(int n, struct dev_filter **filters)
+/*
+ * Devices must pass all the filters.  They start out being applied in
+ * the order given.  The first 'pinned' filters (those that never open
+ * the device) keep their place; the rest get reordered by measured cost
+ * as devices are checked.  If memoize is set, verdicts are remembered per device for
+ * the life of the filter: only set it if every component gives the
+ * same answer for an unchanged device.
+ */
+struct dev_filter *composite_filter_create(int n, int pinned, int memoize,
+					   struct dev_filter **filters)
 {
-	struct dev_filter **filters_copy, *cft;
+	struct dev_filter *cft;
+	struct composite *c;
+	int i;
 
 	if (!filters)
 		return_NULL;
 
-	if (!(filters_copy = dm_malloc(sizeof(*filters) * (n + 1)))) {
+	if (!(c = dm_zalloc(sizeof(*c))) ||
+	    !(c->stats = dm_zalloc(sizeof(*c->stats) * (n + 1)))) {
 		log_error("Composite filters allocation failed.");
+		dm_free(c);
 		return NULL;
 	}
 
-	memcpy(filters_copy, filters, sizeof(*filters) * n);
-	filters_copy[n] = NULL;
+	for (i = 0; i < n; i++)
+		c->stats[i].filter = filters[i];
+	c->count = n;
+	c->pinned = pinned;
+
+	if (memoize &&
+	    (!(c->mem = dm_pool_create("filter verdicts", 1024)) ||
+	     !(c->verdicts = dm_hash_create(128)))) {
+		log_error("Composite filter verdict cache allocation failed.");
+		goto bad;
+	}
 
 	if (!(cft = dm_zalloc(sizeof(*cft)))) {
 		log_error("Composite filters allocation failed.");
-		dm_free(filters_copy);
-		return NULL;
+		goto bad;
 	}
 
 	cft->passes_filter = _and_p;
 	cft->destroy = _composite_destroy;
 	cft->dump = _dump;
 	cft->wipe = _wipe;
+	cft->report = _report;
 	cft->use_count = 0;
-	cft->private = filters_copy;
+	cft->name = "composite";
+	cft->private = c;
 
 	log_debug_devs("Composite filter initialised.");
 
 	return cft;
+
+bad:
+	if (c->mem)
+		dm_pool_destroy(c->mem);
+	dm_free(c->stats);
+	dm_free(c);
+	return NULL;
 }
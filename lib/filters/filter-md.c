@@ -18,14 +18,32 @@
 
 #ifdef linux
 
-static int _ignore_md(struct dev_filter *f __attribute__((unused)),
-		      struct device *dev)
+/* Members of a running array are held by it in sysfs */
+static int _held_by_md(struct dev_types *dt, struct device *dev)
+{
+	const dev_t *holders;
+	int i, count = dev_sysfs_holders(dev->dev, &holders);
+
+	for (i = 0; i < count; i++)
+		if (MAJOR(holders[i]) == dt->md_major)
+			return 1;
+
+	return 0;
+}
+
+static int _ignore_md(struct dev_filter *f, struct device *dev)
 {
 	int ret;
 	
 	if (!md_filtering())
 		return 1;
 	
+	if (_held_by_md((struct dev_types *) f->private, dev)) {
+		log_debug_devs("%s: Skipping md component device (active)",
+			       dev_name(dev));
+		return 0;
+	}
+
 	ret = dev_is_md(dev, NULL);
 
 	if (ret == 1) {
@@ -62,6 +80,7 @@ struct dev_filter *md_filter_create(struct dev_types *dt)
 	f->passes_filter = _ignore_md;
 	f->destroy = _destroy;
 	f->use_count = 0;
+	f->name = "md";
 	f->private = dt;
 
 	log_debug_devs("MD filter initialised.");
@@ -113,14 +113,50 @@ static int get_parent_mpath(const char *dir, char *name, int max_size)
 	return r;
 }
 
-static int dev_is_mpath(struct dev_filter *f, struct device *dev)
+/*
+ * Holder of a device not in the sysfs snapshot, found by walking its
+ * holders directory.
+ */
+static int _get_holder_from_sysfs(struct device *dev, int *major, int *minor)
 {
-	struct dev_types *dt = (struct dev_types *) f->private;
+	const char *sysfs_dir = dm_sysfs_dir();
 	const char *name;
 	char path[PATH_MAX+1];
 	char parent_name[PATH_MAX+1];
 	struct stat info;
-	const char *sysfs_dir = dm_sysfs_dir();
+
+	if (!(name = get_sysfs_name(dev)))
+		return_0;
+
+	if (dm_snprintf(path, PATH_MAX, "%s/block/%s/holders", sysfs_dir, name) < 0) {
+		log_error("Sysfs path to check mpath is too long.");
+		return 0;
+	}
+
+	/* also will filter out partitions */
+	if (stat(path, &info))
+		return 0;
+
+	if (!S_ISDIR(info.st_mode)) {
+		log_error("Path %s is not a directory.", path);
+		return 0;
+	}
+
+	if (!get_parent_mpath(path, parent_name, PATH_MAX))
+		return 0;
+
+	if (!get_sysfs_get_major_minor(sysfs_dir, parent_name, major, minor))
+		return_0;
+
+	return 1;
+}
+
+
+static int dev_is_mpath(struct dev_filter *f, struct device *dev)
+{
+	struct dev_types *dt = (struct dev_types *) f->private;
+	const char *name;
+	const dev_t *holders;
 	int major = MAJOR(dev->dev);
 	int minor = MINOR(dev->dev);
 	dev_t primary_dev;
@@ -158,29 +194,20 @@ static int dev_is_mpath(struct dev_filter *f, struct device *dev)
 			break;
 	}
 
-	if (!(name = get_sysfs_name(dev)))
-		return_0;
-
-	if (dm_snprintf(path, PATH_MAX, "%s/block/%s/holders", sysfs_dir, name) < 0) {
-		log_error("Sysfs path to check mpath is too long.");
-		return 0;
-	}
-
-	/* also will filter out partitions */
-	if (stat(path, &info))
-		return 0;
-
-	if (!S_ISDIR(info.st_mode)) {
-		log_error("Path %s is not a directory.", path);
+	/* There should be only one holder if it is multipath */
+	switch (dev_sysfs_holders(MKDEV((dev_t)major, minor), &holders)) {
+	case -1:
+		if (!_get_holder_from_sysfs(dev, &major, &minor))
+			return 0;
+		break;
+	case 1:
+		major = (int) MAJOR(holders[0]);
+		minor = (int) MINOR(holders[0]);
+		break;
+	default:
 		return 0;
 	}
 
-	if (!get_parent_mpath(path, parent_name, PATH_MAX))
-		return 0;
-
-	if (!get_sysfs_get_major_minor(sysfs_dir, parent_name, &major, &minor))
-		return_0;
-
 	if (major != dt->device_mapper_major)
 		return 0;
 
@@ -223,6 +250,7 @@ struct dev_filter *mpath_filter_create(struct dev_types *dt)
 	f->passes_filter = _ignore_mpath;
 	f->destroy = _destroy;
 	f->use_count = 0;
+	f->name = "mpath";
 	f->private = dt;
 
 	log_debug_devs("mpath filter initialised.");
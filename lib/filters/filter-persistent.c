@@ -309,6 +309,14 @@ static int _lookup_p(struct dev_filter *f, struct device *dev)
 	return (l == PF_BAD_DEVICE) ? 0 : 1;
 }
 
+static void _persistent_report(struct dev_filter *f)
+{
+	struct pfilter *pf = (struct pfilter *) f->private;
+
+	if (pf->real->report)
+		pf->real->report(pf->real);
+}
+
 static void _persistent_destroy(struct dev_filter *f)
 {
 	struct pfilter *pf = (struct pfilter *) f->private;
@@ -362,8 +370,10 @@ struct dev_filter *persistent_filter_create(struct dev_types *dt,
 	f->passes_filter = _lookup_p;
 	f->destroy = _persistent_destroy;
 	f->use_count = 0;
+	f->name = "persistent";
 	f->private = pf;
 	f->wipe = _persistent_filter_wipe;
+	f->report = _persistent_report;
 	f->dump = _persistent_filter_dump;
 
 	log_debug_devs("Persistent filter initialised.");
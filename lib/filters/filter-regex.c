@@ -138,6 +138,13 @@ static int _build_matcher(struct rfilter *rf, const struct dm_config_value *val)
 	if (!(rf->engine = dm_regex_create(rf->mem, (const char * const*) regex,
 					   count)))
 		goto_out;
+
+	/*
+	 * It runs against every alias of every device, so use the flat
+	 * table if the automaton is small enough.
+	 */
+	(void) dm_regex_compile(rf->engine);
+
 	r = 1;
 
       out:
@@ -211,6 +218,7 @@ struct dev_filter *regex_filter_create(const struct dm_config_value *patterns)
 	f->passes_filter = _accept_p;
 	f->destroy = _regex_destroy;
 	f->use_count = 0;
+	f->name = "regex";
 	f->private = rf;
 
 	log_debug_devs("Regex filter initialised.");
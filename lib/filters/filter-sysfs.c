@@ -323,6 +323,7 @@ struct dev_filter *sysfs_filter_create(void)
 	f->passes_filter = _accept_p;
 	f->destroy = _destroy;
 	f->use_count = 0;
+	f->name = "sysfs";
 	f->private = ds;
 
 	log_debug_devs("Sysfs filter initialised.");
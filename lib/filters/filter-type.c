@@ -51,6 +51,7 @@ struct dev_filter *lvm_type_filter_create(struct dev_types *dt)
 	f->passes_filter = _passes_lvm_type_device_filter;
 	f->destroy = _lvm_type_filter_destroy;
 	f->use_count = 0;
+	f->name = "type";
 	f->private = dt;
 
 	log_debug_devs("LVM type filter initialised.");
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "lib.h"
+#include "filter.h"
+
+#ifdef UDEV_SYNC_SUPPORT
+
+struct udev_filter {
+	struct dev_types *dt;
+	int mpath_detection;
+};
+
+/*
+ * Reject the components the md and mpath filters would reject later,
+ * using what udev already knows instead of reading the device.
+ * Devices udev knows nothing about are passed on to those filters.
+ */
+static int _passes_udev_filter(struct dev_filter *f, struct device *dev)
+{
+	struct udev_filter *uf = (struct udev_filter *) f->private;
+
+	switch (dev_udev_classify(uf->dt, dev)) {
+	case UDEV_DEV_MD_COMPONENT:
+		if (!md_filtering())
+			break;
+		log_debug_devs("%s: Skipping md component device (udev)",
+			       dev_name(dev));
+		return 0;
+	case UDEV_DEV_MPATH_COMPONENT:
+		if (!uf->mpath_detection)
+			break;
+		log_debug_devs("%s: Skipping mpath component device (udev)",
+			       dev_name(dev));
+		return 0;
+	case UDEV_DEV_PRIVATE:
+		log_debug_devs("%s: Skipping LV layer device (udev)",
+			       dev_name(dev));
+		return 0;
+	}
+
+	return 1;
+}
+
+static void _udev_filter_destroy(struct dev_filter *f)
+{
+	if (f->use_count)
+		log_error(INTERNAL_ERROR "Destroying udev filter while in use %u times.", f->use_count);
+
+	dm_free(f->private);
+	dm_free(f);
+}
+
+struct dev_filter *udev_filter_create(struct dev_types *dt, int mpath_detection)
+{
+	struct udev_filter *uf;
+	struct dev_filter *f;
+
+	if (!udev_get_library_context()) {
+		log_verbose("No udev library context: udev filter disabled.");
+		return NULL;
+	}
+
+	if (!(f = dm_zalloc(sizeof(*f)))) {
+		log_error("udev filter allocation failed");
+		return NULL;
+	}
+
+	if (!(uf = dm_zalloc(sizeof(*uf)))) {
+		log_error("udev filter private allocation failed");
+		dm_free(f);
+		return NULL;
+	}
+
+	uf->dt = dt;
+	uf->mpath_detection = mpath_detection;
+
+	f->passes_filter = _passes_udev_filter;
+	f->destroy = _udev_filter_destroy;
+	f->use_count = 0;
+	f->name = "udev";
+	f->private = uf;
+
+	log_debug_devs("udev filter initialised.");
+
+	return f;
+}
+
+#else
+
+struct dev_filter *udev_filter_create(struct dev_types *dt, int mpath_detection)
+{
+	log_verbose("Built without udev support: udev filter disabled.");
+	return NULL;
+}
+
+#endif
@@ -20,7 +20,8 @@
 #include "dev-cache.h"
 #include "dev-type.h"
 
-struct dev_filter *composite_filter_create(int n, struct dev_filter **filters);
+struct dev_filter *composite_filter_create(int n, int pinned, int memoize,
+					   struct dev_filter **filters);
 struct dev_filter *lvm_type_filter_create(struct dev_types *dt);
 struct dev_filter *md_filter_create(struct dev_types *dt);
 struct dev_filter *mpath_filter_create(struct dev_types *dt);
@@ -29,6 +30,7 @@ struct dev_filter *persistent_filter_create(struct dev_types *dt,
 					    struct dev_filter *f,
 					    const char *file);
 struct dev_filter *sysfs_filter_create(void);
+struct dev_filter *udev_filter_create(struct dev_types *dt, int mpath_detection);
 
 /*
  * patterns must be an array of strings of the form:
@@ -21,9 +21,12 @@
 #include "lvm-string.h"
 #include "lvm-file.h"
 #include "toolcontext.h"
+#include "crc.h"
+#include "last-path-component.h"
 
 #include <dirent.h>
 #include <unistd.h>
+#include <sys/file.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <time.h>
@@ -40,8 +43,16 @@
  * the volume group name.
  *
  * Backup files that have expired will be removed.
+ *
+ * Each volume group also has an index file '.<vgname>.index' listing
+ * its archives oldest first, one per line:
+ *   <index> <seqno> <checksum> <time archived> <file name>
+ * so that archiving does not need to scan the whole directory.  It is
+ * rebuilt from a directory scan whenever it is missing or out of date.
  */
 
+#define ARCHIVE_INDEX_SUFFIX ".index"
+
 /*
  * A list of these is built up for our volume group.  Ordered
  * with the least recent at the head.
@@ -51,6 +62,9 @@ struct archive_file {
 
 	const char *path;
 	uint32_t index;
+	uint32_t seqno;		/* 0 if not known */
+	uint32_t checksum;	/* Of the VG section */
+	time_t mtime;		/* 0 if not known */
 };
 
 /*
@@ -162,7 +176,7 @@ static struct dm_list *_scan_archive(struct dm_pool *mem,
 		/*
 		 * Create a new archive_file.
 		 */
-		if (!(af = dm_pool_alloc(mem, sizeof(*af)))) {
+		if (!(af = dm_pool_zalloc(mem, sizeof(*af)))) {
 			log_error("Couldn't create new archive file.");
 			results = NULL;
 			goto out;
@@ -185,99 +199,392 @@ static struct dm_list *_scan_archive(struct dm_pool *mem,
 	return results;
 }
 
-static void _remove_expired(struct dm_list *archives, uint32_t archives_size,
-			    uint32_t retain_days, uint32_t min_archive)
+/*
+ * Returns the number of archives dropped from the list.
+ */
+static uint32_t _remove_expired(struct dm_list *archives, uint32_t archives_size,
+				uint32_t retain_days, uint32_t min_archive)
 {
+	struct dm_list *item;
 	struct archive_file *bf;
 	struct stat sb;
 	time_t retain_time;
+	uint32_t removed = 0;
 
 	/* Make sure there are enough archives to even bother looking for
 	 * expired ones... */
 	if (archives_size <= min_archive)
-		return;
+		return 0;
 
 	/* Convert retain_days into the time after which we must retain */
 	retain_time = time(NULL) - (time_t) retain_days *SECS_PER_DAY;
 
 	/* Assume list is ordered newest first (by index) */
-	dm_list_iterate_back_items(bf, archives) {
-		/* Get the mtime of the file and unlink if too old */
-		if (stat(bf->path, &sb)) {
-			log_sys_error("stat", bf->path);
-			continue;
+	while ((archives_size > min_archive) && (item = dm_list_last(archives))) {
+		bf = dm_list_item(item, struct archive_file);
+
+		/* Get the mtime of the file unless the index knows it */
+		if (!bf->mtime) {
+			if (stat(bf->path, &sb)) {
+				if (errno != ENOENT) {
+					log_sys_error("stat", bf->path);
+					break;
+				}
+				/* Already gone */
+				dm_list_del(&bf->list);
+				archives_size--;
+				removed++;
+				continue;
+			}
+			bf->mtime = sb.st_mtime;
 		}
 
-		if (sb.st_mtime > retain_time)
-			return;
+		if (bf->mtime > retain_time)
+			break;
 
 		log_very_verbose("Expiring archive %s", bf->path);
-		if (unlink(bf->path))
+		if (unlink(bf->path) && (errno != ENOENT)) {
 			log_sys_error("unlink", bf->path);
+			break;
+		}
 
-		/* Don't delete any more if we've reached the minimum */
-		if (--archives_size <= min_archive)
-			return;
+		dm_list_del(&bf->list);
+		archives_size--;
+		removed++;
+	}
+
+	return removed;
+}
+
+static char *_index_path(struct dm_pool *mem, const char *dir,
+			 const char *vgname)
+{
+	char name[NAME_LEN + sizeof(ARCHIVE_INDEX_SUFFIX) + 1];
+
+	if (dm_snprintf(name, sizeof(name), ".%s" ARCHIVE_INDEX_SUFFIX,
+			vgname) < 0) {
+		log_error("Archive index name too long.");
+		return NULL;
+	}
+
+	return _join_file_to_dir(mem, dir, name);
+}
+
+/*
+ * Returns the archives listed in the index, newest first, or NULL
+ * if there is no usable index.
+ */
+static struct dm_list *_read_archive_index(struct dm_pool *mem,
+					   const char *vgname, const char *dir,
+					   const char *index_path)
+{
+	FILE *fp;
+	char line[NAME_MAX + 64], file[NAME_MAX + 1], vgname_found[64];
+	unsigned long mtime;
+	uint32_t ix;
+	struct archive_file *af;
+	struct dm_list *results = NULL;
+
+	if (!(fp = fopen(index_path, "r"))) {
+		if (errno != ENOENT)
+			log_sys_debug("fopen", index_path);
+		return NULL;
+	}
+
+	if (!(results = dm_pool_alloc(mem, sizeof(*results))))
+		goto_bad;
+
+	dm_list_init(results);
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (!(af = dm_pool_zalloc(mem, sizeof(*af))))
+			goto_bad;
+
+		if ((sscanf(line, "%" PRIu32 " %" PRIu32 " %" PRIx32 " %lu %255s",
+			    &af->index, &af->seqno, &af->checksum, &mtime,
+			    file) != 5) ||
+		    !_split_vg(file, vgname_found, sizeof(vgname_found), &ix) ||
+		    strcmp(vgname, vgname_found) || (ix != af->index)) {
+			log_debug_metadata("Ignoring invalid archive index %s.",
+					   index_path);
+			goto bad;
+		}
+
+		af->mtime = (time_t) mtime;
+		if (!(af->path = _join_file_to_dir(mem, dir, file)))
+			goto_bad;
+
+		/* The index lists the oldest first */
+		dm_list_add_h(results, &af->list);
+	}
+
+	if (ferror(fp)) {
+		log_sys_debug("fgets", index_path);
+		goto bad;
+	}
+
+	/* Archives might have been removed without updating the index */
+	if (!dm_list_empty(results)) {
+		af = dm_list_item(dm_list_first(results), struct archive_file);
+		if (access(af->path, F_OK)) {
+			log_debug_metadata("Ignoring stale archive index %s.",
+					   index_path);
+			goto bad;
+		}
+	}
+
+	if (fclose(fp))
+		log_sys_debug("fclose", index_path);
+
+	return results;
+
+      bad:
+	if (fclose(fp))
+		log_sys_debug("fclose", index_path);
+
+	return NULL;
+}
+
+static int _print_index_entry(FILE *fp, struct archive_file *af)
+{
+	return fprintf(fp, "%" PRIu32 " %" PRIu32 " %08" PRIx32 " %lu %s\n",
+		       af->index, af->seqno, af->checksum,
+		       (unsigned long) af->mtime,
+		       last_path_component(af->path)) > 0;
+}
+
+static int _write_archive_index(struct cmd_context *cmd, const char *dir,
+				const char *index_path,
+				struct dm_list *archives)
+{
+	int fd;
+	FILE *fp;
+	struct stat sb;
+	struct archive_file *af;
+	char temp_file[PATH_MAX];
+
+	if (!create_temp_name(dir, temp_file, sizeof(temp_file), &fd,
+			      &cmd->rand_seed)) {
+		log_error("Couldn't create temporary archive index name.");
+		return 0;
+	}
+
+	if (!(fp = fdopen(fd, "w"))) {
+		log_sys_error("fdopen", temp_file);
+		if (close(fd))
+			log_sys_error("close", temp_file);
+		goto bad;
+	}
+
+	dm_list_iterate_back_items(af, archives) {
+		if (!af->mtime) {
+			if (stat(af->path, &sb))
+				continue;
+			af->mtime = sb.st_mtime;
+		}
+		if (!_print_index_entry(fp, af))
+			break;
+	}
+
+	if (lvm_fclose(fp, temp_file))
+		goto_bad;
+
+	if (rename(temp_file, index_path)) {
+		log_sys_error("rename", index_path);
+		goto bad;
+	}
+
+	return 1;
+
+      bad:
+	if (unlink(temp_file))
+		log_sys_error("unlink", temp_file);
+
+	return 0;
+}
+
+static int _append_archive_index(const char *index_path,
+				 struct archive_file *af)
+{
+	FILE *fp;
+
+	if (!(fp = fopen(index_path, "a"))) {
+		log_sys_error("fopen", index_path);
+		return 0;
+	}
+
+	if (!_print_index_entry(fp, af))
+		stack;
+
+	if (lvm_fclose(fp, index_path))
+		return_0;
+
+	return 1;
+}
+
+/*
+ * Serialises archive and index updates between commands.
+ */
+static int _lock_archive_dir(const char *dir)
+{
+	int fd;
+
+	if ((fd = open(dir, O_RDONLY)) < 0) {
+		log_sys_error("open", dir);
+		return -1;
+	}
+
+	while (flock(fd, LOCK_EX)) {
+		if (errno == EINTR)
+			continue;
+		log_sys_error("flock", dir);
+		if (close(fd))
+			log_sys_error("close", dir);
+		return -1;
 	}
+
+	return fd;
 }
 
-int archive_vg(struct volume_group *vg,
-	       const char *dir, const char *desc,
-	       uint32_t retain_days, uint32_t min_archive)
+/*
+ * Checksum only the volume group section so that archives of the
+ * same metadata compare equal whatever their description and time.
+ */
+static uint32_t _vg_section_checksum(const char *vgname, const char *buf,
+				     size_t size)
+{
+	char start[NAME_LEN + 5];
+	const char *vg_section = NULL;
+
+	if (dm_snprintf(start, sizeof(start), "\n%s {\n", vgname) >= 0)
+		vg_section = strstr(buf, start);
+
+	if (!vg_section)
+		vg_section = buf;
+
+	return calc_crc(INITIAL_CRC, (const uint8_t *) vg_section,
+			(uint32_t) (size - (vg_section - buf)));
+}
+
+static int _export_vg(struct volume_group *vg, const char *desc,
+		      char **buf, size_t *size)
+{
+	FILE *fp;
+
+	if (!(fp = open_memstream(buf, size))) {
+		log_sys_error("open_memstream", vg->name);
+		return 0;
+	}
+
+	if (!text_vg_export_file(vg, desc, fp)) {
+		if (fclose(fp))
+			stack;
+		free(*buf);
+		return_0;
+	}
+
+	if (fclose(fp)) {
+		log_sys_error("fclose", vg->name);
+		free(*buf);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Returns the archives of the VG newest first, from the index or else
+ * from a directory scan, in which case *rebuild is set.
+ */
+static struct dm_list *_get_archives(struct cmd_context *cmd,
+				     const char *vgname, const char *dir,
+				     const char *index_path, int *rebuild)
 {
-	int i, fd, rnum, renamed = 0;
-	uint32_t ix = 0;
-	struct archive_file *last;
-	FILE *fp = NULL;
-	char temp_file[PATH_MAX], archive_name[PATH_MAX];
 	struct dm_list *archives;
 
+	if ((archives = _read_archive_index(cmd->mem, vgname, dir, index_path)))
+		return archives;
+
+	log_debug_metadata("Rebuilding archive index %s.", index_path);
+	*rebuild = 1;
+
+	return _scan_archive(cmd->mem, vgname, dir);
+}
+
+int archive_vg(struct volume_group *vg, const char *dir, const char *desc)
+{
+	struct cmd_context *cmd = vg->cmd;
+	int i, fd, lock_fd, rnum, renamed = 0, rebuild = 0, r = 0;
+	uint32_t ix = 0, checksum;
+	struct archive_file *last, *af;
+	FILE *fp;
+	char temp_file[PATH_MAX], archive_name[PATH_MAX], *index_path, *buf;
+	size_t size;
+	struct dm_list *archives;
+
+	if (!_export_vg(vg, desc, &buf, &size))
+		return_0;
+
+	checksum = _vg_section_checksum(vg->name, buf, size);
+
+	if ((lock_fd = _lock_archive_dir(dir)) < 0)
+		goto_bad;
+
+	if (!(index_path = _index_path(cmd->mem, dir, vg->name)) ||
+	    !(archives = _get_archives(cmd, vg->name, dir, index_path,
+				       &rebuild)))
+		goto_out;
+
+	if (!dm_list_empty(archives)) {
+		last = dm_list_item(dm_list_first(archives), struct archive_file);
+		ix = last->index + 1;
+
+		if (vg->seqno && (last->seqno == vg->seqno) &&
+		    (last->checksum == checksum)) {
+			log_verbose("Volume group \"%s\" metadata (seqno %u) "
+				    "is already archived.", vg->name, vg->seqno);
+			r = 1;
+			goto out;
+		}
+	}
+
 	/*
 	 * Write the vg out to a temporary file.
 	 */
 	if (!create_temp_name(dir, temp_file, sizeof(temp_file), &fd,
-			      &vg->cmd->rand_seed)) {
+			      &cmd->rand_seed)) {
 		log_error("Couldn't create temporary archive name.");
-		return 0;
+		goto out;
 	}
 
 	if (!(fp = fdopen(fd, "w"))) {
 		log_error("Couldn't create FILE object for archive.");
 		if (close(fd))
 			log_sys_error("close", temp_file);
-		return 0;
+		goto out;
 	}
 
-	if (!text_vg_export_file(vg, desc, fp)) {
+	if (fwrite(buf, size, 1, fp) != 1) {
+		log_sys_error("fwrite", temp_file);
 		if (fclose(fp))
 			log_sys_error("fclose", temp_file);
-		return_0;
+		goto out;
 	}
 
 	if (lvm_fclose(fp, temp_file))
-		return_0; /* Leave file behind as evidence of failure */
+		goto_out; /* Leave file behind as evidence of failure */
 
 	/*
 	 * Now we want to rename this file to <vg>_index.vg.
 	 */
-	if (!(archives = _scan_archive(vg->cmd->mem, vg->name, dir)))
-		return_0;
-
-	if (dm_list_empty(archives))
-		ix = 0;
-	else {
-		last = dm_list_item(dm_list_first(archives), struct archive_file);
-		ix = last->index + 1;
-	}
-
-	rnum = rand_r(&vg->cmd->rand_seed);
+	rnum = rand_r(&cmd->rand_seed);
 
 	for (i = 0; i < 10; i++) {
 		if (dm_snprintf(archive_name, sizeof(archive_name),
 				 "%s/%s_%05u-%d.vg",
 				 dir, vg->name, ix, rnum) < 0) {
 			log_error("Archive file name too long.");
-			return 0;
+			goto out;
 		}
 
 		if ((renamed = lvm_rename(temp_file, archive_name)))
@@ -286,13 +593,72 @@ int archive_vg(struct volume_group *vg,
 		ix++;
 	}
 
-	if (!renamed)
+	if (!renamed) {
 		log_error("Archive rename failed for %s", temp_file);
+		goto out;
+	}
 
-	_remove_expired(archives, dm_list_size(archives) + renamed, retain_days,
-			min_archive);
+	if (!(af = dm_pool_zalloc(cmd->mem, sizeof(*af))) ||
+	    !(af->path = dm_pool_strdup(cmd->mem, archive_name))) {
+		log_error("Couldn't create new archive file.");
+		goto out;
+	}
+	af->index = ix;
+	af->seqno = vg->seqno;
+	af->checksum = checksum;
+	af->mtime = time(NULL);
+	dm_list_add_h(archives, &af->list);
 
-	return 1;
+	/*
+	 * The index must list the new archive before the lock is dropped
+	 * or the next one could be given the same number.  An index that
+	 * cannot be updated is removed so that it gets rebuilt.
+	 */
+	if (rebuild ? !_write_archive_index(cmd, dir, index_path, archives) :
+		      !_append_archive_index(index_path, af)) {
+		stack;
+		if (unlink(index_path) && (errno != ENOENT))
+			log_sys_error("unlink", index_path);
+	}
+
+	r = 1;
+
+      out:
+	if (close(lock_fd))
+		log_sys_error("close", dir);
+      bad:
+	free(buf);
+
+	return r;
+}
+
+int archive_vg_expire(struct cmd_context *cmd, const char *vgname,
+		      const char *dir, uint32_t retain_days,
+		      uint32_t min_archive)
+{
+	int lock_fd, rebuild = 0, r = 0;
+	char *index_path;
+	struct dm_list *archives;
+
+	if ((lock_fd = _lock_archive_dir(dir)) < 0)
+		return_0;
+
+	if (!(index_path = _index_path(cmd->mem, dir, vgname)) ||
+	    !(archives = _get_archives(cmd, vgname, dir, index_path, &rebuild)))
+		goto_out;
+
+	if ((_remove_expired(archives, dm_list_size(archives), retain_days,
+			     min_archive) || rebuild) &&
+	    !_write_archive_index(cmd, dir, index_path, archives))
+		goto_out;
+
+	r = 1;
+
+      out:
+	if (close(lock_fd))
+		log_sys_error("close", dir);
+
+	return r;
 }
 
 static void _display_archive(struct cmd_context *cmd, struct archive_file *af)
@@ -28,6 +28,12 @@ struct archive_params {
 	char *dir;
 	unsigned int keep_days;
 	unsigned int keep_number;
+	struct dm_list expire;	/* VGs archived since archive_expire() */
+};
+
+struct archived_vg {
+	struct dm_list list;
+	char vgname[0];
 };
 
 struct backup_params {
@@ -48,6 +54,7 @@ int archive_init(struct cmd_context *cmd, const char *dir,
 	}
 
 	cmd->archive_params->dir = NULL;
+	dm_list_init(&cmd->archive_params->expire);
 
 	if (!*dir)
 		return 1;
@@ -68,8 +75,10 @@ void archive_exit(struct cmd_context *cmd)
 {
 	if (!cmd->archive_params)
 		return;
+	archive_expire(cmd);
 	dm_free(cmd->archive_params->dir);
 	memset(cmd->archive_params, 0, sizeof(*cmd->archive_params));
+	dm_list_init(&cmd->archive_params->expire);
 }
 
 void archive_enable(struct cmd_context *cmd, int flag)
@@ -96,16 +105,58 @@ static char *_build_desc(struct dm_pool *mem, const char *line, int before)
 	return buffer;
 }
 
+/*
+ * The archive is written before the change.  Expiring old archives is
+ * left to archive_expire().
+ */
 static int __archive(struct volume_group *vg)
 {
+	struct archive_params *params = vg->cmd->archive_params;
+	struct archived_vg *avg;
+	size_t len = strlen(vg->name) + 1;
 	char *desc;
 
 	if (!(desc = _build_desc(vg->cmd->mem, vg->cmd->cmd_line, 1)))
 		return_0;
 
-	return archive_vg(vg, vg->cmd->archive_params->dir, desc,
-			  vg->cmd->archive_params->keep_days,
-			  vg->cmd->archive_params->keep_number);
+	if (!archive_vg(vg, params->dir, desc))
+		return_0;
+
+	dm_list_iterate_items(avg, &params->expire)
+		if (!strcmp(avg->vgname, vg->name))
+			return 1;
+
+	if (!(avg = dm_malloc(sizeof(*avg) + len))) {
+		/* Expired by the next archive of this VG instead */
+		log_debug_metadata("Couldn't queue archive expiry for %s.",
+				   vg->name);
+		return 1;
+	}
+
+	memcpy(avg->vgname, vg->name, len);
+	dm_list_add(&params->expire, &avg->list);
+
+	return 1;
+}
+
+void archive_expire(struct cmd_context *cmd)
+{
+	struct archived_vg *avg, *tmp;
+
+	if (!cmd->archive_params)
+		return;
+
+	dm_list_iterate_items_safe(avg, tmp, &cmd->archive_params->expire) {
+		if (!archive_vg_expire(cmd, avg->vgname,
+				       cmd->archive_params->dir,
+				       cmd->archive_params->keep_days,
+				       cmd->archive_params->keep_number))
+			log_warn("WARNING: Failed to expire old archives of "
+				 "volume group \"%s\".", avg->vgname);
+
+		dm_list_del(&avg->list);
+		dm_free(avg);
+	}
 }
 
 int archive(struct volume_group *vg)
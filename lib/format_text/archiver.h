@@ -38,6 +38,8 @@ void archive_exit(struct cmd_context *cmd);
 
 void archive_enable(struct cmd_context *cmd, int flag);
 int archive(struct volume_group *vg);
+/* Expires old archives of the VGs archived since the last call */
+void archive_expire(struct cmd_context *cmd);
 int archive_display(struct cmd_context *cmd, const char *vg_name);
 int archive_display_file(struct cmd_context *cmd, const char *file);
 
@@ -67,6 +67,7 @@ struct formatter {
 	int indent;		/* current level of indentation */
 	int error;
 	int header;		/* 1 => comments at start; 0 => end */
+	int raw;		/* 1 => buffer without indentation or comments */
 };
 
 static struct utsname _utsname;
@@ -208,6 +209,171 @@ static int _out_with_comment_raw(struct formatter *f,
 	return 1;
 }
 
+/*
+ * Most lines in a VG are "key = value" pairs for PVs, LVs and segments.
+ * Raw output has no indentation or comments, so the functions below
+ * append those straight to the buffer instead of going through
+ * vsnprintf, and fall back to the formatted functions for files.
+ */
+static char *_raw_space(struct formatter *f, size_t len)
+{
+	/* Room for the line, its newline and the terminating NUL */
+	while (f->data.buf.used + len + 2 > f->data.buf.size)
+		if (!_extend_buffer(f))
+			return_NULL;
+
+	return f->data.buf.start + f->data.buf.used;
+}
+
+static char *_raw_str(char *p, const char *str, size_t len)
+{
+	memcpy(p, str, len);
+
+	return p + len;
+}
+
+static char *_raw_uint(char *p, uint64_t value)
+{
+	char digits[20];
+	int i = 0;
+
+	do
+		digits[i++] = '0' + (char) (value % 10);
+	while (value /= 10);
+
+	while (i)
+		*p++ = digits[--i];
+
+	return p;
+}
+
+static int _raw_end(struct formatter *f, char *p)
+{
+	*p++ = '\n';
+	*p = '\0';
+	f->data.buf.used = p - f->data.buf.start;
+
+	return 1;
+}
+
+/* key = "str", or key = str if it is not to be quoted */
+static int _out_str(struct formatter *f, const char *key, const char *str,
+		    int quote)
+{
+	size_t klen, slen;
+	char *p;
+
+	if (!f->raw)
+		return quote ? out_text(f, "%s = \"%s\"", key, str) :
+			       out_text(f, "%s = %s", key, str);
+
+	klen = strlen(key);
+	slen = strlen(str);
+	if (!(p = _raw_space(f, klen + slen + 5)))
+		return_0;
+
+	p = _raw_str(p, key, klen);
+	p = _raw_str(p, " = \"", quote ? 4 : 3);
+	p = _raw_str(p, str, slen);
+	if (quote)
+		*p++ = '"';
+
+	return _raw_end(f, p);
+}
+
+/* key = value, with an optional comment for files */
+static int _out_uint(struct formatter *f, const char *comment,
+		     const char *key, uint64_t value)
+{
+	size_t klen;
+	char *p;
+
+	if (!f->raw)
+		return out_text_with_comment(f, comment, "%s = %" PRIu64,
+					     key, value);
+
+	klen = strlen(key);
+	if (!(p = _raw_space(f, klen + 23)))
+		return_0;
+
+	p = _raw_str(p, key, klen);
+	p = _raw_str(p, " = ", 3);
+	p = _raw_uint(p, value);
+
+	return _raw_end(f, p);
+}
+
+/* key = value, commented with size in sectors for files */
+static int _out_size_uint(struct formatter *f, uint64_t size,
+			  const char *key, uint64_t value)
+{
+	if (!f->raw)
+		return out_size(f, size, "%s = %" PRIu64, key, value);
+
+	return _out_uint(f, NULL, key, value);
+}
+
+/* name { or name<count> { */
+static int _out_open(struct formatter *f, const char *name, int count)
+{
+	size_t len;
+	char *p;
+
+	if (!f->raw)
+		return (count < 0) ? out_text(f, "%s {", name) :
+				     out_text(f, "%s%d {", name, count);
+
+	len = strlen(name);
+	if (!(p = _raw_space(f, len + 22)))
+		return_0;
+
+	p = _raw_str(p, name, len);
+	if (count >= 0)
+		p = _raw_uint(p, (uint64_t) count);
+	p = _raw_str(p, " {", 2);
+
+	return _raw_end(f, p);
+}
+
+static int _out_close(struct formatter *f)
+{
+	char *p;
+
+	if (!f->raw)
+		return out_text(f, "}");
+
+	if (!(p = _raw_space(f, 1)))
+		return_0;
+
+	*p++ = '}';
+
+	return _raw_end(f, p);
+}
+
+/* "name", value, */
+static int _out_area(struct formatter *f, const char *name, uint32_t value,
+		     int last)
+{
+	size_t len;
+	char *p;
+
+	if (!f->raw)
+		return out_text(f, "\"%s\", %u%s", name, value, last ? "" : ",");
+
+	len = strlen(name);
+	if (!(p = _raw_space(f, len + 16)))
+		return_0;
+
+	*p++ = '"';
+	p = _raw_str(p, name, len);
+	p = _raw_str(p, "\", ", 3);
+	p = _raw_uint(p, value);
+	if (!last)
+		*p++ = ',';
+
+	return _raw_end(f, p);
+}
+
 /*
  * Formats a string, converting a size specified
  * in 512-byte sectors to a more human readable
@@ -266,7 +432,10 @@ int out_size(struct formatter *f, uint64_t size, const char *fmt, ...)
 	va_list ap;
 	int r;
 
-	if (!_sectors_to_units(size, buffer, sizeof(buffer)))
+	/* Raw output drops comments so don't bother formatting one */
+	if (f->raw)
+		buffer[0] = '\0';
+	else if (!_sectors_to_units(size, buffer, sizeof(buffer)))
 		return 0;
 
 	_out_with_comment(f, buffer, fmt, ap);
@@ -355,13 +524,13 @@ static int _print_header(struct formatter *f,
 static int _print_flag_config(struct formatter *f, uint64_t status, int type)
 {
 	char buffer[4096];
-	if (!print_flags(status, type | STATUS_FLAG, buffer, sizeof(buffer)))
+	if (!print_flags(status, type | STATUS_FLAG, buffer, sizeof(buffer)) ||
+	    !_out_str(f, "status", buffer, 0))
 		return_0;
-	outf(f, "status = %s", buffer);
 
-	if (!print_flags(status, type, buffer, sizeof(buffer)))
+	if (!print_flags(status, type, buffer, sizeof(buffer)) ||
+	    !_out_str(f, "flags", buffer, 0))
 		return_0;
-	outf(f, "flags = %s", buffer);
 
 	return 1;
 }
@@ -374,7 +543,7 @@ static int _out_tags(struct formatter *f, struct dm_list *tags)
 	if (!dm_list_empty(tags)) {
 		if (!(tag_buffer = alloc_printed_tags(tags)))
 			return_0;
-		if (!out_text(f, "tags = %s", tag_buffer)) {
+		if (!_out_str(f, "tags", tag_buffer, 0)) {
 			dm_free(tag_buffer);
 			return_0;
 		}
@@ -511,15 +680,18 @@ static int _print_pvs(struct formatter *f, struct volume_group *vg)
 static int _print_segment(struct formatter *f, struct volume_group *vg,
 			  int count, struct lv_segment *seg)
 {
-	outf(f, "segment%u {", count);
+	if (!_out_open(f, "segment", count))
+		return_0;
 	_inc_indent(f);
 
-	outf(f, "start_extent = %u", seg->le);
-	outsize(f, (uint64_t) seg->len * vg->extent_size,
-		"extent_count = %u", seg->len);
+	if (!_out_uint(f, NULL, "start_extent", seg->le) ||
+	    !_out_size_uint(f, (uint64_t) seg->len * vg->extent_size,
+			    "extent_count", seg->len))
+		return_0;
 
 	outnl(f);
-	outf(f, "type = \"%s\"", seg->segtype->name);
+	if (!_out_str(f, "type", seg->segtype->name, 1))
+		return_0;
 
 	if (!_out_tags(f, &seg->tags))
 		return_0;
@@ -529,7 +701,8 @@ static int _print_segment(struct formatter *f, struct volume_group *vg,
 		return_0;
 
 	_dec_indent(f);
-	outf(f, "}");
+	if (!_out_close(f))
+		return_0;
 
 	return 1;
 }
@@ -548,19 +721,17 @@ int out_areas(struct formatter *f, const struct lv_segment *seg,
 	for (s = 0; s < seg->area_count; s++) {
 		switch (seg_type(seg, s)) {
 		case AREA_PV:
-			if (!(name = _get_pv_name(f, seg_pv(seg, s))))
+			if (!(name = _get_pv_name(f, seg_pv(seg, s))) ||
+			    !_out_area(f, name, seg_pe(seg, s),
+				       s == seg->area_count - 1))
 				return_0;
-
-			outf(f, "\"%s\", %u%s", name,
-			     seg_pe(seg, s),
-			     (s == seg->area_count - 1) ? "" : ",");
 			break;
 		case AREA_LV:
 			if (!(seg->status & RAID)) {
-				outf(f, "\"%s\", %u%s",
-				     seg_lv(seg, s)->name,
-				     seg_le(seg, s),
-				     (s == seg->area_count - 1) ? "" : ",");
+				if (!_out_area(f, seg_lv(seg, s)->name,
+					       seg_le(seg, s),
+					       s == seg->area_count - 1))
+					return_0;
 				continue;
 			}
 
@@ -595,15 +766,15 @@ static int _print_lv(struct formatter *f, struct logical_volume *lv)
 	time_t ts;
 
 	outnl(f);
-	outf(f, "%s {", lv->name);
+	if (!_out_open(f, lv->name, -1))
+		return_0;
 	_inc_indent(f);
 
 	/* FIXME: Write full lvid */
-	if (!id_write_format(&lv->lvid.id[1], buffer, sizeof(buffer)))
+	if (!id_write_format(&lv->lvid.id[1], buffer, sizeof(buffer)) ||
+	    !_out_str(f, "id", buffer, 1))
 		return_0;
 
-	outf(f, "id = \"%s\"", buffer);
-
 	if (!_print_flag_config(f, lv->status, LV_FLAGS))
 		return_0;
 
@@ -611,16 +782,20 @@ static int _print_lv(struct formatter *f, struct logical_volume *lv)
 		return_0;
 
 	if (lv->timestamp) {
-		ts = (time_t)lv->timestamp;
-		strncpy(buffer, "# ", sizeof(buffer));
-		if (!(local_tm = localtime(&ts)) ||
-		    !strftime(buffer + 2, sizeof(buffer) - 2,
-			      "%Y-%m-%d %T %z", local_tm))
-			buffer[0] = 0;
-
-		outf(f, "creation_host = \"%s\"", lv->hostname);
-		outfc(f, buffer, "creation_time = %" PRIu64,
-		      lv->timestamp);
+		/* localtime() is costly and only feeds a comment */
+		buffer[0] = 0;
+		if (!f->raw) {
+			ts = (time_t)lv->timestamp;
+			strncpy(buffer, "# ", sizeof(buffer));
+			if (!(local_tm = localtime(&ts)) ||
+			    !strftime(buffer + 2, sizeof(buffer) - 2,
+				      "%Y-%m-%d %T %z", local_tm))
+				buffer[0] = 0;
+		}
+
+		if (!_out_str(f, "creation_host", lv->hostname, 1) ||
+		    !_out_uint(f, buffer, "creation_time", lv->timestamp))
+			return_0;
 	}
 
 	if (lv->alloc != ALLOC_INHERIT)
@@ -645,7 +820,8 @@ static int _print_lv(struct formatter *f, struct logical_volume *lv)
 		outf(f, "major = %d", lv->major);
 	if (lv->minor >= 0)
 		outf(f, "minor = %d", lv->minor);
-	outf(f, "segment_count = %u", dm_list_size(&lv->segments));
+	if (!_out_uint(f, NULL, "segment_count", dm_list_size(&lv->segments)))
+		return_0;
 	outnl(f);
 
 	seg_count = 1;
@@ -655,7 +831,8 @@ static int _print_lv(struct formatter *f, struct logical_volume *lv)
 	}
 
 	_dec_indent(f);
-	outf(f, "}");
+	if (!_out_close(f))
+		return_0;
 
 	return 1;
 }
@@ -808,8 +985,30 @@ int text_vg_export_file(struct volume_group *vg, const char *desc, FILE *fp)
 	return r;
 }
 
-/* Returns amount of buffer used incl. terminating NUL */
-size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf)
+/*
+ * Generous estimate of the raw metadata size so that the output buffer
+ * normally needs allocating only once.
+ */
+static size_t _raw_size_estimate(struct volume_group *vg)
+{
+	struct lv_list *lvl;
+	struct lv_segment *seg;
+	struct str_list *sl;
+	size_t size = 1024 + 256 * dm_list_size(&vg->pvs);
+
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		size += 192 + strlen(lvl->lv->name);
+		dm_list_iterate_items(sl, &lvl->lv->tags)
+			size += 4 + strlen(sl->str);
+		dm_list_iterate_items(seg, &lvl->lv->segments)
+			size += 192 + 64 * seg->area_count;
+	}
+
+	return size;
+}
+
+static size_t _text_vg_export_raw(struct volume_group *vg, const char *desc,
+				  char **buf, int fast)
 {
 	struct formatter *f;
 	size_t r = 0;
@@ -819,7 +1018,7 @@ size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf)
 	if (!(f = dm_zalloc(sizeof(*f))))
 		return_0;
 
-	f->data.buf.size = 65536;	/* Initial metadata limit */
+	f->data.buf.size = fast ? _raw_size_estimate(vg) : 65536;
 	if (!(f->data.buf.start = dm_malloc(f->data.buf.size))) {
 		log_error("text_export buffer allocation failed");
 		goto out;
@@ -827,6 +1026,7 @@ size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf)
 
 	f->indent = 0;
 	f->header = 0;
+	f->raw = fast;
 	f->out_with_comment = &_out_with_comment_raw;
 	f->nl = &_nl_raw;
 
@@ -843,6 +1043,22 @@ size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf)
 	return r;
 }
 
+/* Returns amount of buffer used incl. terminating NUL */
+size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf)
+{
+	return _text_vg_export_raw(vg, desc, buf, 1);
+}
+
+/*
+ * Same output formatted through out_text() and a buffer grown from 64k.
+ * Only used to compare against by unit-tests/metadata/export_bench.
+ */
+size_t text_vg_export_raw_printf(struct volume_group *vg, const char *desc,
+				 char **buf)
+{
+	return _text_vg_export_raw(vg, desc, buf, 0);
+}
+
 size_t export_vg_to_buffer(struct volume_group *vg, char **buf)
 {
 	return text_vg_export_raw(vg, "", buf);
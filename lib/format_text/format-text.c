@@ -29,6 +29,7 @@
 #include "label.h"
 #include "lvmcache.h"
 #include "lvmetad.h"
+#include "lvm-compress.h"
 
 #include <unistd.h>
 #include <sys/param.h>
@@ -42,6 +43,7 @@ static struct format_instance *_text_create_text_instance(const struct format_ty
 struct text_fid_context {
 	char *raw_metadata_buf;
 	uint32_t raw_metadata_buf_size;
+	unsigned raw_metadata_compressed;
 };
 
 struct dir_list {
@@ -513,11 +515,13 @@ static struct volume_group *_vg_read_raw_area(struct format_instance *fid,
 				     (off_t) (area->start + rlocn->offset),
 				     (uint32_t) (rlocn->size - wrap),
 				     (off_t) (area->start + MDA_HEADER_SIZE),
-				     wrap, calc_crc, rlocn->checksum, &when,
+				     wrap, calc_crc, rlocn->checksum,
+				     rlocn->flags & RAW_LOCN_COMPRESSED, &when,
 				     &desc)))
 		goto_out;
-	log_debug_metadata("Read %s %smetadata (%u) from %s at %" PRIu64 " size %"
+	log_debug_metadata("Read %s %s%smetadata (%u) from %s at %" PRIu64 " size %"
 			   PRIu64, vg->name, precommitted ? "pre-commit " : "",
+			   rlocn->flags & RAW_LOCN_COMPRESSED ? "compressed " : "",
 			   vg->seqno, dev_name(area->dev),
 			   area->start + rlocn->offset, rlocn->size);
 
@@ -565,6 +569,40 @@ static struct volume_group *_vg_read_precommit_raw(struct format_instance *fid,
 	return vg;
 }
 
+/*
+ * Replace the exported metadata text with its compressed form.
+ * Falls back to plain text if compression support is not compiled in.
+ */
+static int _compress_raw_metadata(struct text_fid_context *fidtc,
+				  const char *vgname)
+{
+	char *buf;
+	uint32_t size;
+
+	if (!metadata_compression_supported()) {
+		log_warn("WARNING: Ignoring metadata/compress: support "
+			    "not compiled in.");
+		return 1;
+	}
+
+	if (!compress_metadata(vgname, fidtc->raw_metadata_buf,
+			       fidtc->raw_metadata_buf_size, &buf, &size)) {
+		log_error("VG %s metadata compression failed", vgname);
+		return 0;
+	}
+
+	log_debug_metadata("Compressed %s metadata from %" PRIu32 " to %"
+			   PRIu32 " bytes", vgname,
+			   fidtc->raw_metadata_buf_size, size);
+
+	dm_free(fidtc->raw_metadata_buf);
+	fidtc->raw_metadata_buf = buf;
+	fidtc->raw_metadata_buf_size = size;
+	fidtc->raw_metadata_compressed = 1;
+
+	return 1;
+}
+
 static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 			 struct metadata_area *mda)
 {
@@ -599,14 +637,20 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 			vg->old_name ? vg->old_name : vg->name, &noprecommit);
 	mdac->rlocn.offset = _next_rlocn_offset(rlocn, mdah);
 
-	if (!fidtc->raw_metadata_buf &&
-	    !(fidtc->raw_metadata_buf_size =
+	if (!fidtc->raw_metadata_buf) {
+		if (!(fidtc->raw_metadata_buf_size =
 			text_vg_export_raw(vg, "", &fidtc->raw_metadata_buf))) {
-		log_error("VG %s metadata writing failed", vg->name);
-		goto out;
+			log_error("VG %s metadata writing failed", vg->name);
+			goto out;
+		}
+		fidtc->raw_metadata_compressed = 0;
+		if (find_config_tree_bool(fid->fmt->cmd, metadata_compress_CFG, NULL) &&
+		    !_compress_raw_metadata(fidtc, vg->name))
+			goto_out;
 	}
 
 	mdac->rlocn.size = fidtc->raw_metadata_buf_size;
+	mdac->rlocn.flags = fidtc->raw_metadata_compressed ? RAW_LOCN_COMPRESSED : 0;
 
 	if (mdac->rlocn.offset + mdac->rlocn.size > mdah->size)
 		new_wrap = (mdac->rlocn.offset + mdac->rlocn.size) - mdah->size;
@@ -625,8 +669,9 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 		goto out;
 	}
 
-	log_debug_metadata("Writing %s metadata to %s at %" PRIu64 " len %" PRIu64,
-			    vg->name, dev_name(mdac->area.dev), mdac->area.start +
+	log_debug_metadata("Writing %s %smetadata to %s at %" PRIu64 " len %" PRIu64,
+			    vg->name, fidtc->raw_metadata_compressed ? "compressed " : "",
+			    dev_name(mdac->area.dev), mdac->area.start +
 			    mdac->rlocn.offset, mdac->rlocn.size - new_wrap);
 
 	/* Write text out, circularly */
@@ -707,12 +752,15 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 		mdah->raw_locns[0].offset = 0;
 		mdah->raw_locns[0].size = 0;
 		mdah->raw_locns[0].checksum = 0;
+		mdah->raw_locns[0].flags &= ~RAW_LOCN_COMPRESSED;
 		mdah->raw_locns[1].offset = 0;
 		mdah->raw_locns[1].size = 0;
 		mdah->raw_locns[1].checksum = 0;
+		mdah->raw_locns[1].flags = 0;
 		mdah->raw_locns[2].offset = 0;
 		mdah->raw_locns[2].size = 0;
 		mdah->raw_locns[2].checksum = 0;
+		mdah->raw_locns[2].flags = 0;
 		rlocn = &mdah->raw_locns[0];
 	}
 
@@ -723,6 +771,7 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 		mdah->raw_locns[1].offset = 0;
 		mdah->raw_locns[1].size = 0;
 		mdah->raw_locns[1].checksum = 0;
+		mdah->raw_locns[1].flags = 0;
 	}
 
 	/* Is there new metadata to commit? */
@@ -730,6 +779,9 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 		rlocn->offset = mdac->rlocn.offset;
 		rlocn->size = mdac->rlocn.size;
 		rlocn->checksum = mdac->rlocn.checksum;
+		/* Slot 0 also carries the ignored flag */
+		rlocn->flags = (rlocn->flags & ~RAW_LOCN_COMPRESSED) |
+			       (mdac->rlocn.flags & RAW_LOCN_COMPRESSED);
 		log_debug_metadata("%sCommitting %s metadata (%u) to %s header at %"
 			  PRIu64, precommit ? "Pre-" : "", vg->name, vg->seqno,
 			  dev_name(mdac->area.dev), mdac->area.start);
@@ -822,6 +874,7 @@ static int _vg_remove_raw(struct format_instance *fid, struct volume_group *vg,
 	rlocn->offset = 0;
 	rlocn->size = 0;
 	rlocn->checksum = 0;
+	rlocn->flags &= ~RAW_LOCN_COMPRESSED;
 	rlocn_set_ignored(mdah->raw_locns, mda_is_ignored(mda));
 
 	if (!_raw_write_mda_header(fid->fmt, mdac->area.dev, mdac->area.start,
@@ -1173,6 +1226,7 @@ const char *vgname_from_mda(const struct format_type *fmt,
 					  (off_t) (dev_area->start +
 						   MDA_HEADER_SIZE),
 					  wrap, calc_crc, rlocn->checksum,
+					  rlocn->flags & RAW_LOCN_COMPRESSED,
 					  vgid, vgstatus, creation_host)))
 		goto_out;
 
@@ -1850,6 +1904,7 @@ static int _create_vg_text_instance(struct format_instance *fid,
 	}
 
 	fidtc->raw_metadata_buf = NULL;
+	fidtc->raw_metadata_compressed = 0;
 	fid->private = (void *) fidtc;
 
 	if (type & FMT_INSTANCE_PRIVATE_MDAS) {
@@ -25,14 +25,16 @@
 #define FMT_TEXT_MAX_MDAS_PER_PV 2
 
 /*
- * Archives a vg config.  'retain_days' is the minimum number of
- * days that an archive file must be held for.  'min_archives' is
- * the minimum number of archives required to be kept for each
- * volume group.
+ * Archives a vg config.  Old archives are only expired by
+ * archive_vg_expire(), which can run once the change is done.
+ * 'retain_days' is the minimum number of days that an archive file
+ * must be held for.  'min_archives' is the minimum number of archives
+ * required to be kept for each volume group.
  */
-int archive_vg(struct volume_group *vg,
-	       const char *dir,
-	       const char *desc, uint32_t retain_days, uint32_t min_archive);
+int archive_vg(struct volume_group *vg, const char *dir, const char *desc);
+int archive_vg_expire(struct cmd_context *cmd, const char *vgname,
+		      const char *dir, uint32_t retain_days,
+		      uint32_t min_archive);
 
 /*
  * Displays a list of vg backups in a particular archive directory.
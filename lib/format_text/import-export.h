@@ -43,11 +43,26 @@ enum {
 	STATUS_FLAG = 0x8,
 };
 
+struct text_vg_stream;
+
 struct text_vg_version_ops {
 	int (*check_version) (const struct dm_config_tree * cf);
 	struct volume_group *(*read_vg) (struct format_instance * fid,
 					 const struct dm_config_tree *cf,
 					 unsigned use_cached_pvs);
+	/*
+	 * Streaming variant of read_vg: stream_check looks for a version
+	 * it can read in the unparsed text, stream_section is the
+	 * dm_config_section_fn to parse with and consumes what it can,
+	 * stream_end reads whatever is left in the tree.  stream_end
+	 * with a NULL tree just releases the stream.
+	 */
+	struct text_vg_stream *(*stream_begin) (struct format_instance * fid,
+						unsigned use_cached_pvs);
+	int (*stream_check) (const char *start, const char *end, void *baton);
+	int (*stream_section) (const struct dm_config_node *cn, void *baton);
+	struct volume_group *(*stream_end) (struct text_vg_stream *vs,
+					    const struct dm_config_tree *cf);
 	void (*read_desc) (struct dm_pool * mem, const struct dm_config_tree *cf,
 			   time_t *when, char **desc);
 	const char *(*read_vgname) (const struct format_type *fmt,
@@ -66,6 +81,8 @@ int read_tags(struct dm_pool *mem, struct dm_list *tags, const struct dm_config_
 
 int text_vg_export_file(struct volume_group *vg, const char *desc, FILE *fp);
 size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf);
+size_t text_vg_export_raw_printf(struct volume_group *vg, const char *desc,
+				 char **buf);
 struct volume_group *text_vg_import_file(struct format_instance *fid,
 					 const char *file,
 					 time_t *when, char **desc);
@@ -76,13 +93,14 @@ struct volume_group *text_vg_import_fd(struct format_instance *fid,
 				       off_t offset, uint32_t size,
 				       off_t offset2, uint32_t size2,
 				       checksum_fn_t checksum_fn,
-				       uint32_t checksum,
+				       uint32_t checksum, unsigned compressed,
 				       time_t *when, char **desc);
 const char *text_vgname_import(const struct format_type *fmt,
 			       struct device *dev,
                                off_t offset, uint32_t size,
                                off_t offset2, uint32_t size2,
                                checksum_fn_t checksum_fn, uint32_t checksum,
+                               unsigned compressed,
                                struct id *vgid, uint64_t *vgstatus,
 			       char **creation_host);
 
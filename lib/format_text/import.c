@@ -37,6 +37,7 @@ const char *text_vgname_import(const struct format_type *fmt,
 			       off_t offset, uint32_t size,
 			       off_t offset2, uint32_t size2,
 			       checksum_fn_t checksum_fn, uint32_t checksum,
+			       unsigned compressed,
 			       struct id *vgid, uint64_t *vgstatus,
 			       char **creation_host)
 {
@@ -50,8 +51,9 @@ const char *text_vgname_import(const struct format_type *fmt,
 		return_NULL;
 
 	if ((!dev && !config_file_read(cft)) ||
-	    (dev && !config_file_read_fd(cft, dev, offset, size,
-					 offset2, size2, checksum_fn, checksum)))
+	    (dev && !config_file_read_fd_sections(cft, dev, offset, size,
+						  offset2, size2, checksum_fn, checksum,
+						  compressed, NULL, NULL, NULL)))
 		goto_out;
 
 	/*
@@ -80,12 +82,14 @@ struct volume_group *text_vg_import_fd(struct format_instance *fid,
 				       off_t offset, uint32_t size,
 				       off_t offset2, uint32_t size2,
 				       checksum_fn_t checksum_fn,
-				       uint32_t checksum,
+				       uint32_t checksum, unsigned compressed,
 				       time_t *when, char **desc)
 {
 	struct volume_group *vg = NULL;
 	struct dm_config_tree *cft;
 	struct text_vg_version_ops **vsn;
+	struct text_vg_version_ops *stream_vsn = NULL;
+	struct text_vg_stream *vs = NULL;
 
 	_init_text_import();
 
@@ -95,9 +99,24 @@ struct volume_group *text_vg_import_fd(struct format_instance *fid,
 	if (!(cft = config_open(CONFIG_FILE, file, 0)))
 		return_NULL;
 
+	/*
+	 * Metadata areas are streamed into the current version's importer
+	 * while they are parsed, provided it recognises the version fields
+	 * in the text before parsing starts.
+	 */
+	if (dev && _text_vsn_list[0]->stream_begin) {
+		stream_vsn = _text_vsn_list[0];
+		if (!(vs = stream_vsn->stream_begin(fid, single_device)))
+			goto_out;
+	}
+
 	if ((!dev && !config_file_read(cft)) ||
-	    (dev && !config_file_read_fd(cft, dev, offset, size,
-					 offset2, size2, checksum_fn, checksum))) {
+	    (dev && !config_file_read_fd_sections(cft, dev, offset, size,
+						  offset2, size2, checksum_fn, checksum,
+						  compressed,
+						  vs ? stream_vsn->stream_check : NULL,
+						  vs ? stream_vsn->stream_section : NULL,
+						  vs))) {
 		log_error("Couldn't read volume group metadata.");
 		goto out;
 	}
@@ -109,7 +128,13 @@ struct volume_group *text_vg_import_fd(struct format_instance *fid,
 		if (!(*vsn)->check_version(cft))
 			continue;
 
-		if (!(vg = (*vsn)->read_vg(fid, cft, single_device)))
+		if (vs && *vsn == stream_vsn) {
+			vg = stream_vsn->stream_end(vs, cft);
+			vs = NULL;
+		} else
+			vg = (*vsn)->read_vg(fid, cft, single_device);
+
+		if (!vg)
 			goto_out;
 
 		(*vsn)->read_desc(vg->vgmem, cft, when, desc);
@@ -117,6 +142,8 @@ struct volume_group *text_vg_import_fd(struct format_instance *fid,
 	}
 
       out:
+	if (vs)
+		stream_vsn->stream_end(vs, NULL);
 	config_destroy(cft);
 	return vg;
 }
@@ -125,7 +152,7 @@ struct volume_group *text_vg_import_file(struct format_instance *fid,
 					 const char *file,
 					 time_t *when, char **desc)
 {
-	return text_vg_import_fd(fid, file, 0, NULL, (off_t)0, 0, (off_t)0, 0, NULL, 0,
+	return text_vg_import_fd(fid, file, 0, NULL, (off_t)0, 0, (off_t)0, 0, NULL, 0, 0,
 				 when, desc);
 }
 
@@ -52,43 +52,48 @@ static void _invalid_format(const char *str)
 }
 
 /*
- * Checks that the config file contains vg metadata, and that it
- * we recognise the version number,
+ * Checks the contents and version values found in VG metadata, NULL if
+ * missing, for both the tree and streaming importers.  Returns why they
+ * are not recognised, or NULL if they are.
  */
-static int _vsn1_check_version(const struct dm_config_tree *cft)
+static const char *_vsn1_version_problem(const struct dm_config_value *contents,
+					 const struct dm_config_value *version)
 {
-	const struct dm_config_node *cn;
-	const struct dm_config_value *cv;
-
 	// TODO if this is pvscan --cache, we want this check back.
 	if (lvmetad_active())
-		return 1;
+		return NULL;
 
-	/*
-	 * Check the contents field.
-	 */
-	if (!(cn = dm_config_find_node(cft->root, CONTENTS_FIELD))) {
-		_invalid_format("missing contents field");
-		return 0;
-	}
+	if (!contents)
+		return "missing contents field";
 
-	cv = cn->v;
-	if (!cv || cv->type != DM_CFG_STRING || strcmp(cv->v.str, CONTENTS_VALUE)) {
-		_invalid_format("unrecognised contents field");
-		return 0;
-	}
+	if (contents->type != DM_CFG_STRING ||
+	    strcmp(contents->v.str, CONTENTS_VALUE))
+		return "unrecognised contents field";
 
-	/*
-	 * Check the version number.
-	 */
-	if (!(cn = dm_config_find_node(cft->root, FORMAT_VERSION_FIELD))) {
-		_invalid_format("missing version number");
-		return 0;
-	}
+	if (!version)
+		return "missing version number";
+
+	if (version->type != DM_CFG_INT || version->v.i != FORMAT_VERSION_VALUE)
+		return "unrecognised version number";
+
+	return NULL;
+}
+
+/*
+ * Checks that the config file contains vg metadata, and that it
+ * we recognise the version number,
+ */
+static int _vsn1_check_version(const struct dm_config_tree *cft)
+{
+	const struct dm_config_node *contents, *version;
+	const char *problem;
 
-	cv = cn->v;
-	if (!cv || cv->type != DM_CFG_INT || cv->v.i != FORMAT_VERSION_VALUE) {
-		_invalid_format("unrecognised version number");
+	contents = dm_config_find_node(cft->root, CONTENTS_FIELD);
+	version = dm_config_find_node(cft->root, FORMAT_VERSION_FIELD);
+
+	if ((problem = _vsn1_version_problem(contents ? contents->v : NULL,
+					     version ? version->v : NULL))) {
+		_invalid_format(problem);
 		return 0;
 	}
 
@@ -714,77 +719,123 @@ static int _read_sections(struct format_instance *fid,
 	return 1;
 }
 
-static struct volume_group *_read_vg(struct format_instance *fid,
-				     const struct dm_config_tree *cft,
-				     unsigned use_cached_pvs)
+/*
+ * Import state.  When the metadata is streamed, each LV section is read
+ * as soon as it has been parsed and, if its segments refer only to PVs
+ * and LVs that have already been read, dropped from the tree.
+ */
+struct text_vg_stream {
+	struct format_instance *fid;
+	const struct dm_config_node *vg_section;
+	struct volume_group *vg;
+	struct dm_hash_table *pv_hash;
+	struct dm_hash_table *lv_hash;
+	struct dm_hash_table *lvs_done;	/* LVs read completely while streaming */
+	unsigned scan_done_once;
+	unsigned pvs_read;
+	unsigned no_stream;		/* VG section not laid out for streaming */
+};
+
+static const struct dm_config_node *_find_vg_section(const struct dm_config_tree *cft)
 {
 	const struct dm_config_node *vgn;
-	const struct dm_config_value *cv;
-	const char *str;
-	struct volume_group *vg;
-	struct dm_hash_table *pv_hash = NULL, *lv_hash = NULL;
-	unsigned scan_done_once = use_cached_pvs;
 
 	/* skip any top-level values */
 	for (vgn = cft->root; (vgn && vgn->v); vgn = vgn->sib)
 		;
 
-	if (!vgn) {
+	if (!vgn)
 		log_error("Couldn't find volume group in file.");
-		return NULL;
-	}
 
-	if (!(vg = alloc_vg("read_vg", fid->fmt->cmd, vgn->key)))
-		return_NULL;
+	return vgn;
+}
+
+/*
+ * Creates the VG with what reading its PVs and LVs depends on.
+ */
+static int _read_vg_begin(struct text_vg_stream *vs, const struct dm_config_node *vg_section)
+{
+	const struct dm_config_node *vgn = vg_section->child;
+	struct volume_group *vg;
+
+	vs->vg_section = vg_section;
+
+	if (!(vg = vs->vg = alloc_vg("read_vg", vs->fid->fmt->cmd, vg_section->key)))
+		return_0;
 
 	if (!(vg->system_id = dm_pool_zalloc(vg->vgmem, NAME_LEN + 1)))
-		goto_bad;
+		return_0;
 
 	/*
 	 * The pv hash memorises the pv section names -> pv
 	 * structures.
 	 */
-	if (!(pv_hash = dm_hash_create(64))) {
+	if (!(vs->pv_hash = dm_hash_create(64))) {
 		log_error("Couldn't create pv hash table.");
-		goto bad;
+		return 0;
 	}
 
 	/*
 	 * The lv hash memorises the lv section names -> lv
 	 * structures.
 	 */
-	if (!(lv_hash = dm_hash_create(1024))) {
+	if (!(vs->lv_hash = dm_hash_create(1024))) {
 		log_error("Couldn't create lv hash table.");
-		goto bad;
+		return 0;
 	}
 
-	vgn = vgn->child;
+	if (!_read_id(&vg->id, vgn, "id")) {
+		log_error("Couldn't read uuid for volume group %s.", vg->name);
+		return 0;
+	}
 
-	if (dm_config_get_str(vgn, "system_id", &str)) {
-		strncpy(vg->system_id, str, NAME_LEN);
+	if (!_read_int32(vgn, "extent_size", &vg->extent_size)) {
+		log_error("Couldn't read extent size for volume group %s.",
+			  vg->name);
+		return 0;
 	}
 
-	if (!_read_id(&vg->id, vgn, "id")) {
-		log_error("Couldn't read uuid for volume group %s.", vg->name);
-		goto bad;
+	return 1;
+}
+
+static int _read_vg_pvs(struct text_vg_stream *vs, const struct dm_config_node *vgn)
+{
+	if (!_read_sections(vs->fid, "physical_volumes", _read_pv, vs->vg,
+			    vgn, vs->pv_hash, vs->lv_hash, 0, &vs->scan_done_once)) {
+		log_error("Couldn't find all physical volumes for volume "
+			  "group %s.", vs->vg->name);
+		return 0;
+	}
+
+	vs->pvs_read = 1;
+
+	return 1;
+}
+
+/*
+ * Reads the rest of the VG once its section has been parsed.
+ */
+static int _read_vg_rest(struct text_vg_stream *vs)
+{
+	const struct dm_config_node *vgn = vs->vg_section->child;
+	const struct dm_config_value *cv;
+	const char *str;
+	struct volume_group *vg = vs->vg;
+
+	if (dm_config_get_str(vgn, "system_id", &str)) {
+		strncpy(vg->system_id, str, NAME_LEN);
 	}
 
 	if (!_read_int32(vgn, "seqno", &vg->seqno)) {
 		log_error("Couldn't read 'seqno' for volume group %s.",
 			  vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (!_read_flag_config(vgn, &vg->status, VG_FLAGS)) {
 		log_error("Error reading flags of volume group %s.",
 			  vg->name);
-		goto bad;
-	}
-
-	if (!_read_int32(vgn, "extent_size", &vg->extent_size)) {
-		log_error("Couldn't read extent size for volume group %s.",
-			  vg->name);
-		goto bad;
+		return 0;
 	}
 
 	/*
@@ -795,13 +846,13 @@ static struct volume_group *_read_vg(struct format_instance *fid,
 	if (!_read_int32(vgn, "max_lv", &vg->max_lv)) {
 		log_error("Couldn't read 'max_lv' for volume group %s.",
 			  vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (!_read_int32(vgn, "max_pv", &vg->max_pv)) {
 		log_error("Couldn't read 'max_pv' for volume group %s.",
 			  vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (dm_config_get_str(vgn, "allocation_policy", &str)) {
@@ -817,7 +868,7 @@ static struct volume_group *_read_vg(struct format_instance *fid,
 		vg->profile = add_profile(vg->cmd, str);
 		if (!vg->profile) {
 			log_error("Failed to add configuration profile %s for VG %s", str, vg->name);
-			goto bad;
+			return 0;
 		}
 	}
 
@@ -825,63 +876,311 @@ static struct volume_group *_read_vg(struct format_instance *fid,
 		vg->mda_copies = DEFAULT_VGMETADATACOPIES;
 	}
 
-	if (!_read_sections(fid, "physical_volumes", _read_pv, vg,
-			    vgn, pv_hash, lv_hash, 0, &scan_done_once)) {
-		log_error("Couldn't find all physical volumes for volume "
-			  "group %s.", vg->name);
-		goto bad;
-	}
+	if (!vs->pvs_read && !_read_vg_pvs(vs, vgn))
+		return_0;
 
 	/* Optional tags */
 	if (dm_config_get_list(vgn, "tags", &cv) &&
 	    !(read_tags(vg->vgmem, &vg->tags, cv))) {
 		log_error("Couldn't read tags for volume group %s.", vg->name);
-		goto bad;
+		return 0;
 	}
 
-	if (!_read_sections(fid, "logical_volumes", _read_lvnames, vg,
-			    vgn, pv_hash, lv_hash, 1, NULL)) {
+	/* A streamed VG has had every LV header read already */
+	if (!vs->lvs_done &&
+	    !_read_sections(vs->fid, "logical_volumes", _read_lvnames, vg,
+			    vgn, vs->pv_hash, vs->lv_hash, 1, NULL)) {
 		log_error("Couldn't read all logical volume names for volume "
 			  "group %s.", vg->name);
-		goto bad;
+		return 0;
 	}
 
-	if (!_read_sections(fid, "logical_volumes", _read_lvsegs, vg,
-			    vgn, pv_hash, lv_hash, 1, NULL)) {
+	if (!_read_sections(vs->fid, "logical_volumes", _read_lvsegs, vg,
+			    vgn, vs->pv_hash, vs->lv_hash, 1, NULL)) {
 		log_error("Couldn't read all logical volumes for "
 			  "volume group %s.", vg->name);
-		goto bad;
+		return 0;
 	}
 
 	if (!fixup_imported_mirrors(vg)) {
 		log_error("Failed to fixup mirror pointers after import for "
 			  "volume group %s.", vg->name);
-		goto bad;
+		return 0;
 	}
 
-	dm_hash_destroy(pv_hash);
-	dm_hash_destroy(lv_hash);
-
 	/* FIXME Determine format type from file contents */
 	/* eg Set to instance of fmt1 here if reading a format1 backup? */
-	vg_set_fid(vg, fid);
+	vg_set_fid(vg, vs->fid);
+
+	return 1;
+}
+
+/*
+ * Releases the import state and hands back the VG if it is complete.
+ */
+static struct volume_group *_read_vg_end(struct text_vg_stream *vs, int complete)
+{
+	struct volume_group *vg = vs->vg;
+
+	if (vs->pv_hash)
+		dm_hash_destroy(vs->pv_hash);
+
+	if (vs->lv_hash)
+		dm_hash_destroy(vs->lv_hash);
+
+	if (vs->lvs_done)
+		dm_hash_destroy(vs->lvs_done);
+
+	vs->pv_hash = vs->lv_hash = vs->lvs_done = NULL;
+	vs->vg = NULL;
+
+	if (!complete && vg) {
+		release_vg(vg);
+		vg = NULL;
+	}
 
-	/*
-	 * Finished.
-	 */
 	return vg;
+}
+
+static struct volume_group *_read_vg(struct format_instance *fid,
+				     const struct dm_config_tree *cft,
+				     unsigned use_cached_pvs)
+{
+	struct text_vg_stream vs = {
+		.fid = fid,
+		.scan_done_once = use_cached_pvs,
+	};
+	const struct dm_config_node *vgn;
+
+	if (!(vgn = _find_vg_section(cft)))
+		return_NULL;
+
+	return _read_vg_end(&vs, _read_vg_begin(&vs, vgn) && _read_vg_rest(&vs));
+}
+
+static struct text_vg_stream *_stream_begin(struct format_instance *fid,
+					    unsigned use_cached_pvs)
+{
+	struct text_vg_stream *vs;
+
+	if (!(vs = dm_zalloc(sizeof(*vs)))) {
+		log_error("Couldn't allocate metadata import state.");
+		return NULL;
+	}
+
+	vs->fid = fid;
+	vs->scan_done_once = use_cached_pvs;
+
+	return vs;
+}
+
+/*
+ * Starts the VG when its first LV section arrives.  Metadata we wrote
+ * has the VG settings and PVs first; anything else is read from the
+ * complete tree instead.
+ */
+static int _stream_vg_begin(struct text_vg_stream *vs, const struct dm_config_node *vg_section)
+{
+	const struct dm_config_node *vgn = vg_section->child;
+
+	if (!dm_config_has_node(vgn, "id") ||
+	    !dm_config_has_node(vgn, "extent_size")) {
+		vs->no_stream = 1;
+		return 1;
+	}
+
+	if (!_read_vg_begin(vs, vg_section))
+		return_0;
+
+	if (!(vs->lvs_done = dm_hash_create(1024))) {
+		log_error("Couldn't create lv hash table.");
+		return 0;
+	}
+
+	if (dm_config_has_node(vgn, "physical_volumes") &&
+	    !_read_vg_pvs(vs, vgn))
+		return_0;
+
+	return 1;
+}
+
+/*
+ * Segments refer to PVs and LVs by name, so an LV's segments can be read
+ * straight away if every string they hold names a PV or an LV that is
+ * complete.  Anything else (or any nested section) waits for the tree.
+ */
+static int _stream_lv_ready(struct text_vg_stream *vs, const struct dm_config_node *lvn)
+{
+	const struct dm_config_node *sn, *cn;
+	const struct dm_config_value *cv;
 
-      bad:
-	if (pv_hash)
-		dm_hash_destroy(pv_hash);
+	for (sn = lvn->child; sn; sn = sn->sib) {
+		if (sn->v)
+			continue;
 
-	if (lv_hash)
-		dm_hash_destroy(lv_hash);
+		for (cn = sn->child; cn; cn = cn->sib) {
+			if (!cn->v)
+				return 0;
+
+			if (!strcmp(cn->key, "type") || !strcmp(cn->key, "tags"))
+				continue;
+
+			for (cv = cn->v; cv; cv = cv->next)
+				if (cv->type == DM_CFG_STRING &&
+				    !dm_hash_lookup(vs->pv_hash, cv->v.str) &&
+				    !dm_hash_lookup(vs->lvs_done, cv->v.str))
+					return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Position of the value of a top-level 'key = value' in unparsed text.
+ */
+static const char *_find_top_level_value(const char *start, const char *end,
+					 const char *key)
+{
+	size_t len = strlen(key);
+	const char *p, *v;
+	int depth = 0;
+
+	for (p = start; p < end; p++) {
+		if (*p == '"') {
+			while (++p < end && *p != '"')
+				if (*p == '\\')
+					p++;
+		} else if (*p == '#') {
+			while (p + 1 < end && p[1] != '\n')
+				p++;
+		} else if (*p == '{')
+			depth++;
+		else if (*p == '}')
+			depth--;
+		else if (!depth && (p == start || isspace(p[-1])) &&
+			 (size_t) (end - p) > len && !strncmp(p, key, len)) {
+			for (v = p + len; v < end && (*v == ' ' || *v == '\t'); v++)
+				;
+			if (v == end || *v++ != '=')
+				continue;
+			while (v < end && (*v == ' ' || *v == '\t'))
+				v++;
+			return v;
+		}
+	}
 
-	release_vg(vg);
 	return NULL;
 }
 
+/*
+ * The version fields follow the VG section in a metadata area, so they
+ * are looked up in the text before any section is streamed.
+ */
+static int _stream_check(const char *start, const char *end,
+			 void *baton __attribute__((unused)))
+{
+	char str[sizeof(CONTENTS_VALUE) + 1];
+	struct dm_config_value contents = { .type = DM_CFG_STRING, .v.str = str };
+	struct dm_config_value version = { .type = DM_CFG_INT };
+	const char *v, *q, *problem;
+	int have_contents = 0, have_version = 0;
+
+	if ((v = _find_top_level_value(start, end, CONTENTS_FIELD))) {
+		have_contents = 1;
+		for (q = v + 1; q < end && *q != '"'; q++)
+			;
+		if (v == end || *v != '"' || q == end ||
+		    (size_t) (q - v) > sizeof(str))
+			contents.type = DM_CFG_EMPTY_ARRAY;
+		else {
+			memcpy(str, v + 1, q - v - 1);
+			str[q - v - 1] = '\0';
+		}
+	}
+
+	if ((v = _find_top_level_value(start, end, FORMAT_VERSION_FIELD))) {
+		have_version = 1;
+		if (v == end || !isdigit(*v))
+			version.type = DM_CFG_EMPTY_ARRAY;
+		/* Stop once it cannot be a known version */
+		while (v < end && isdigit(*v) && version.v.i <= FORMAT_VERSION_VALUE)
+			version.v.i = version.v.i * 10 + (*v++ - '0');
+	}
+
+	if (!(problem = _vsn1_version_problem(have_contents ? &contents : NULL,
+					      have_version ? &version : NULL)))
+		return 1;
+
+	log_debug_metadata("Metadata not streamed before parsing: %s.", problem);
+
+	return 0;
+}
+
+static int _stream_section(const struct dm_config_node *lvn, void *baton)
+{
+	struct text_vg_stream *vs = baton;
+	const struct dm_config_node *vg_section;
+	struct logical_volume *lv;
+
+	/* Only LV sections of a top-level VG section are consumed */
+	if (vs->no_stream || !lvn->parent ||
+	    strcmp(lvn->parent->key, "logical_volumes") ||
+	    !(vg_section = lvn->parent->parent) || vg_section->parent)
+		return DM_CONFIG_SECTION_KEEP;
+
+	if (!vs->vg && !_stream_vg_begin(vs, vg_section))
+		return_0;
+
+	if (vs->no_stream || vg_section != vs->vg_section)
+		return DM_CONFIG_SECTION_KEEP;
+
+	/* Every LV is named here so vg->lvs keeps the metadata order */
+	if (!_read_lvnames(vs->fid, vs->vg, lvn, NULL, vs->pv_hash,
+			   vs->lv_hash, NULL, 0))
+		return_0;
+
+	if (!_stream_lv_ready(vs, lvn))
+		return DM_CONFIG_SECTION_KEEP;
+
+	if (!_read_lvsegs(vs->fid, vs->vg, lvn, NULL, vs->pv_hash,
+			  vs->lv_hash, NULL, 0))
+		return_0;
+
+	if (!(lv = dm_hash_lookup(vs->lv_hash, lvn->key)) ||
+	    !dm_hash_insert(vs->lvs_done, lv->name, lv))
+		return_0;
+
+	return DM_CONFIG_SECTION_DROP;
+}
+
+static struct volume_group *_stream_end(struct text_vg_stream *vs,
+					const struct dm_config_tree *cft)
+{
+	const struct dm_config_node *vgn;
+	struct volume_group *vg = NULL;
+
+	if (!cft)
+		goto out;
+
+	if (!(vgn = _find_vg_section(cft)))
+		goto_out;
+
+	/* Nothing consumed from the VG section: read it as usual */
+	if (!vs->vg || vgn != vs->vg_section) {
+		(void) _read_vg_end(vs, 0);
+		vg = _read_vg(vs->fid, cft, vs->scan_done_once);
+		goto out;
+	}
+
+	vg = _read_vg_end(vs, _read_vg_rest(vs));
+out:
+	(void) _read_vg_end(vs, 0);
+	dm_free(vs);
+
+	return vg;
+}
+
 static void _read_desc(struct dm_pool *mem,
 		       const struct dm_config_tree *cft, time_t *when, char **desc)
 {
@@ -943,6 +1242,10 @@ static const char *_read_vgname(const struct format_type *fmt,
 static struct text_vg_version_ops _vsn1_ops = {
 	.check_version = _vsn1_check_version,
 	.read_vg = _read_vg,
+	.stream_begin = _stream_begin,
+	.stream_check = _stream_check,
+	.stream_section = _stream_section,
+	.stream_end = _stream_end,
 	.read_desc = _read_desc,
 	.read_vgname = _read_vgname,
 };
@@ -52,6 +52,12 @@ struct pv_header {
  */
 #define RAW_LOCN_IGNORED 0x00000001
 
+/*
+ * The metadata text at this raw location is compressed.
+ * See lvm-compress.h for the record layout.
+ */
+#define RAW_LOCN_COMPRESSED 0x00000002
+
 /* On disk */
 struct raw_locn {
 	uint64_t offset;	/* Offset in bytes to start sector */
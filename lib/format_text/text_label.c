@@ -319,10 +319,7 @@ static int _update_mda(struct metadata_area *mda, void *baton)
 	const struct format_type *fmt = p->label->labeller->private; // Oh dear.
 	struct mda_context *mdac = (struct mda_context *) mda->metadata_locn;
 	struct mda_header *mdah;
-	const char *vgname = NULL;
-	struct id vgid;
-	uint64_t vgstatus;
-	char *creation_host;
+	struct mda_summary summary;
 
 	if (!dev_open_readonly(mdac->area.dev)) {
 		mda_set_ignored(mda, 1);
@@ -346,13 +343,23 @@ static int _update_mda(struct metadata_area *mda, void *baton)
 		return 1;
 	}
 
-	if ((vgname = vgname_from_mda(fmt, mdah,
-				      &mdac->area,
-				      &vgid, &vgstatus, &creation_host,
-				      &mdac->free_sectors)) &&
-	    !lvmcache_update_vgname_and_id(p->info, vgname,
-					   (char *) &vgid, vgstatus,
-					   creation_host)) {
+	if (lvmcache_find_mda_summary(mdac->area.dev, mdac->area.start,
+				      xlate32(mdah->checksum_xl), &summary))
+		mdac->free_sectors = summary.free_sectors;
+	else if ((summary.vgname = vgname_from_mda(fmt, mdah,
+						   &mdac->area,
+						   &summary.vgid, &summary.vgstatus,
+						   &summary.creation_host,
+						   &mdac->free_sectors))) {
+		summary.free_sectors = mdac->free_sectors;
+		lvmcache_add_mda_summary(mdac->area.dev, mdac->area.start,
+					 xlate32(mdah->checksum_xl), &summary);
+	}
+
+	if (summary.vgname &&
+	    !lvmcache_update_vgname_and_id(p->info, summary.vgname,
+					   (char *) &summary.vgid, summary.vgstatus,
+					   summary.creation_host)) {
 		if (!dev_close(mdac->area.dev))
 			stack;
 		return_0;
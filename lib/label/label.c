@@ -98,23 +98,30 @@ struct labeller *label_get_handler(const char *name)
 	return NULL;
 }
 
-static struct labeller *_find_labeller(struct device *dev, char *buf,
-				       uint64_t *label_sector,
-				       uint64_t scan_sector)
+static void _label_not_found(struct device *dev)
+{
+	struct lvmcache_info *info;
+
+	if ((info = lvmcache_info_from_pvid(dev->pvid, 0)))
+		lvmcache_update_vgname_and_id(info, lvmcache_fmt(info)->orphan_vg_name,
+					      lvmcache_fmt(info)->orphan_vg_name,
+					      0, NULL);
+}
+
+/*
+ * Look for a label in the LABEL_SCAN_SIZE bytes already read
+ * from scan_sector into readbuf.
+ */
+static struct labeller *_find_labeller_in_buf(struct device *dev,
+					      const char *readbuf, char *buf,
+					      uint64_t *label_sector,
+					      uint64_t scan_sector)
 {
 	struct labeller_i *li;
 	struct labeller *r = NULL;
 	struct label_header *lh;
-	struct lvmcache_info *info;
 	uint64_t sector;
 	int found = 0;
-	char readbuf[LABEL_SCAN_SIZE] __attribute__((aligned(8)));
-
-	if (!dev_read(dev, scan_sector << SECTOR_SHIFT,
-		      LABEL_SCAN_SIZE, readbuf)) {
-		log_debug_devs("%s: Failed to read label area", dev_name(dev));
-		goto out;
-	}
 
 	/* Scan a few sectors for a valid label */
 	for (sector = 0; sector < LABEL_SCAN_SECTORS;
@@ -171,18 +178,31 @@ static struct labeller *_find_labeller(struct device *dev, char *buf,
 		}
 	}
 
-      out:
 	if (!found) {
-		if ((info = lvmcache_info_from_pvid(dev->pvid, 0)))
-			lvmcache_update_vgname_and_id(info, lvmcache_fmt(info)->orphan_vg_name,
-						      lvmcache_fmt(info)->orphan_vg_name,
-						      0, NULL);
+		_label_not_found(dev);
 		log_very_verbose("%s: No label detected", dev_name(dev));
 	}
 
 	return r;
 }
 
+static struct labeller *_find_labeller(struct device *dev, char *buf,
+				       uint64_t *label_sector,
+				       uint64_t scan_sector)
+{
+	char readbuf[LABEL_SCAN_SIZE] __attribute__((aligned(8)));
+
+	if (!dev_read(dev, scan_sector << SECTOR_SHIFT,
+		      LABEL_SCAN_SIZE, readbuf)) {
+		log_debug_devs("%s: Failed to read label area", dev_name(dev));
+		_label_not_found(dev);
+		log_very_verbose("%s: No label detected", dev_name(dev));
+		return NULL;
+	}
+
+	return _find_labeller_in_buf(dev, readbuf, buf, label_sector, scan_sector);
+}
+
 /* FIXME Also wipe associated metadata area headers? */
 int label_remove(struct device *dev)
 {
@@ -292,6 +312,110 @@ int label_read(struct device *dev, struct label **result,
 	return r;
 }
 
+/*
+ * Read the labels of up to LABEL_SCAN_BATCH devices with a single batch
+ * of reads, so the time taken tracks the slowest device rather than the
+ * sum of them all.  Devices whose label is already cached are skipped.
+ *
+ * Each device gets one LABEL_PROBE_SIZE read from the start, which also
+ * covers the header of a metadata area in the standard position and
+ * usually the start of the metadata text.  The labeller's reads are
+ * served from that data, so it finds the mda header and VG name without
+ * issuing any further I/O.  A device whose probe fails is not read
+ * again unless it is smaller than the probe.
+ */
+int label_read_batch(struct device **devs, unsigned count)
+{
+	struct device_read_req *reqs;
+	struct lvmcache_info *info;
+	struct labeller *l;
+	struct label *label;
+	char buf[LABEL_SIZE] __attribute__((aligned(8)));
+	struct device *dev;
+	char *bufs, *aligned;
+	size_t read_size = LABEL_PROBE_SIZE;
+	uintptr_t mask;
+	uint64_t sector, size;
+	unsigned i, nr = 0;
+
+	if (!count)
+		return 1;
+
+	/* Page-aligned buffers keep the reads valid for O_DIRECT. */
+	mask = (uintptr_t) lvm_getpagesize() - 1;
+
+	if (!(reqs = dm_zalloc(count * sizeof(*reqs))) ||
+	    !(bufs = dm_malloc(count * read_size + mask))) {
+		log_error("Failed to allocate label scan buffers.");
+		dm_free(reqs);
+		return 0;
+	}
+
+	aligned = (char *) ((((uintptr_t) bufs) + mask) & ~mask);
+
+	for (i = 0; i < count; i++) {
+		if ((info = lvmcache_info_from_pvid(devs[i]->pvid, 1))) {
+			log_debug_devs("Using cached label for %s", dev_name(devs[i]));
+			continue;
+		}
+
+		if (!dev_open_readonly(devs[i])) {
+			stack;
+			_label_not_found(devs[i]);
+			continue;
+		}
+
+		reqs[nr].where.dev = devs[i];
+		reqs[nr].where.start = 0;
+		reqs[nr].where.size = read_size;
+		reqs[nr].buf = aligned + nr * read_size;
+		nr++;
+	}
+
+	if (nr)
+		log_debug_devs("Reading labels from %u devices in one batch.", nr);
+
+	if (!dev_read_batch(reqs, nr))
+		stack;
+
+	for (i = 0; i < nr; i++) {
+		dev = reqs[i].where.dev;
+
+		if (!reqs[i].result) {
+			/* Only a device smaller than the probe gets a second read */
+			if (dev_get_size(dev, &size) &&
+			    (size << SECTOR_SHIFT) < read_size) {
+				log_debug_devs("%s: Smaller than %" PRIsize_t " bytes "
+					       "probe, reading label alone.",
+					       dev_name(dev), read_size);
+				(void) label_read(dev, &label, UINT64_C(0));
+			} else {
+				log_debug_devs("%s: Failed to read label area",
+					       dev_name(dev));
+				_label_not_found(dev);
+				log_very_verbose("%s: No label detected", dev_name(dev));
+			}
+		} else {
+			/* The labeller's mda reads come from the probe */
+			dev_set_read_window(&reqs[i]);
+			if ((l = _find_labeller_in_buf(dev, reqs[i].buf,
+						       buf, &sector, UINT64_C(0))) &&
+			    (l->ops->read)(l, dev, buf, &label) && label)
+				label->sector = sector;
+			dev_set_read_window(NULL);
+			dev_cache_read_req(&reqs[i]);
+		}
+
+		if (!dev_close(dev))
+			stack;
+	}
+
+	dm_free(bufs);
+	dm_free(reqs);
+
+	return 1;
+}
+
 /* Caller may need to use label_get_handler to create label struct! */
 int label_write(struct device *dev, struct label *label)
 {
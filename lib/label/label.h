@@ -23,6 +23,8 @@
 #define LABEL_SIZE SECTOR_SIZE	/* Think very carefully before changing this */
 #define LABEL_SCAN_SECTORS 4L
 #define LABEL_SCAN_SIZE (LABEL_SCAN_SECTORS << SECTOR_SHIFT)
+#define LABEL_SCAN_BATCH 128	/* Max devices read by one label_read_batch */
+#define LABEL_PROBE_SIZE (64 * 1024)	/* Label plus first metadata area header */
 
 struct labeller;
 
@@ -100,6 +102,7 @@ struct labeller *label_get_handler(const char *name);
 int label_remove(struct device *dev);
 int label_read(struct device *dev, struct label **result,
 		uint64_t scan_sector);
+int label_read_batch(struct device **devs, unsigned count);
 int label_write(struct device *dev, struct label *label);
 int label_verify(struct device *dev);
 struct label *label_create(struct labeller *labeller);
@@ -674,6 +674,28 @@ out:
 	return repstr;
 }
 
+/*
+ * LV renames must come through here so that find_lv_in_vg() stops
+ * trusting the name index of the VG.
+ */
+void lv_set_name(struct logical_volume *lv, const char *name)
+{
+	if (lv->vg)
+		vg_index_drop_lv_names(lv->vg);
+
+	lv->name = name;
+	lv_set_changed(lv);
+}
+
+/*
+ * Anything changing an LV calls this so that the next vg_validate()
+ * re-checks it together with the LVs it uses and the LVs using it.
+ */
+void lv_set_changed(struct logical_volume *lv)
+{
+	lv->changed = 1;
+}
+
 int lv_set_creation(struct logical_volume *lv,
 		    const char *hostname, uint64_t timestamp)
 {
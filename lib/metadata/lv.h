@@ -52,6 +52,10 @@ struct logical_volume {
 
 	uint64_t timestamp;
 	const char *hostname;
+
+	/* Change tracking for vg_validate() */
+	unsigned changed;
+	uint64_t validated_fingerprint;
 };
 
 uint64_t lv_size(const struct logical_volume *lv);
@@ -84,6 +88,8 @@ char *lvseg_devices(struct dm_pool *mem, const struct lv_segment *seg);
 char *lvseg_seg_pe_ranges(struct dm_pool *mem, const struct lv_segment *seg);
 char *lv_time_dup(struct dm_pool *mem, const struct logical_volume *lv);
 char *lv_host_dup(struct dm_pool *mem, const struct logical_volume *lv);
+void lv_set_name(struct logical_volume *lv, const char *name);
+void lv_set_changed(struct logical_volume *lv);
 int lv_set_creation(struct logical_volume *lv,
 		    const char *hostname, uint64_t timestamp);
 const char *lv_layer(const struct logical_volume *lv);
@@ -289,6 +289,9 @@ int add_seg_to_segs_using_this_lv(struct logical_volume *lv,
 {
 	struct seg_list *sl;
 
+	lv_set_changed(lv);
+	lv_set_changed(seg->lv);
+
 	dm_list_iterate_items(sl, &lv->segs_using_this_lv) {
 		if (sl->seg == seg) {
 			sl->count++;
@@ -316,6 +319,9 @@ int remove_seg_from_segs_using_this_lv(struct logical_volume *lv,
 {
 	struct seg_list *sl;
 
+	lv_set_changed(lv);
+	lv_set_changed(seg->lv);
+
 	dm_list_iterate_items(sl, &lv->segs_using_this_lv) {
 		if (sl->seg != seg)
 			continue;
@@ -472,6 +478,8 @@ struct lv_segment *alloc_lv_segment(const struct segment_type *segtype,
 		return_NULL;
 	}
 
+	lv_set_changed(lv);
+
 	seg->segtype = segtype;
 	seg->lv = lv;
 	seg->le = le;
@@ -545,6 +553,8 @@ static int _release_and_discard_lv_segment_area(struct lv_segment *seg, uint32_t
 	if (seg_type(seg, s) == AREA_UNASSIGNED)
 		return 1;
 
+	lv_set_changed(seg->lv);
+
 	if (seg_type(seg, s) == AREA_PV) {
 		if (with_discard && !discard_pv_segment(seg_pvseg(seg, s), area_reduction))
 			return_0;
@@ -676,6 +686,7 @@ int move_lv_segment_area(struct lv_segment *seg_to, uint32_t area_to,
 int set_lv_segment_area_pv(struct lv_segment *seg, uint32_t area_num,
 			   struct physical_volume *pv, uint32_t pe)
 {
+	lv_set_changed(seg->lv);
 	seg->areas[area_num].type = AREA_PV;
 
 	if (!(seg_pvseg(seg, area_num) =
@@ -731,6 +742,7 @@ static int _lv_segment_add_areas(struct logical_volume *lv,
 
 	memcpy(newareas, seg->areas, seg->area_count * sizeof(*seg->areas));
 
+	lv_set_changed(lv);
 	seg->areas = newareas;
 	seg->area_count = new_area_count;
 
@@ -775,6 +787,8 @@ static int _lv_reduce(struct logical_volume *lv, uint32_t extents, int delete)
 	uint32_t count = extents;
 	uint32_t reduction;
 
+	lv_set_changed(lv);
+
 	dm_list_iterate_back_items(seg, &lv->segments) {
 		if (!count)
 			break;
@@ -1871,15 +1885,7 @@ static uint32_t _calc_required_extents(struct alloc_handle *ah, struct pv_area *
 	} else if (required < ah->log_len)
 		required = ah->log_len;
 
-	if (required >= pva->unreserved) {
-		required = pva->unreserved;
-		pva->unreserved = 0;
-	} else {
-		pva->unreserved -= required;
-		reinsert_changed_pv_area(pva);
-	}
-
-	return required;
+	return reserve_pv_area(pva, required);
 }
 
 static int _reserve_required_area(struct alloc_handle *ah, uint32_t max_to_allocate,
@@ -1913,19 +1919,6 @@ static void _clear_areas(struct alloc_state *alloc_state)
 		alloc_state->areas[s].pva = NULL;
 }
 
-static void _reset_unreserved(struct dm_list *pvms)
-{
-	struct pv_map *pvm;
-	struct pv_area *pva;
-
-	dm_list_iterate_items(pvm, pvms)
-		dm_list_iterate_items(pva, &pvm->areas)
-			if (pva->unreserved != pva->count) {
-				pva->unreserved = pva->count;
-				reinsert_changed_pv_area(pva);
-			}
-}
-
 static void _report_needed_allocation_space(struct alloc_handle *ah,
 					    struct alloc_state *alloc_state)
 {
@@ -1990,7 +1983,7 @@ static int _find_some_parallel_space(struct alloc_handle *ah, const struct alloc
 				alloc_parms->flags & A_CLING_TO_ALLOCED ? "" : "not ");
 
 	_clear_areas(alloc_state);
-	_reset_unreserved(pvms);
+	unreserve_pv_maps(pvms);
 
 	_report_needed_allocation_space(ah, alloc_state);
 
@@ -2120,7 +2113,11 @@ static int _find_some_parallel_space(struct alloc_handle *ah, const struct alloc
 	if (ix + preferred_count < devices_needed + alloc_state->log_area_count_still_needed)
 		return 1;
 
-	/* Sort the areas so we allocate from the biggest */
+	/*
+	 * Sort the areas so we allocate from the biggest.
+	 * Apart from ALLOC_ANYWHERE there is at most one area per PV here,
+	 * so this costs little next to the walk over the PVs above.
+	 */
 	if (log_iteration_count) {
 		if (ix > devices_needed + 1) {
 			log_debug_alloc("Sorting %u log areas", ix - devices_needed);
@@ -3067,7 +3064,7 @@ static int _rename_single_lv(struct logical_volume *lv, char *new_name)
 		return 0;
 	}
 
-	lv->name = new_name;
+	lv_set_name(lv, new_name);
 
 	return 1;
 }
@@ -3200,6 +3197,7 @@ int lv_rename_update(struct cmd_context *cmd, struct logical_volume *lv,
 	struct lv_names lv_names;
 	DM_LIST_INIT(lvs_changed);
 	struct lv_list lvl, lvl2, *lvlp;
+	const char *name;
 	int r = 0;
 
 	/* rename is not allowed on sub LVs */
@@ -3229,10 +3227,11 @@ int lv_rename_update(struct cmd_context *cmd, struct logical_volume *lv,
 		return 0;
 
 	/* rename main LV */
-	if (!(lv->name = dm_pool_strdup(cmd->mem, new_name))) {
+	if (!(name = dm_pool_strdup(cmd->mem, new_name))) {
 		log_error("Failed to allocate space for new name");
 		return 0;
 	}
+	lv_set_name(lv, name);
 
 	if (!update_mda)
 		return 1;
@@ -4331,6 +4330,8 @@ struct logical_volume *lv_create_empty(const char *name,
 	if (fi->fmt->ops->lv_setup && !fi->fmt->ops->lv_setup(fi, lv))
 		goto_bad;
 
+	vg_index_add_lvid(vg, lv);
+
 	if (vg->fid->fmt->features & FMT_CONFIG_PROFILE)
 		lv->profile = vg->cmd->profile_params->global_profile;
  
@@ -4435,6 +4436,8 @@ int link_lv_to_vg(struct volume_group *vg, struct logical_volume *lv)
 	lvl->lv = lv;
 	lv->vg = vg;
 	dm_list_add(&vg->lvs, &lvl->list);
+	vg_index_add_lv(vg, lvl);
+	lv_set_changed(lv);
 
 	return 1;
 }
@@ -4446,6 +4449,8 @@ int unlink_lv_from_vg(struct logical_volume *lv)
 	if (!(lvl = find_lv_in_vg(lv->vg, lv->name)))
 		return_0;
 
+	vg_index_del_lv(lv->vg, lvl);
+	lv_set_neighbours_changed(lv);
 	dm_list_del(&lvl->list);
 
 	return 1;
@@ -4457,6 +4462,7 @@ void lv_set_visible(struct logical_volume *lv)
 		return;
 
 	lv->status |= VISIBLE_LV;
+	lv_set_changed(lv);
 
 	log_debug_metadata("LV %s in VG %s is now visible.",  lv->name, lv->vg->name);
 }
@@ -4467,6 +4473,7 @@ void lv_set_hidden(struct logical_volume *lv)
 		return;
 
 	lv->status &= ~VISIBLE_LV;
+	lv_set_changed(lv);
 
 	log_debug_metadata("LV %s in VG %s is now hidden.",  lv->name, lv->vg->name);
 }
@@ -4969,6 +4976,9 @@ int move_lv_segments(struct logical_volume *lv_to,
 			return 0;
 		}
 
+	lv_set_changed(lv_to);
+	lv_set_changed(lv_from);
+
 	dm_list_init(&lv_to->segments);
 	dm_list_splice(&lv_to->segments, &lv_from->segments);
 
@@ -46,9 +46,10 @@ int lv_merge_segments(struct logical_volume *lv)
 	dm_list_iterate_safe(segh, t, &lv->segments) {
 		current = dm_list_item(segh, struct lv_segment);
 
-		if (_merge(prev, current))
+		if (_merge(prev, current)) {
 			dm_list_del(&current->list);
-		else
+			lv_set_changed(lv);
+		} else
 			prev = current;
 	}
 
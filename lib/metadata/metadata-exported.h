@@ -214,6 +214,10 @@ struct pv_segment {
 
 	struct lv_segment *lvseg;	/* NULL if free space */
 	uint32_t lv_area;	/* Index to area in LV segment */
+
+	/* Node in pv->peg_tree, ordered by pe */
+	struct pv_segment *left, *right;
+	int height;
 };
 
 #define pvseg_is_allocated(pvseg) ((pvseg)->lvseg)
@@ -595,6 +599,17 @@ int vg_split_mdas(struct cmd_context *cmd, struct volume_group *vg_from,
 void add_pvl_to_vgs(struct volume_group *vg, struct pv_list *pvl);
 void del_pvl_from_vgs(struct volume_group *vg, struct pv_list *pvl);
 
+/*
+ * Maintain the lookup indexes of vg->lvs and vg->pvs.
+ */
+void vg_index_add_lv(struct volume_group *vg, struct lv_list *lvl);
+void vg_index_add_lvid(struct volume_group *vg, struct logical_volume *lv);
+void vg_index_del_lv(struct volume_group *vg, struct lv_list *lvl);
+void vg_index_add_pv(struct volume_group *vg, struct pv_list *pvl);
+void vg_index_del_pv(struct volume_group *vg, struct pv_list *pvl);
+void vg_index_drop_lv_names(struct volume_group *vg);
+void vg_index_destroy(struct volume_group *vg);
+
 /* FIXME: refactor / unexport when lvremove liblvm refactoring dones */
 int remove_lvs_in_vg(struct cmd_context *cmd,
 		     struct volume_group *vg,
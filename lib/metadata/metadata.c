@@ -143,20 +143,183 @@ out:
 	return pv->pe_align_offset;
 }
 
+/*
+ * The lv and pv indexes are built from vg->lvs and vg->pvs by the first
+ * lookup and kept up to date by link_lv_to_vg(), unlink_lv_from_vg(),
+ * add_pvl_to_vgs() and del_pvl_from_vgs().  Every hit is checked against
+ * the object it points to, so an entry left behind by code changing an
+ * lvid, a pv id or moving an LV between VGs only costs a rebuild.
+ * A miss in the name index is final, so LV renames go through
+ * lv_set_name() which drops it.
+ */
+static void _drop_index(struct dm_hash_table **index)
+{
+	if (*index) {
+		dm_hash_destroy(*index);
+		*index = NULL;
+	}
+}
+
+static struct dm_hash_table *_build_lv_index(struct volume_group *vg, int by_name)
+{
+	struct dm_hash_table *index;
+	struct lv_list *lvl;
+	unsigned count = dm_list_size(&vg->lvs);
+	unsigned *dups = by_name ? &vg->lv_name_dups : &vg->lv_id_dups;
+
+	if (!(index = dm_hash_create(count * 2 + 16))) {
+		log_debug_metadata("Failed to allocate LV index for %s.", vg->name);
+		return NULL;
+	}
+
+	*dups = 0;
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		/* Like the list walk, the first of any duplicates wins */
+		if (by_name ? dm_hash_lookup(index, lvl->lv->name) :
+		    dm_hash_lookup_binary(index, &lvl->lv->lvid.id,
+					  sizeof(lvl->lv->lvid.id))) {
+			(*dups)++;
+			continue;
+		}
+		if (!(by_name ? dm_hash_insert(index, lvl->lv->name, lvl) :
+		      dm_hash_insert_binary(index, &lvl->lv->lvid.id,
+					    sizeof(lvl->lv->lvid.id), lvl))) {
+			log_debug_metadata("Failed to index LV %s.", lvl->lv->name);
+			dm_hash_destroy(index);
+			return NULL;
+		}
+	}
+
+	vg->lv_index_size = count;
+
+	return index;
+}
+
+static struct dm_hash_table *_build_pv_index(struct volume_group *vg)
+{
+	struct dm_hash_table *index;
+	struct pv_list *pvl;
+
+	if (!(index = dm_hash_create(vg->pv_count * 2 + 16))) {
+		log_debug_metadata("Failed to allocate PV index for %s.", vg->name);
+		return NULL;
+	}
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		if (!dm_hash_insert_binary(index, &pvl->pv->id,
+					   sizeof(pvl->pv->id), pvl)) {
+			log_debug_metadata("Failed to index PV in %s.", vg->name);
+			dm_hash_destroy(index);
+			return NULL;
+		}
+
+	return index;
+}
+
+static void _index_add_lvid(struct volume_group *vg, struct lv_list *lvl)
+{
+	if (dm_hash_lookup_binary(vg->lv_ids, &lvl->lv->lvid.id,
+				  sizeof(lvl->lv->lvid.id)))
+		vg->lv_id_dups++;
+	else if (!dm_hash_insert_binary(vg->lv_ids, &lvl->lv->lvid.id,
+					sizeof(lvl->lv->lvid.id), lvl))
+		_drop_index(&vg->lv_ids);
+}
+
+void vg_index_add_lv(struct volume_group *vg, struct lv_list *lvl)
+{
+	struct dm_hash_table *index;
+
+	if (vg->lv_names) {
+		if (dm_hash_lookup(vg->lv_names, lvl->lv->name))
+			vg->lv_name_dups++;
+		else if (!dm_hash_insert(vg->lv_names, lvl->lv->name, lvl))
+			_drop_index(&vg->lv_names);
+	}
+
+	/* New LVs get their lvid later from the format's lv_setup */
+	if (vg->lv_ids && *lvl->lv->lvid.s)
+		_index_add_lvid(vg, lvl);
+
+	/* Rebuild with more slots on the next lookup once they overflow */
+	if ((index = vg->lv_names ? : vg->lv_ids) &&
+	    dm_hash_get_num_entries(index) > vg->lv_index_size * 2 + 16) {
+		_drop_index(&vg->lv_names);
+		_drop_index(&vg->lv_ids);
+	}
+}
+
+void vg_index_del_lv(struct volume_group *vg, struct lv_list *lvl)
+{
+	if (vg->lv_names && dm_hash_lookup(vg->lv_names, lvl->lv->name) == lvl)
+		dm_hash_remove(vg->lv_names, lvl->lv->name);
+
+	if (vg->lv_ids && dm_hash_lookup_binary(vg->lv_ids, &lvl->lv->lvid.id,
+						sizeof(lvl->lv->lvid.id)) == lvl)
+		dm_hash_remove_binary(vg->lv_ids, &lvl->lv->lvid.id,
+				      sizeof(lvl->lv->lvid.id));
+}
+
+/*
+ * Indexes the lvid the format's lv_setup gave to a newly linked LV.
+ */
+void vg_index_add_lvid(struct volume_group *vg, struct logical_volume *lv)
+{
+	struct lv_list *lvl;
+
+	if (vg->lv_ids && *lv->lvid.s &&
+	    (lvl = find_lv_in_vg(vg, lv->name)) && lvl->lv == lv &&
+	    dm_hash_lookup_binary(vg->lv_ids, &lv->lvid.id,
+				  sizeof(lv->lvid.id)) != lvl)
+		_index_add_lvid(vg, lvl);
+}
+
+void vg_index_drop_lv_names(struct volume_group *vg)
+{
+	_drop_index(&vg->lv_names);
+}
+
+void vg_index_add_pv(struct volume_group *vg, struct pv_list *pvl)
+{
+	if (vg->pv_ids && !dm_hash_insert_binary(vg->pv_ids, &pvl->pv->id,
+						 sizeof(pvl->pv->id), pvl))
+		_drop_index(&vg->pv_ids);
+}
+
+void vg_index_del_pv(struct volume_group *vg, struct pv_list *pvl)
+{
+	if (vg->pv_ids && dm_hash_lookup_binary(vg->pv_ids, &pvl->pv->id,
+						sizeof(pvl->pv->id)) == pvl)
+		dm_hash_remove_binary(vg->pv_ids, &pvl->pv->id,
+				      sizeof(pvl->pv->id));
+}
+
+void vg_index_destroy(struct volume_group *vg)
+{
+	_drop_index(&vg->lv_names);
+	_drop_index(&vg->lv_ids);
+	_drop_index(&vg->pv_ids);
+}
+
 void add_pvl_to_vgs(struct volume_group *vg, struct pv_list *pvl)
 {
 	dm_list_add(&vg->pvs, &pvl->list);
 	vg->pv_count++;
 	pvl->pv->vg = vg;
 	pv_set_fid(pvl->pv, vg->fid);
+	vg_index_add_pv(vg, pvl);
+	/* PVs and LVs moving between VGs are checked afresh */
+	vg->validated = 0;
 }
 
 void del_pvl_from_vgs(struct volume_group *vg, struct pv_list *pvl)
 {
 	struct lvmcache_info *info;
 
+	vg_index_del_pv(vg, pvl);
 	vg->pv_count--;
 	dm_list_del(&pvl->list);
+	vg->validated = 0;
 
 	pvl->pv->vg = vg->fid->fmt->orphan_vg; /* orphan */
 	if ((info = lvmcache_info_from_pvid((const char *) &pvl->pv->id, 0)))
@@ -300,6 +463,7 @@ static int _copy_pv(struct dm_pool *pvmem,
 
 	if (!peg_dup(pvmem, &pv_to->segments, &pv_from->segments))
 		return_0;
+	pv_to->peg_tree = NULL;
 
 	return 1;
 }
@@ -832,26 +996,10 @@ int vgcreate_params_validate(struct cmd_context *cmd,
 
 static int _vg_update_vg_ondisk(struct volume_group *vg)
 {
-	struct dm_config_tree *cft;
-	int pool_locked;
-
 	if (vg->vg_ondisk || is_orphan_vg(vg->name)) /* we already have it */
 		return 1;
 
-	pool_locked = dm_pool_locked(vg->vgmem);
-	if (pool_locked && !dm_pool_unlock(vg->vgmem, 0))
-		return_0;
-
-	cft = export_vg_to_config_tree(vg);
-	if (!cft)
-		return 0;
-
-	vg->vg_ondisk = import_vg_from_config_tree(cft, vg->fid);
-	dm_config_destroy(cft);
-
-	/* recompute the pool crc */
-	if (pool_locked && !dm_pool_lock(vg->vgmem, detect_internal_vg_cache_corruption()))
-		return_0;
+	vg->vg_ondisk = vg_clone(vg, vg->fid);
 
 	return vg->vg_ondisk ? 1 : 0;
 }
@@ -864,13 +1012,6 @@ static struct volume_group *_vg_make_handle(struct cmd_context *cmd,
 					    struct volume_group *vg,
 					    uint32_t failure)
 {
-
-	/* Never return a cached VG structure for a failure */
-	if (vg && vg->vginfo && failure != SUCCESS) {
-		release_vg(vg);
-		vg = NULL;
-	}
-
 	if (!vg && !(vg = alloc_vg("vg_make_handle", cmd, NULL)))
 		return_NULL;
 
@@ -1285,21 +1426,23 @@ int vg_split_mdas(struct cmd_context *cmd __attribute__((unused)),
 
 static int _wipe_sb(struct device *dev, const char *type, const char *name,
 		    int wipe_len, struct pvcreate_params *pp,
-		    int (*func)(struct device *dev, uint64_t *signature))
+		    struct dev_signatures *sigs, dev_sig_t sig)
 {
-	int wipe;
 	uint64_t superblock;
 
-	wipe = func(dev, &superblock);
-	if (wipe == -1) {
+	/* An unreadable md superblock location is not an md superblock */
+	if ((sigs->failed & DEV_SIG_MASK(sig) & ~sigs->found) &&
+	    (sig != DEV_SIG_MD)) {
 		log_error("Fatal error while trying to detect %s on %s.",
 			  type, name);
 		return 0;
 	}
 
-	if (wipe == 0)
+	if (!(sigs->found & DEV_SIG_MASK(sig)))
 		return 1;
 
+	superblock = sigs->offset[sig];
+
 	/* Specifying --yes => do not ask. */
 	if (!pp->yes && (pp->force == PROMPT) &&
 	    yes_no_prompt("WARNING: %s detected on %s. Wipe it? [y/n] ",
@@ -1314,6 +1457,13 @@ static int _wipe_sb(struct device *dev, const char *type, const char *name,
 		return 0;
 	}
 
+	/* The wipe may have overlapped another signature */
+	if (!dev_probe_signatures(dev, sigs->probed, sigs)) {
+		log_error("Fatal error while trying to detect signatures on %s.",
+			  name);
+		return 0;
+	}
+
 	return 1;
 }
 
@@ -1326,6 +1476,7 @@ static int pvcreate_check(struct cmd_context *cmd, const char *name,
 {
 	struct physical_volume *pv;
 	struct device *dev;
+	struct dev_signatures sigs;
 
 	/* FIXME Check partition type is LVM unless --force is given */
 
@@ -1393,13 +1544,22 @@ static int pvcreate_check(struct cmd_context *cmd, const char *name,
 		goto bad;
 	}
 
-	if (!_wipe_sb(dev, "software RAID md superblock", name, 4, pp, dev_is_md))
+	if (!dev_probe_signatures(dev, DEV_SIG_MASK(DEV_SIG_MD) |
+				  DEV_SIG_MASK(DEV_SIG_SWAP) |
+				  DEV_SIG_MASK(DEV_SIG_LUKS), &sigs)) {
+		log_error("Fatal error while trying to detect signatures on %s.",
+			  name);
+		goto bad;
+	}
+
+	if (!_wipe_sb(dev, "software RAID md superblock", name, 4, pp,
+		      &sigs, DEV_SIG_MD))
 		goto_bad;
 
-	if (!_wipe_sb(dev, "swap signature", name, 10, pp, dev_is_swap))
+	if (!_wipe_sb(dev, "swap signature", name, 10, pp, &sigs, DEV_SIG_SWAP))
 		goto_bad;
 
-	if (!_wipe_sb(dev, "LUKS signature", name, 8, pp, dev_is_luks))
+	if (!_wipe_sb(dev, "LUKS signature", name, 8, pp, &sigs, DEV_SIG_LUKS))
 		goto_bad;
 
 	if (sigint_caught())
@@ -1703,9 +1863,10 @@ struct pv_list *find_pv_in_vg(const struct volume_group *vg,
 			       const char *pv_name)
 {
 	struct pv_list *pvl;
+	struct device *dev = dev_cache_get(pv_name, vg->cmd->filter);
 
 	dm_list_iterate_items(pvl, &vg->pvs)
-		if (pvl->pv->dev == dev_cache_get(pv_name, vg->cmd->filter))
+		if (pvl->pv->dev == dev)
 			return pvl;
 
 	return NULL;
@@ -1749,7 +1910,20 @@ int pv_is_in_vg(struct volume_group *vg, struct physical_volume *pv)
 struct pv_list *find_pv_in_vg_by_uuid(const struct volume_group *vg,
 				      const struct id *id)
 {
+	/* The index is a cache, not part of the VG contents */
+	struct volume_group *ivg = (struct volume_group *) vg;
 	struct pv_list *pvl;
+	int fresh = 0;
+
+	/* A miss is only trusted straight after a rebuild */
+	while (ivg->pv_ids || (fresh = !!(ivg->pv_ids = _build_pv_index(ivg)))) {
+		if ((pvl = dm_hash_lookup_binary(ivg->pv_ids, id, sizeof(*id))) &&
+		    pvl->pv->vg == vg && id_equal(&pvl->pv->id, id))
+			return pvl;
+		if (fresh)
+			return NULL;
+		_drop_index(&ivg->pv_ids);
+	}
 
 	dm_list_iterate_items(pvl, &vg->pvs)
 		if (id_equal(&pvl->pv->id, id))
@@ -1761,6 +1935,7 @@ struct pv_list *find_pv_in_vg_by_uuid(const struct volume_group *vg,
 struct lv_list *find_lv_in_vg(const struct volume_group *vg,
 			      const char *lv_name)
 {
+	struct volume_group *ivg = (struct volume_group *) vg;
 	struct lv_list *lvl;
 	const char *ptr;
 
@@ -1770,6 +1945,20 @@ struct lv_list *find_lv_in_vg(const struct volume_group *vg,
 	else
 		ptr = lv_name;
 
+	if (!ivg->lv_names)
+		ivg->lv_names = _build_lv_index(ivg, 1);
+
+	if (ivg->lv_names) {
+		if (!(lvl = dm_hash_lookup(ivg->lv_names, ptr)))
+			return NULL;
+		if (lvl->lv->vg == vg && !strcmp(lvl->lv->name, ptr))
+			return lvl;
+		/* Stale entry */
+		_drop_index(&ivg->lv_names);
+		if ((ivg->lv_names = _build_lv_index(ivg, 1)))
+			return dm_hash_lookup(ivg->lv_names, ptr);
+	}
+
 	dm_list_iterate_items(lvl, &vg->lvs)
 		if (!strcmp(lvl->lv->name, ptr))
 			return lvl;
@@ -1793,6 +1982,18 @@ struct lv_list *find_lv_in_vg_by_lvid(struct volume_group *vg,
 				      const union lvid *lvid)
 {
 	struct lv_list *lvl;
+	int fresh = 0;
+
+	/* lvids may change after link_lv_to_vg() so only trust a fresh index */
+	while (vg->lv_ids || (fresh = !!(vg->lv_ids = _build_lv_index(vg, 0)))) {
+		if ((lvl = dm_hash_lookup_binary(vg->lv_ids, lvid->id, sizeof(lvid->id))) &&
+		    lvl->lv->vg == vg &&
+		    !memcmp(lvl->lv->lvid.id, lvid->id, sizeof(lvid->id)))
+			return lvl;
+		if (fresh)
+			return NULL;
+		_drop_index(&vg->lv_ids);
+	}
 
 	dm_list_iterate_items(lvl, &vg->lvs)
 		if (!strncmp(lvl->lv->lvid.s, lvid->s, sizeof(*lvid)))
@@ -2234,6 +2435,145 @@ void lv_calculate_readahead(const struct logical_volume *lv, uint32_t *read_ahea
 	}
 }
 
+/*
+ * vg_validate() only re-checks the LVs and PVs changed since the VG was
+ * last validated, and the LVs next to those.  A VG just read or cloned
+ * has not been, so its first validation checks everything.  Mutators mark
+ * what they change with lv_set_changed() and pv_set_changed().
+ * Fingerprints of the fields most often changed directly catch what was
+ * missed.
+ */
+#define FINGERPRINT_PRIME UINT64_C(1099511628211)
+
+static uint64_t _lv_fingerprint(const struct logical_volume *lv)
+{
+	const struct lv_segment *seg = first_seg(lv);
+	uint64_t f = lv->status & ~(POSTORDER_FLAG | POSTORDER_OPEN_FLAG);
+
+	f = f * FINGERPRINT_PRIME ^ lv->le_count;
+	f = f * FINGERPRINT_PRIME ^ (uintptr_t) seg;
+	f = f * FINGERPRINT_PRIME ^ (uintptr_t) lv->segments.p;
+
+	if (seg) {
+		f = f * FINGERPRINT_PRIME ^ (uintptr_t) seg->segtype;
+		f = f * FINGERPRINT_PRIME ^ seg->area_count;
+	}
+
+	return f;
+}
+
+static uint64_t _pv_fingerprint(const struct physical_volume *pv)
+{
+	uint64_t f = pv->pe_count;
+
+	f = f * FINGERPRINT_PRIME ^ pv->pe_alloc_count;
+	f = f * FINGERPRINT_PRIME ^ (uintptr_t) pv->segments.n;
+	f = f * FINGERPRINT_PRIME ^ (uintptr_t) pv->segments.p;
+
+	return f;
+}
+
+static int _lv_set_neighbour_changed(struct logical_volume *lv,
+				     void *data __attribute__((unused)))
+{
+	/* Checked next time, but its own neighbours are not */
+	if (!lv->changed)
+		lv->changed = 2;
+
+	return 1;
+}
+
+/*
+ * Calls fn for each LV using this one.  C.f. _lv_each_dependency.
+ */
+static int _lv_each_user(struct logical_volume *lv,
+			 int (*fn)(struct logical_volume *lv, void *data),
+			 void *data)
+{
+	struct seg_list *sl;
+	struct lv_segment *seg;
+
+	dm_list_iterate_items(sl, &lv->segs_using_this_lv)
+		if (!fn(sl->seg->lv, data))
+			return_0;
+
+	dm_list_iterate_items_gen(seg, &lv->snapshot_segs, origin_list)
+		if (!fn(seg->cow, data))
+			return_0;
+
+	return 1;
+}
+
+/*
+ * Marks the LVs used by this one and those using it for vg_validate().
+ * Also called for LVs being unlinked from their VG.
+ */
+void lv_set_neighbours_changed(struct logical_volume *lv)
+{
+	_lv_each_dependency(lv, _lv_set_neighbour_changed, NULL);
+	_lv_each_user(lv, _lv_set_neighbour_changed, NULL);
+}
+
+static void _vg_set_validated(struct volume_group *vg)
+{
+	struct pv_list *pvl;
+	struct lv_list *lvl;
+
+	dm_list_iterate_items(pvl, &vg->pvs) {
+		pvl->pv->changed = 0;
+		pvl->pv->validated_fingerprint = _pv_fingerprint(pvl->pv);
+	}
+
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		lvl->lv->changed = 0;
+		lvl->lv->validated_fingerprint = _lv_fingerprint(lvl->lv);
+	}
+
+	vg->validated = 1;
+}
+
+/*
+ * Marks the LVs and PVs vg_validate() has to check.  Returns 0 if it
+ * has to check them all.
+ */
+static int _vg_mark_changed(struct volume_group *vg)
+{
+	struct pv_list *pvl;
+	struct lv_list *lvl;
+
+	if (!vg->validated || full_vg_validation() ||
+	    verbose_level() > _LOG_DEBUG)
+		return 0;
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		if (pvl->pv->validated_fingerprint != _pv_fingerprint(pvl->pv))
+			pvl->pv->changed = 1;
+
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (lvl->lv->validated_fingerprint != _lv_fingerprint(lvl->lv))
+			lvl->lv->changed = 1;
+
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (lvl->lv->changed == 1)
+			lv_set_neighbours_changed(lvl->lv);
+
+	/*
+	 * The VG indexes hold every LV, so names and lvids are unique if the
+	 * indexes return each changed LV and left out no duplicates.
+	 */
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (lvl->lv->changed &&
+		    (find_lv_in_vg(vg, lvl->lv->name) != lvl ||
+		     find_lv_in_vg_by_lvid(vg, &lvl->lv->lvid) != lvl))
+			return 0;
+
+	if ((!vg->lv_names && !(vg->lv_names = _build_lv_index(vg, 1))) ||
+	    (!vg->lv_ids && !(vg->lv_ids = _build_lv_index(vg, 0))))
+		return 0;
+
+	return !vg->lv_name_dups && !vg->lv_id_dups;
+}
+
 struct validate_hash {
 	struct dm_hash_table *lvname;
 	struct dm_hash_table *lvid;
@@ -2244,7 +2584,7 @@ struct validate_hash {
  * Check that an LV and all its PV references are correctly listed in vg->lvs
  * and vg->pvs, respectively. This only looks at a single LV, but *not* at the
  * LVs it is using. To do the latter, you should use _lv_postorder with this
- * function. C.f. vg_validate.
+ * function. C.f. vg_validate.  Without an lvid hash the VG index is used.
  */
 static int _lv_validate_references_single(struct logical_volume *lv, void *data)
 {
@@ -2252,11 +2592,13 @@ static int _lv_validate_references_single(struct logical_volume *lv, void *data)
 	struct validate_hash *vhash = data;
 	struct lv_segment *lvseg;
 	struct physical_volume *pv;
+	struct lv_list *lvl;
 	unsigned s;
 	int r = 1;
 
-	if (lv != dm_hash_lookup_binary(vhash->lvid, &lv->lvid.id[1],
-					sizeof(lv->lvid.id[1]))) {
+	if (vhash->lvid ? lv != dm_hash_lookup_binary(vhash->lvid, &lv->lvid.id[1],
+						      sizeof(lv->lvid.id[1])) :
+	    (!(lvl = find_lv_in_vg_by_lvid(vg, &lv->lvid)) || lvl->lv != lv)) {
 		log_error(INTERNAL_ERROR
 			  "Referenced LV %s not listed in VG %s.",
 			  lv->name, vg->name);
@@ -2295,6 +2637,7 @@ int vg_validate(struct volume_group *vg)
 	unsigned num_snapshots = 0;
 	unsigned spare_count = 0;
 	struct validate_hash vhash = { NULL };
+	int full = !_vg_mark_changed(vg);
 
 	if (vg->alloc == ALLOC_CLING_BY_TAGS) {
 		log_error(INTERNAL_ERROR "VG %s allocation policy set to invalid cling_by_tags.",
@@ -2363,7 +2706,7 @@ int vg_validate(struct volume_group *vg)
 	}
 
 
-	if (!check_pv_segments(vg)) {
+	if (!check_pv_segments(vg, !full)) {
 		log_error(INTERNAL_ERROR "PV segments corrupted in %s.",
 			  vg->name);
 		r = 0;
@@ -2381,7 +2724,7 @@ int vg_validate(struct volume_group *vg)
 		if (lv_is_visible(lvl->lv))
 			lv_visible_count++;
 
-		if (!check_lv_segments(lvl->lv, 0)) {
+		if ((full || lvl->lv->changed) && !check_lv_segments(lvl->lv, 0)) {
 			log_error(INTERNAL_ERROR "LV segments corrupted in %s.",
 				  lvl->lv->name);
 			r = 0;
@@ -2405,6 +2748,19 @@ int vg_validate(struct volume_group *vg)
 				r = 0;
 			}
 
+		if (lv_is_pool_metadata_spare(lvl->lv)) {
+			if (++spare_count > 1) {
+				log_error(INTERNAL_ERROR "LV %s is %u. pool metadata spare (>1).",
+					  lvl->lv->name, spare_count);
+				r = 0;
+			}
+			if (vg->pool_metadata_spare_lv != lvl->lv) {
+				log_error(INTERNAL_ERROR "LV %s is not vg pool metadata spare.",
+					  lvl->lv->name);
+				r = 0;
+			}
+		}
+
 		if (lvl->lv->status & VISIBLE_LV)
 			continue;
 
@@ -2442,6 +2798,30 @@ int vg_validate(struct volume_group *vg)
 	if (!r)
 		goto out;
 
+	/*
+	 * Unchanged LVs passed these checks before.  The VG indexes
+	 * vouched for the names and lvids of changed ones.
+	 */
+	if (!full) {
+		dm_list_iterate_items(lvl, &vg->lvs) {
+			if (!lvl->lv->changed)
+				continue;
+
+			if (!check_lv_segments(lvl->lv, 1)) {
+				log_error(INTERNAL_ERROR "LV segments corrupted in %s.",
+					  lvl->lv->name);
+				r = 0;
+			}
+
+			if (!_lv_validate_references_single(lvl->lv, &vhash)) {
+				stack;
+				r = 0;
+			}
+		}
+
+		goto check_pvmove;
+	}
+
 	if (!(vhash.lvname = dm_hash_create(lv_count))) {
 		log_error("Failed to allocate lv_name hash");
 		r = 0;
@@ -2473,19 +2853,6 @@ int vg_validate(struct volume_group *vg)
 			r = 0;
 		}
 
-		if (lv_is_pool_metadata_spare(lvl->lv)) {
-			if (++spare_count > 1) {
-				log_error(INTERNAL_ERROR "LV %s is %u. pool metadata spare (>1).",
-					  lvl->lv->name, spare_count);
-				r = 0;
-			}
-			if (vg->pool_metadata_spare_lv != lvl->lv) {
-				log_error(INTERNAL_ERROR "LV %s is not vg pool metadata spare.",
-					  lvl->lv->name);
-				r = 0;
-			}
-		}
-
 		if (!check_lv_segments(lvl->lv, 1)) {
 			log_error(INTERNAL_ERROR "LV segments corrupted in %s.",
 				  lvl->lv->name);
@@ -2511,6 +2878,7 @@ int vg_validate(struct volume_group *vg)
 		r = 0;
 	}
 
+check_pvmove:
 	dm_list_iterate_items(lvl, &vg->lvs) {
 		if (!(lvl->lv->status & PVMOVE))
 			continue;
@@ -2547,6 +2915,15 @@ int vg_validate(struct volume_group *vg)
 
 	if (vg_max_lv_reached(vg))
 		stack;
+
+	if (r) {
+		/* Let rebuilt indexes recount duplicates now there are none */
+		if (vg->lv_name_dups || vg->lv_id_dups) {
+			_drop_index(&vg->lv_names);
+			_drop_index(&vg->lv_ids);
+		}
+		_vg_set_validated(vg);
+	}
 out:
 	if (vhash.lvid)
 		dm_hash_destroy(vhash.lvid);
@@ -2614,11 +2991,17 @@ int vg_write(struct volume_group *vg)
 			return 0;
         }
 
-	/* Write to each copy of the metadata area */
+	/*
+	 * Write to each copy of the metadata area.  The writes are issued
+	 * together and all of them complete before any header is updated.
+	 */
+	dev_write_batch_begin();
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
 		if (!mda->ops->vg_write) {
 			log_error("Format does not support writing volume"
 				  "group metadata areas");
+			if (dev_write_batch_end())
+				stack;
 			/* Revert */
 			dm_list_uniterate(mdah, &vg->fid->metadata_areas_in_use, &mda->list) {
 				mda = dm_list_item(mdah, struct metadata_area);
@@ -2632,6 +3015,8 @@ int vg_write(struct volume_group *vg)
 		}
 		if (!mda->ops->vg_write(vg->fid, vg, mda)) {
 			stack;
+			if (dev_write_batch_end())
+				stack;
 			/* Revert */
 			dm_list_uniterate(mdah, &vg->fid->metadata_areas_in_use, &mda->list) {
 				mda = dm_list_item(mdah, struct metadata_area);
@@ -2645,22 +3030,28 @@ int vg_write(struct volume_group *vg)
 		}
 	}
 
-	/* Now pre-commit each copy of the new metadata */
+	if (dev_write_batch_end()) {
+		log_error("Failed to write metadata for VG %s.", vg->name);
+		goto revert;
+	}
+
+	/* Now pre-commit each copy of the new metadata, again together */
+	dev_write_batch_begin();
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
 		if (mda->ops->vg_precommit &&
 		    !mda->ops->vg_precommit(vg->fid, vg, mda)) {
 			stack;
-			/* Revert */
-			dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
-				if (mda->ops->vg_revert &&
-				    !mda->ops->vg_revert(vg->fid, vg, mda)) {
-					stack;
-				}
-			}
-			return 0;
+			if (dev_write_batch_end())
+				stack;
+			goto revert;
 		}
 	}
 
+	if (dev_write_batch_end()) {
+		log_error("Failed to pre-commit metadata for VG %s.", vg->name);
+		goto revert;
+	}
+
 	/*
 	 * If precommit is not supported, changes take effect immediately.
 	 * FIXME Replace with a more-accurate FMT_COMMIT flag.
@@ -2669,13 +3060,24 @@ int vg_write(struct volume_group *vg)
 		return_0;
 
 	return 1;
+
+revert:
+	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
+		if (mda->ops->vg_revert &&
+		    !mda->ops->vg_revert(vg->fid, vg, mda)) {
+			stack;
+		}
+	}
+
+	return 0;
 }
 
 static int _vg_commit_mdas(struct volume_group *vg)
 {
 	struct metadata_area *mda, *tmda;
 	struct dm_list ignored;
-	int failed = 0;
+	unsigned committed = 0, count, i;
+	int *failed;
 	int cache_updated = 0;
 
 	/* Rearrange the metadata_areas_in_use so ignored mdas come first. */
@@ -2687,21 +3089,43 @@ static int _vg_commit_mdas(struct volume_group *vg)
 	dm_list_iterate_items_safe(mda, tmda, &ignored)
 		dm_list_move(&vg->fid->metadata_areas_in_use, &mda->list);
 
-	/* Commit to each copy of the metadata area */
+	count = dm_list_size(&vg->fid->metadata_areas_in_use);
+	if (!(failed = dm_zalloc((count + 1) * sizeof(*failed)))) {
+		log_error("Failed to allocate metadata commit state.");
+		return 0;
+	}
+
+	/*
+	 * Commit to each copy of the metadata area, with the header writes
+	 * issued together.  A copy is committed if its commit succeeded
+	 * and none of the writes it queued failed.
+	 */
+	dev_write_batch_begin();
+	i = 0;
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
-		failed = 0;
+		dev_write_batch_track(&failed[i]);
 		if (mda->ops->vg_commit &&
 		    !mda->ops->vg_commit(vg->fid, vg, mda)) {
 			stack;
-			failed = 1;
-		}
-		/* Update cache first time we succeed */
-		if (!failed && !cache_updated) {
-			lvmcache_update_vg(vg, 0);
-			// lvmetad_vg_commit(vg);
-			cache_updated = 1;
+			failed[i] = 1;
 		}
+		i++;
+	}
+	dev_write_batch_track(NULL);
+	(void) dev_write_batch_end();
+
+	for (i = 0; i < count; i++)
+		if (!failed[i])
+			committed++;
+
+	dm_free(failed);
+
+	if (committed) {
+		lvmcache_update_vg(vg, 0);
+		// lvmetad_vg_commit(vg);
+		cache_updated = 1;
 	}
+
 	return cache_updated;
 }
 
@@ -3413,7 +3837,7 @@ struct volume_group *vg_read_internal(struct cmd_context *cmd, const char *vgnam
 	if (!(vg = _vg_read(cmd, vgname, vgid, warnings, consistent, 0)))
 		return NULL;
 
-	if (!check_pv_segments(vg)) {
+	if (!check_pv_segments(vg, 0)) {
 		log_error(INTERNAL_ERROR "PV segments corrupted in %s.",
 			  vg->name);
 		release_vg(vg);
@@ -400,6 +400,11 @@ struct logical_volume *alloc_lv(struct dm_pool *mem);
  */
 int check_lv_segments(struct logical_volume *lv, int complete_vg);
 
+/*
+ * Marks the LVs next to lv to be checked by the next vg_validate().
+ */
+void lv_set_neighbours_changed(struct logical_volume *lv);
+
 
 /*
  * Checks that a replicator segment is correct.
@@ -607,6 +607,7 @@ static int _split_mirror_images(struct logical_volume *lv,
 	struct lv_segment *mirrored_seg = first_seg(lv);
 	struct dm_list split_images;
 	struct lv_list *lvl;
+	const char *name;
 	struct cmd_context *cmd = lv->vg->cmd;
 
 	if (!(lv->status & MIRRORED)) {
@@ -669,11 +670,11 @@ static int _split_mirror_images(struct logical_volume *lv,
 		dm_list_add(&split_images, &lvl->list);
 	}
 
-	new_lv->name = dm_pool_strdup(lv->vg->vgmem, split_name);
-	if (!new_lv->name) {
+	if (!(name = dm_pool_strdup(lv->vg->vgmem, split_name))) {
 		log_error("Unable to rename newly split LV");
 		return 0;
 	}
+	lv_set_name(new_lv, name);
 
 	if (!dm_list_empty(&split_images)) {
 		size_t len = strlen(new_lv->name) + 32;
@@ -710,7 +711,7 @@ static int _split_mirror_images(struct logical_volume *lv,
 				log_error("Failed to generate new image names");
 				return 0;
 			}
-			sub_lv->name = layer_name;
+			lv_set_name(sub_lv, layer_name);
 		}
 
 		if (!_merge_mirror_images(new_lv, &split_images)) {
@@ -344,3 +344,12 @@ unsigned pv_mda_set_ignored(const struct physical_volume *pv, unsigned mda_ignor
 	return 1;
 }
 
+
+/*
+ * Anything changing the pv_segments of a PV calls this so that the next
+ * vg_validate() re-checks them.
+ */
+void pv_set_changed(struct physical_volume *pv)
+{
+	pv->changed = 1;
+}
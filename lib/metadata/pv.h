@@ -62,7 +62,12 @@ struct physical_volume {
 	uint64_t label_sector;
 
 	struct dm_list segments;	/* Ordered pv_segments covering complete PV */
+	struct pv_segment *peg_tree;	/* Index of segments by pe, built on demand */
 	struct dm_list tags;
+
+	/* Change tracking for vg_validate() */
+	unsigned changed;
+	uint64_t validated_fingerprint;
 };
 
 char *pv_fmt_dup(const struct physical_volume *pv);
@@ -90,6 +95,7 @@ uint64_t pv_used(const struct physical_volume *pv);
 uint32_t pv_mda_count(const struct physical_volume *pv);
 uint32_t pv_mda_used_count(const struct physical_volume *pv);
 unsigned pv_mda_set_ignored(const struct physical_volume *pv, unsigned ignored);
+void pv_set_changed(struct physical_volume *pv);
 int is_orphan(const struct physical_volume *pv);
 int is_missing_pv(const struct physical_volume *pv);
 int is_pv(const struct physical_volume *pv);
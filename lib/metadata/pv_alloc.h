@@ -16,6 +16,9 @@
 
 int alloc_pv_segment_whole_pv(struct dm_pool *mem, struct physical_volume *pv);
 int peg_dup(struct dm_pool *mem, struct dm_list *peg_new, struct dm_list *peg_old);
+struct pv_segment *find_peg_by_pe(struct physical_volume *pv, uint32_t pe);
+struct pv_segment *next_peg(const struct physical_volume *pv,
+			    const struct pv_segment *peg);
 struct pv_segment *assign_peg_to_lvseg(struct physical_volume *pv, uint32_t pe,
 				       uint32_t area_len,
 				       struct lv_segment *seg,
@@ -25,7 +28,7 @@ int pv_split_segment(struct dm_pool *mem,
 		     struct pv_segment **pvseg_allocated);
 int discard_pv_segment(struct pv_segment *peg, uint32_t discard_area_reduction);
 int release_pv_segment(struct pv_segment *peg, uint32_t area_reduction);
-int check_pv_segments(struct volume_group *vg);
+int check_pv_segments(struct volume_group *vg, int changed_only);
 void merge_pv_segments(struct pv_segment *peg1, struct pv_segment *peg2);
 
 #endif
@@ -52,6 +52,8 @@ int alloc_pv_segment_whole_pv(struct dm_pool *mem, struct physical_volume *pv)
 {
 	struct pv_segment *peg;
 
+	pv->peg_tree = NULL;
+
 	if (!pv->pe_count)
 		return 1;
 
@@ -81,18 +83,208 @@ int peg_dup(struct dm_pool *mem, struct dm_list *peg_new, struct dm_list *peg_ol
 	return 1;
 }
 
+/*
+ * pv->peg_tree is an AVL tree over the same segments as pv->segments,
+ * keyed by pe, so the segment holding an extent is found without walking
+ * the list.  It is built on the first lookup that needs it and kept up to
+ * date by the functions here that add or remove segments.  Anything else
+ * reinitialising pv->segments, or copying a PV, must reset it.
+ */
+static int _peg_height(const struct pv_segment *peg)
+{
+	return peg ? peg->height : 0;
+}
+
+static void _peg_update_height(struct pv_segment *peg)
+{
+	int l = _peg_height(peg->left), r = _peg_height(peg->right);
+
+	peg->height = (l > r ? l : r) + 1;
+}
+
+static struct pv_segment *_peg_rotate_right(struct pv_segment *peg)
+{
+	struct pv_segment *l = peg->left;
+
+	peg->left = l->right;
+	l->right = peg;
+	_peg_update_height(peg);
+	_peg_update_height(l);
+
+	return l;
+}
+
+static struct pv_segment *_peg_rotate_left(struct pv_segment *peg)
+{
+	struct pv_segment *r = peg->right;
+
+	peg->right = r->left;
+	r->left = peg;
+	_peg_update_height(peg);
+	_peg_update_height(r);
+
+	return r;
+}
+
+static struct pv_segment *_peg_rebalance(struct pv_segment *peg)
+{
+	int balance = _peg_height(peg->left) - _peg_height(peg->right);
+
+	if (balance > 1) {
+		if (_peg_height(peg->left->left) < _peg_height(peg->left->right))
+			peg->left = _peg_rotate_left(peg->left);
+		return _peg_rotate_right(peg);
+	}
+
+	if (balance < -1) {
+		if (_peg_height(peg->right->right) < _peg_height(peg->right->left))
+			peg->right = _peg_rotate_right(peg->right);
+		return _peg_rotate_left(peg);
+	}
+
+	_peg_update_height(peg);
+
+	return peg;
+}
+
+static struct pv_segment *_peg_tree_insert(struct pv_segment *root,
+					   struct pv_segment *peg)
+{
+	if (!root) {
+		peg->left = peg->right = NULL;
+		peg->height = 1;
+		return peg;
+	}
+
+	if (peg->pe < root->pe)
+		root->left = _peg_tree_insert(root->left, peg);
+	else
+		root->right = _peg_tree_insert(root->right, peg);
+
+	return _peg_rebalance(root);
+}
+
+static struct pv_segment *_peg_tree_remove_first(struct pv_segment *root,
+						 struct pv_segment **first)
+{
+	if (!root->left) {
+		*first = root;
+		return root->right;
+	}
+
+	root->left = _peg_tree_remove_first(root->left, first);
+
+	return _peg_rebalance(root);
+}
+
+static struct pv_segment *_peg_tree_remove(struct pv_segment *root,
+					   struct pv_segment *peg)
+{
+	struct pv_segment *first;
+
+	if (!root)
+		return NULL;	/* Not reached for segments in the tree */
+
+	if (root == peg) {
+		if (!peg->right)
+			return peg->left;
+
+		peg->right = _peg_tree_remove_first(peg->right, &first);
+		first->left = peg->left;
+		first->right = peg->right;
+
+		return _peg_rebalance(first);
+	}
+
+	if (peg->pe < root->pe)
+		root->left = _peg_tree_remove(root->left, peg);
+	else
+		root->right = _peg_tree_remove(root->right, peg);
+
+	return _peg_rebalance(root);
+}
+
+/* Builds a balanced tree from the next count segments of the ordered list */
+static struct pv_segment *_peg_tree_build(struct dm_list **next, unsigned count)
+{
+	struct pv_segment *root, *left;
+
+	if (!count)
+		return NULL;
+
+	left = _peg_tree_build(next, count / 2);
+	root = dm_list_item(*next, struct pv_segment);
+	*next = (*next)->n;
+
+	root->left = left;
+	root->right = _peg_tree_build(next, count - count / 2 - 1);
+	_peg_update_height(root);
+
+	return root;
+}
+
+static void _peg_tree_rebuild(struct physical_volume *pv)
+{
+	struct dm_list *next = pv->segments.n;
+
+	pv->peg_tree = _peg_tree_build(&next, dm_list_size(&pv->segments));
+}
+
+/* Last segment starting at or below pe */
+static struct pv_segment *_peg_tree_find(struct pv_segment *root, uint32_t pe)
+{
+	struct pv_segment *found = NULL;
+
+	while (root) {
+		if (pe < root->pe)
+			root = root->left;
+		else {
+			found = root;
+			root = root->right;
+		}
+	}
+
+	return found;
+}
+
 /* Find segment at a given physical extent in a PV */
-static struct pv_segment *find_peg_by_pe(const struct physical_volume *pv,
-					 uint32_t pe)
+struct pv_segment *find_peg_by_pe(struct physical_volume *pv, uint32_t pe)
 {
 	struct pv_segment *pvseg;
 
-	/* search backwards to optimise mostly used last segment split */
-	dm_list_iterate_back_items(pvseg, &pv->segments)
-		if (pe >= pvseg->pe && pe < pvseg->pe + pvseg->len)
-			return pvseg;
+	if (dm_list_empty(&pv->segments))
+		return NULL;
+
+	/* Check the ends first to optimise mostly used last segment split */
+	pvseg = dm_list_item(dm_list_last(&pv->segments), struct pv_segment);
+	if (pe >= pvseg->pe)
+		return (pe < pvseg->pe + pvseg->len) ? pvseg : NULL;
+
+	pvseg = dm_list_item(dm_list_first(&pv->segments), struct pv_segment);
+	if (pe < pvseg->pe + pvseg->len)
+		return (pe >= pvseg->pe) ? pvseg : NULL;
+
+	if (!pv->peg_tree)
+		_peg_tree_rebuild(pv);
+
+	/* Segments cover the whole PV so pe lies inside one of them */
+	if (!(pvseg = _peg_tree_find(pv->peg_tree, pe)) ||
+	    pe >= pvseg->pe + pvseg->len) {
+		log_error(INTERNAL_ERROR "No segment for extent %" PRIu32
+			  " in segment index of PV %s.", pe, pv_dev_name(pv));
+		return NULL;
+	}
 
-	return NULL;
+	return pvseg;
+}
+
+/* Segment following peg on the PV, or NULL */
+struct pv_segment *next_peg(const struct physical_volume *pv,
+			    const struct pv_segment *peg)
+{
+	struct dm_list *next = dm_list_next(&pv->segments, &peg->list);
+
+	return next ? dm_list_item(next, struct pv_segment) : NULL;
 }
 
 /*
@@ -114,6 +306,9 @@ static struct pv_segment *_pv_split_segment(struct dm_pool *mem,
 	peg->len = peg->len - peg_new->len;
 
 	dm_list_add_h(&peg->list, &peg_new->list);
+	if (peg->pv->peg_tree)
+		peg->pv->peg_tree = _peg_tree_insert(peg->pv->peg_tree, peg_new);
+	pv_set_changed(peg->pv);
 
 	if (peg->lvseg) {
 		peg->pv->pe_alloc_count -= peg_new->len;
@@ -185,6 +380,7 @@ struct pv_segment *assign_peg_to_lvseg(struct physical_volume *pv,
 	peg->lvseg = seg;
 	peg->lv_area = area_num;
 
+	pv_set_changed(peg->pv);
 	peg->pv->pe_alloc_count += area_len;
 	peg->lvseg->lv->vg->free_count -= area_len;
 
@@ -253,6 +449,8 @@ int release_pv_segment(struct pv_segment *peg, uint32_t area_reduction)
 		return 0;
 	}
 
+	pv_set_changed(peg->pv);
+
 	if (peg->lvseg->area_len == area_reduction) {
 		peg->pv->pe_alloc_count -= area_reduction;
 		peg->lvseg->lv->vg->free_count += area_reduction;
@@ -281,6 +479,9 @@ void merge_pv_segments(struct pv_segment *peg1, struct pv_segment *peg2)
 	peg1->len += peg2->len;
 
 	dm_list_del(&peg2->list);
+	if (peg1->pv->peg_tree)
+		peg1->pv->peg_tree = _peg_tree_remove(peg1->pv->peg_tree, peg2);
+	pv_set_changed(peg1->pv);
 }
 
 /*
@@ -313,7 +514,10 @@ uint32_t pv_list_extents_free(const struct dm_list *pvh)
 
 	dm_list_iterate_items(pvl, pvh) {
 		dm_list_iterate_items(per, pvl->pe_ranges) {
-			dm_list_iterate_items(pvseg, &pvl->pv->segments) {
+			/* Only the segments overlapping the range */
+			for (pvseg = find_peg_by_pe(pvl->pv, per->start);
+			     pvseg && pvseg->pe < per->start + per->count;
+			     pvseg = next_peg(pvl->pv, pvseg)) {
 				if (!pvseg_is_allocated(pvseg))
 					extents += _overlap_pe(pvseg, per);
 			}
@@ -323,14 +527,42 @@ uint32_t pv_list_extents_free(const struct dm_list *pvh)
 	return extents;
 }
 
+/* In-order walk of the tree must give the list, with AVL heights intact */
+static int _check_peg_tree(const struct physical_volume *pv,
+			   const struct pv_segment *root, struct dm_list **next)
+{
+	int l, r;
+
+	if (!root)
+		return 1;
+
+	if (!_check_peg_tree(pv, root->left, next))
+		return 0;
+
+	if (*next == &pv->segments ||
+	    dm_list_item(*next, struct pv_segment) != root)
+		return 0;
+	*next = (*next)->n;
+
+	if (!_check_peg_tree(pv, root->right, next))
+		return 0;
+
+	l = _peg_height(root->left);
+	r = _peg_height(root->right);
+
+	return (root->height == (l > r ? l : r) + 1) && (l - r <= 1) && (r - l <= 1);
+}
+
 /*
- * Check all pv_segments in VG for consistency
+ * Check all pv_segments in VG for consistency.
+ * With changed_only, trust the counts of PVs not marked as changed.
  */
-int check_pv_segments(struct volume_group *vg)
+int check_pv_segments(struct volume_group *vg, int changed_only)
 {
 	struct physical_volume *pv;
 	struct pv_list *pvl;
 	struct pv_segment *peg;
+	struct dm_list *next;
 	unsigned s, segno;
 	uint32_t start_pe, alloced;
 	uint32_t pv_count = 0, free_count = 0, extent_count = 0;
@@ -343,6 +575,12 @@ int check_pv_segments(struct volume_group *vg)
 		alloced = 0;
 		pv_count++;
 
+		if (changed_only && !pv->changed) {
+			extent_count += pv->pe_count;
+			free_count += pv->pe_count - pv->pe_alloc_count;
+			continue;
+		}
+
 		dm_list_iterate_items(peg, &pv->segments) {
 			s = peg->lv_area;
 
@@ -389,6 +627,16 @@ int check_pv_segments(struct volume_group *vg)
 			ret = 0;
 		}
 
+		if (pv->peg_tree) {
+			next = pv->segments.n;
+			if (!_check_peg_tree(pv, pv->peg_tree, &next) ||
+			    next != &pv->segments) {
+				log_error("PV segment index inconsistent on %s",
+					  pv_dev_name(pv));
+				ret = 0;
+			}
+		}
+
 		extent_count += start_pe;
 		free_count += (start_pe - alloced);
 	}
@@ -448,6 +696,9 @@ static int _reduce_pv(struct physical_volume *pv, struct volume_group *vg,
 			dm_list_del(&peg->list);
 	}
 
+	pv->peg_tree = NULL;
+
+	pv_set_changed(pv);
 	pv->pe_count = new_pe_count;
 
 	vg->extent_count -= (old_pe_count - new_pe_count);
@@ -475,7 +726,10 @@ static int _extend_pv(struct physical_volume *pv, struct volume_group *vg,
 		return_0;
 
 	dm_list_add(&pv->segments, &peg->list);
+	if (pv->peg_tree)
+		pv->peg_tree = _peg_tree_insert(pv->peg_tree, peg);
 
+	pv_set_changed(pv);
 	pv->pe_count = new_pe_count;
 
 	vg->extent_count += (new_pe_count - old_pe_count);
@@ -15,31 +15,164 @@
 
 #include "lib.h"
 #include "pv_map.h"
+#include "pv_alloc.h"
 
 #include <assert.h>
 
 /*
- * Areas are maintained in size order, largest first.
+ * Areas are maintained in size order, largest first, with areas of the
+ * same size kept in the order they were inserted.
+ *
+ * The list is threaded through an AVL tree with the same order so that
+ * finding where an area belongs takes O(log n) instead of walking the
+ * list, which is slow when PVs are badly fragmented.
  *
  * FIXME Cope with overlap.
  */
-static void _insert_area(struct dm_list *head, struct pv_area *a, unsigned reduced)
+static int _area_before(const struct pv_area *a, const struct pv_area *b)
 {
-	struct pv_area *pva;
-	uint32_t count = reduced ? a->unreserved : a->count;
-		
-	dm_list_iterate_items(pva, head)
-		if (count > pva->count)
-			break;
+	return (a->size_key > b->size_key) ||
+	       (a->size_key == b->size_key && a->seq < b->seq);
+}
+
+static int _height(const struct pv_area *a)
+{
+	return a ? a->height : 0;
+}
+
+static void _update_height(struct pv_area *a)
+{
+	int l = _height(a->left), r = _height(a->right);
+
+	a->height = (l > r ? l : r) + 1;
+}
+
+static struct pv_area *_rotate_right(struct pv_area *a)
+{
+	struct pv_area *l = a->left;
+
+	a->left = l->right;
+	l->right = a;
+	_update_height(a);
+	_update_height(l);
+
+	return l;
+}
+
+static struct pv_area *_rotate_left(struct pv_area *a)
+{
+	struct pv_area *r = a->right;
 
-	dm_list_add(&pva->list, &a->list);
-	a->map->pe_count += a->count;
+	a->right = r->left;
+	r->left = a;
+	_update_height(a);
+	_update_height(r);
+
+	return r;
+}
+
+static struct pv_area *_rebalance(struct pv_area *a)
+{
+	int balance = _height(a->left) - _height(a->right);
+
+	if (balance > 1) {
+		if (_height(a->left->left) < _height(a->left->right))
+			a->left = _rotate_left(a->left);
+		return _rotate_right(a);
+	}
+
+	if (balance < -1) {
+		if (_height(a->right->right) < _height(a->right->left))
+			a->right = _rotate_right(a->right);
+		return _rotate_left(a);
+	}
+
+	_update_height(a);
+
+	return a;
+}
+
+/* Sets *next to the area that follows the inserted one, if any */
+static struct pv_area *_tree_insert(struct pv_area *root, struct pv_area *a,
+				    struct pv_area **next)
+{
+	if (!root) {
+		a->left = a->right = NULL;
+		a->height = 1;
+		return a;
+	}
+
+	if (_area_before(a, root)) {
+		*next = root;
+		root->left = _tree_insert(root->left, a, next);
+	} else
+		root->right = _tree_insert(root->right, a, next);
+
+	return _rebalance(root);
+}
+
+static struct pv_area *_tree_remove_first(struct pv_area *root,
+					  struct pv_area **first)
+{
+	if (!root->left) {
+		*first = root;
+		return root->right;
+	}
+
+	root->left = _tree_remove_first(root->left, first);
+
+	return _rebalance(root);
+}
+
+static struct pv_area *_tree_remove(struct pv_area *root, struct pv_area *a)
+{
+	struct pv_area *first;
+
+	if (!root)
+		return NULL;	/* Not reached for areas in the tree */
+
+	if (root == a) {
+		if (!a->right)
+			return a->left;
+
+		a->right = _tree_remove_first(a->right, &first);
+		first->left = a->left;
+		first->right = a->right;
+
+		return _rebalance(first);
+	}
+
+	if (_area_before(a, root))
+		root->left = _tree_remove(root->left, a);
+	else
+		root->right = _tree_remove(root->right, a);
+
+	return _rebalance(root);
+}
+
+static void _insert_area(struct pv_area *a, unsigned reduced)
+{
+	struct pv_map *pvm = a->map;
+	struct pv_area *next = NULL;
+
+	a->size_key = reduced ? a->unreserved : a->count;
+	a->seq = pvm->next_seq++;
+	pvm->size_tree = _tree_insert(pvm->size_tree, a, &next);
+
+	dm_list_add(next ? &next->list : &pvm->areas, &a->list);
+	pvm->pe_count += a->count;
 }
 
 static void _remove_area(struct pv_area *a)
 {
+	a->map->size_tree = _tree_remove(a->map->size_tree, a);
 	dm_list_del(&a->list);
 	a->map->pe_count -= a->count;
+
+	if (!dm_list_empty(&a->reserved)) {
+		dm_list_del(&a->reserved);
+		dm_list_init(&a->reserved);
+	}
 }
 
 static int _create_single_area(struct dm_pool *mem, struct pv_map *pvm,
@@ -56,7 +189,8 @@ static int _create_single_area(struct dm_pool *mem, struct pv_map *pvm,
 	pva->start = start;
 	pva->count = length;
 	pva->unreserved = pva->count;
-	_insert_area(&pvm->areas, pva, 0);
+	dm_list_init(&pva->reserved);
+	_insert_area(pva, 0);
 
 	return 1;
 }
@@ -74,18 +208,15 @@ static int _create_alloc_areas_for_pv(struct dm_pool *mem, struct pv_map *pvm,
 
 	pe = start;
 
-	/* Walk through complete ordered list of device segments */
-	dm_list_iterate_items(peg, &pvm->pv->segments) {
+	/* Walk the ordered device segments from the one holding start */
+	for (peg = find_peg_by_pe(pvm->pv, start); peg;
+	     peg = next_peg(pvm->pv, peg)) {
 		/* pe holds the next extent we want to check */
 
 		/* Beyond the range we're interested in? */
 		if (pe > end)
 			break;
 
-		/* Skip if we haven't reached the first seg we want yet */
-		if (pe > peg->pe + peg->len - 1)
-			continue;
-
 		/* Free? */
 		if (peg->lvseg)
 			goto next;
@@ -153,6 +284,7 @@ static int _create_maps(struct dm_pool *mem, struct dm_list *pvs, struct dm_list
 
 			pvm->pv = pvl->pv;
 			dm_list_init(&pvm->areas);
+			dm_list_init(&pvm->reserved);
 			dm_list_add(pvms, &pvm->list);
 		}
 
@@ -199,7 +331,7 @@ void consume_pv_area(struct pv_area *pva, uint32_t to_go)
 		pva->start += to_go;
 		pva->count -= to_go;
 		pva->unreserved = pva->count;
-		_insert_area(&pva->map->areas, pva, 0);
+		_insert_area(pva, 0);
 	}
 }
 
@@ -210,7 +342,44 @@ void consume_pv_area(struct pv_area *pva, uint32_t to_go)
 void reinsert_changed_pv_area(struct pv_area *pva)
 {
 	_remove_area(pva);
-	_insert_area(&pva->map->areas, pva, 1);
+	_insert_area(pva, 1);
+
+	if (pva->unreserved != pva->count)
+		dm_list_add(&pva->map->reserved, &pva->reserved);
+}
+
+uint32_t reserve_pv_area(struct pv_area *pva, uint32_t required)
+{
+	if (required < pva->unreserved) {
+		pva->unreserved -= required;
+		reinsert_changed_pv_area(pva);
+		return required;
+	}
+
+	/* Fully reserved areas stay where they are in the list */
+	required = pva->unreserved;
+	pva->unreserved = 0;
+
+	if (dm_list_empty(&pva->reserved))
+		dm_list_add(&pva->map->reserved, &pva->reserved);
+
+	return required;
+}
+
+/*
+ * Only the areas reserved since the last call need to be looked at.
+ */
+void unreserve_pv_maps(struct dm_list *pvms)
+{
+	struct pv_map *pvm;
+	struct pv_area *pva;
+
+	dm_list_iterate_items(pvm, pvms)
+		while (!dm_list_empty(&pvm->reserved)) {
+			pva = dm_list_struct_base(pvm->reserved.n, struct pv_area, reserved);
+			pva->unreserved = pva->count;
+			reinsert_changed_pv_area(pva);
+		}
 }
 
 uint32_t pv_maps_size(struct dm_list *pvms)
@@ -35,6 +35,15 @@ struct pv_area {
 	uint32_t unreserved;
 
 	struct dm_list list;		/* pv_map.areas */
+
+	/* Position in pv_map.size_tree */
+	struct pv_area *left;
+	struct pv_area *right;
+	uint32_t size_key;		/* Size the area was sorted by */
+	uint32_t seq;			/* Orders areas of the same size */
+	int height;
+
+	struct dm_list reserved;	/* pv_map.reserved */
 };
 
 /*
@@ -56,6 +65,13 @@ struct pv_map {
 	struct dm_list areas;		/* struct pv_areas */
 	uint32_t pe_count;		/* Total number of PEs */
 
+	/* Balanced tree holding areas in the same order as the list */
+	struct pv_area *size_tree;
+	uint32_t next_seq;
+
+	/* Areas with unreserved != count */
+	struct dm_list reserved;
+
 	struct dm_list list;
 };
 
@@ -68,6 +84,17 @@ struct dm_list *create_pv_maps(struct dm_pool *mem, struct volume_group *vg,
 void consume_pv_area(struct pv_area *area, uint32_t to_go);
 void reinsert_changed_pv_area(struct pv_area *pva);
 
+/*
+ * Reserve up to required extents of an area during an allocation pass.
+ * Returns the number reserved.
+ */
+uint32_t reserve_pv_area(struct pv_area *pva, uint32_t required);
+
+/*
+ * Make all reserved extents available again.
+ */
+void unreserve_pv_maps(struct dm_list *pvms);
+
 uint32_t pv_maps_size(struct dm_list *pvms);
 
 #endif
@@ -297,7 +297,7 @@ static int _shift_and_rename_image_components(struct lv_segment *seg)
 		}
 		len = strlen(shift_name) - 1;
 		shift_name[len] -= missing;
-		seg_metalv(seg, s)->name = shift_name;
+		lv_set_name(seg_metalv(seg, s), shift_name);
 
 		/* Alter rimage name */
 		shift_name = dm_pool_strdup(cmd->mem, seg_lv(seg, s)->name);
@@ -307,7 +307,7 @@ static int _shift_and_rename_image_components(struct lv_segment *seg)
 		}
 		len = strlen(shift_name) - 1;
 		shift_name[len] -= missing;
-		seg_lv(seg, s)->name = shift_name;
+		lv_set_name(seg_lv(seg, s), shift_name);
 
 		seg->areas[s - missing] = seg->areas[s];
 		seg->meta_areas[s - missing] = seg->meta_areas[s];
@@ -574,12 +574,12 @@ static int _raid_add_images(struct logical_volume *lv,
 					return 0;
 				}
 				sprintf(name, "%s_rimage_%u", lv->name, count);
-				lvl->lv->name = name;
+				lv_set_name(lvl->lv, name);
 				continue;
 			}
 			lvl = dm_list_item(l, struct lv_list);
 			lvl_tmp = dm_list_item(l->n, struct lv_list);
-			lvl->lv->name = lvl_tmp->lv->name;
+			lv_set_name(lvl->lv, lvl_tmp->lv->name);
 		}
 	}
 
@@ -791,14 +791,14 @@ static int _extract_image_components(struct lv_segment *seg, uint32_t idx,
 	if (!tmp_name)
 		return_0;
 	sprintf(tmp_name, "%s_extracted", meta_lv->name);
-	meta_lv->name = tmp_name;
+	lv_set_name(meta_lv, tmp_name);
 
 	len = strlen(data_lv->name) + strlen("_extracted") + 1;
 	tmp_name = dm_pool_alloc(vg->vgmem, len);
 	if (!tmp_name)
 		return_0;
 	sprintf(tmp_name, "%s_extracted", data_lv->name);
-	data_lv->name = tmp_name;
+	lv_set_name(data_lv, tmp_name);
 
 	*extracted_rmeta = meta_lv;
 	*extracted_rimage = data_lv;
@@ -1114,7 +1114,7 @@ int lv_raid_split(struct logical_volume *lv, const char *split_name,
 	dm_list_iterate_items(lvl, &data_list)
 		break;
 
-	lvl->lv->name = split_name;
+	lv_set_name(lvl->lv, split_name);
 
 	if (!vg_write(lv->vg)) {
 		log_error("Failed to write changes to %s in %s",
@@ -1422,7 +1422,7 @@ static int _convert_mirror_to_raid1(struct logical_volume *lv,
 
 		sprintf(new_name, "%s_rimage_%u", lv->name, s);
 		log_debug_metadata("Renaming %s to %s", seg_lv(seg, s)->name, new_name);
-		seg_lv(seg, s)->name = new_name;
+		lv_set_name(seg_lv(seg, s), new_name);
 		seg_lv(seg, s)->status &= ~MIRROR_IMAGE;
 		seg_lv(seg, s)->status |= RAID_IMAGE;
 	}
@@ -1733,8 +1733,8 @@ try_again:
 	for (s = 0; s < raid_seg->area_count; s++) {
 		sd = s + raid_seg->area_count;
 		if (tmp_names[s] && tmp_names[sd]) {
-			seg_metalv(raid_seg, s)->name = tmp_names[s];
-			seg_lv(raid_seg, s)->name = tmp_names[sd];
+			lv_set_name(seg_metalv(raid_seg, s), tmp_names[s]);
+			lv_set_name(seg_lv(raid_seg, s), tmp_names[sd]);
 			seg_metalv(raid_seg, s)->status &= ~LV_REBUILD;
 			seg_lv(raid_seg, s)->status &= ~LV_REBUILD;
 		}
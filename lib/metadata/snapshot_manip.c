@@ -135,6 +135,10 @@ void init_snapshot_seg(struct lv_segment *seg, struct logical_volume *origin,
 	seg->origin = origin;
 	seg->cow = cow;
 
+	lv_set_changed(origin);
+	lv_set_changed(cow);
+	lv_set_changed(seg->lv);
+
 	lv_set_hidden(cow);
 
 	cow->snapshot = seg;
@@ -169,6 +173,8 @@ int init_snapshot_merge(struct lv_segment *snap_seg,
 	snap_seg->status |= MERGING;
 	origin->snapshot = snap_seg;
 	origin->status |= MERGING;
+	lv_set_changed(snap_seg->lv);
+	lv_set_changed(origin);
 
 	if (snap_seg->segtype->ops->target_present &&
 	    !snap_seg->segtype->ops->target_present(snap_seg->lv->vg->cmd,
@@ -181,9 +187,11 @@ int init_snapshot_merge(struct lv_segment *snap_seg,
 void clear_snapshot_merge(struct logical_volume *origin)
 {
 	/* clear merge attributes */
+	lv_set_changed(origin->snapshot->lv);
 	origin->snapshot->status &= ~MERGING;
 	origin->snapshot = NULL;
 	origin->status &= ~MERGING;
+	lv_set_changed(origin);
 }
 
 int vg_add_snapshot(struct logical_volume *origin,
@@ -229,6 +237,8 @@ int vg_remove_snapshot(struct logical_volume *cow)
 
 	dm_list_del(&cow->snapshot->origin_list);
 	origin->origin_count--;
+	lv_set_changed(origin);
+	lv_set_changed(cow);
 
 	if (find_merging_snapshot(origin) == find_snapshot(cow)) {
 		clear_snapshot_merge(origin);
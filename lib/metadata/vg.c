@@ -18,7 +18,8 @@
 #include "display.h"
 #include "activate.h"
 #include "toolcontext.h"
-#include "lvmcache.h"
+#include "segtype.h"
+#include "str_list.h"
 
 struct volume_group *alloc_vg(const char *pool_name, struct cmd_context *cmd,
 			      const char *vg_name)
@@ -73,6 +74,7 @@ static void _free_vg(struct volume_group *vg)
 
 	log_debug_mem("Freeing VG %s at %p.", vg->name, vg);
 
+	vg_index_destroy(vg);
 	dm_hash_destroy(vg->hostnames);
 	dm_pool_destroy(vg->vgmem);
 }
@@ -82,11 +84,6 @@ void release_vg(struct volume_group *vg)
 	if (!vg || (vg->fid && vg == vg->fid->fmt->orphan_vg))
 		return;
 
-	/* Check if there are any vginfo holders */
-	if (vg->vginfo &&
-	    !lvmcache_vginfo_holders_dec_and_test_for_zero(vg->vginfo))
-		return;
-
 	release_vg(vg->vg_ondisk);
 	_free_vg(vg);
 }
@@ -103,6 +100,386 @@ void free_orphan_vg(struct volume_group *vg)
 	_free_vg(vg);
 }
 
+/*
+ * Copies of the PVs, PV segments, LVs and LV segments of the source VG
+ * are found through a hash keyed on the address of the original.
+ */
+static int _clone_map(struct dm_hash_table *map, const void *old, void *new)
+{
+	if (!dm_hash_insert_binary(map, &old, sizeof(old), new)) {
+		log_error("Failed to record copied VG object.");
+		return 0;
+	}
+
+	return 1;
+}
+
+static int _clone_lookup(struct dm_hash_table *map, const void *old, void *new)
+{
+	void **p = new;
+
+	if (!old) {
+		*p = NULL;
+		return 1;
+	}
+
+	if (!(*p = dm_hash_lookup_binary(map, &old, sizeof(old)))) {
+		log_error(INTERNAL_ERROR "Object %p has no copy in cloned VG.", old);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Replicators keep references to other VGs and segment types other than
+ * 'unknown' do not put private data into segments we know how to copy.
+ * Returns the number of objects to map or 0 if the VG can't be cloned.
+ */
+static unsigned _vg_clone_objects(const struct volume_group *vg)
+{
+	const struct pv_list *pvl;
+	const struct lv_list *lvl;
+	const struct lv_segment *seg;
+	unsigned objects = 0;
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		objects += 1 + dm_list_size(&pvl->pv->segments);
+
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		if ((lvl->lv->status & (REPLICATOR | REPLICATOR_LOG)) ||
+		    lvl->lv->rdevice || !dm_list_empty(&lvl->lv->rsites))
+			return 0;
+
+		dm_list_iterate_items(seg, &lvl->lv->segments) {
+			if (seg_is_replicator(seg) || seg_is_replicator_dev(seg) ||
+			    seg->replicator || seg->rlog_lv ||
+			    (seg->segtype_private && !seg_unknown(seg)))
+				return 0;
+			objects++;
+		}
+
+		objects++;
+	}
+
+	return objects ? : 1;
+}
+
+static int _clone_pv(struct volume_group *vg_copy, const struct physical_volume *pv,
+		     struct dm_hash_table *map)
+{
+	struct dm_pool *mem = vg_copy->vgmem;
+	struct physical_volume *pv_copy;
+	struct pv_segment *peg, *peg_copy;
+	struct pv_list *pvl;
+
+	if (!(pvl = dm_pool_zalloc(mem, sizeof(*pvl))) ||
+	    !(pv_copy = pvl->pv = dm_pool_alloc(mem, sizeof(*pv_copy))))
+		return_0;
+
+	*pv_copy = *pv;
+	pv_copy->fid = NULL;
+	pv_copy->vg = NULL;
+
+	if (pv->vg_name && !(pv_copy->vg_name = dm_pool_strdup(mem, pv->vg_name)))
+		return_0;
+
+	if (!str_list_dup(mem, &pv_copy->tags, &pv->tags))
+		return_0;
+
+	dm_list_init(&pv_copy->segments);
+	pv_copy->peg_tree = NULL;
+	dm_list_iterate_items(peg, &pv->segments) {
+		if (!(peg_copy = dm_pool_zalloc(mem, sizeof(*peg_copy))))
+			return_0;
+
+		peg_copy->pv = pv_copy;
+		peg_copy->pe = peg->pe;
+		peg_copy->len = peg->len;
+		peg_copy->lv_area = peg->lv_area;	/* lvseg set with the LV */
+		dm_list_add(&pv_copy->segments, &peg_copy->list);
+
+		if (!_clone_map(map, peg, peg_copy))
+			return_0;
+	}
+
+	add_pvl_to_vgs(vg_copy, pvl);
+
+	return _clone_map(map, pv, pv_copy);
+}
+
+static int _clone_lv(struct volume_group *vg_copy, const struct logical_volume *lv,
+		     struct dm_hash_table *map)
+{
+	struct dm_pool *mem = vg_copy->vgmem;
+	struct logical_volume *lv_copy;
+
+	if (!(lv_copy = dm_pool_alloc(mem, sizeof(*lv_copy))))
+		return_0;
+
+	*lv_copy = *lv;
+	/* Set while the VG is processed, never stored */
+	lv_copy->status &= ~(PARTIAL_LV | POSTORDER_FLAG | POSTORDER_OPEN_FLAG);
+	lv_copy->snapshot = NULL;
+	lv_copy->rdevice = NULL;
+	lv_copy->hostname = NULL;
+	dm_list_init(&lv_copy->snapshot_segs);
+	dm_list_init(&lv_copy->rsites);
+	dm_list_init(&lv_copy->segments);
+	dm_list_init(&lv_copy->segs_using_this_lv);
+
+	if (!(lv_copy->name = dm_pool_strdup(mem, lv->name)))
+		return_0;
+
+	if (!str_list_dup(mem, &lv_copy->tags, &lv->tags))
+		return_0;
+
+	if (!link_lv_to_vg(vg_copy, lv_copy))
+		return_0;
+
+	if (lv->hostname && lv->timestamp &&
+	    !lv_set_creation(lv_copy, lv->hostname, lv->timestamp))
+		return_0;
+
+	return _clone_map(map, lv, lv_copy);
+}
+
+static int _clone_areas(struct dm_pool *mem, struct lv_segment *seg_copy,
+			const struct lv_segment_area *areas,
+			struct lv_segment_area **areas_copy,
+			struct dm_hash_table *map)
+{
+	struct pv_segment *peg_copy;
+	uint32_t s;
+
+	if (!areas) {
+		*areas_copy = NULL;
+		return 1;
+	}
+
+	if (!(*areas_copy = dm_pool_alloc(mem, seg_copy->area_count * sizeof(*areas))))
+		return_0;
+
+	for (s = 0; s < seg_copy->area_count; s++) {
+		(*areas_copy)[s] = areas[s];
+
+		switch (areas[s].type) {
+		case AREA_PV:
+			if (!_clone_lookup(map, areas[s].u.pv.pvseg, &peg_copy))
+				return_0;
+			peg_copy->lvseg = seg_copy;
+			(*areas_copy)[s].u.pv.pvseg = peg_copy;
+			break;
+		case AREA_LV:
+			if (!_clone_lookup(map, areas[s].u.lv.lv, &(*areas_copy)[s].u.lv.lv))
+				return_0;
+			break;
+		case AREA_UNASSIGNED:
+			break;
+		}
+	}
+
+	return 1;
+}
+
+static int _clone_lv_segment(struct logical_volume *lv_copy, const struct lv_segment *seg,
+			     struct dm_hash_table *map)
+{
+	struct dm_pool *mem = lv_copy->vg->vgmem;
+	struct lv_segment *seg_copy;
+	struct lv_thin_message *tmsg, *tmsg_copy;
+
+	if (!(seg_copy = dm_pool_alloc(mem, sizeof(*seg_copy))))
+		return_0;
+
+	*seg_copy = *seg;
+	seg_copy->lv = lv_copy;
+	seg_copy->pvmove_source_seg = NULL;	/* Only used during allocation */
+	dm_list_init(&seg_copy->origin_list);
+
+	if (!_clone_lookup(map, seg->origin, &seg_copy->origin) ||
+	    !_clone_lookup(map, seg->cow, &seg_copy->cow) ||
+	    !_clone_lookup(map, seg->log_lv, &seg_copy->log_lv) ||
+	    !_clone_lookup(map, seg->metadata_lv, &seg_copy->metadata_lv) ||
+	    !_clone_lookup(map, seg->external_lv, &seg_copy->external_lv) ||
+	    !_clone_lookup(map, seg->pool_lv, &seg_copy->pool_lv))
+		return_0;
+
+	if (seg->segtype_private &&
+	    !(seg_copy->segtype_private =
+	      dm_config_clone_node_with_mem(mem, seg->segtype_private, 1)))
+		return_0;
+
+	if (!str_list_dup(mem, &seg_copy->tags, &seg->tags))
+		return_0;
+
+	if (!_clone_areas(mem, seg_copy, seg->areas, &seg_copy->areas, map) ||
+	    !_clone_areas(mem, seg_copy, seg->meta_areas, &seg_copy->meta_areas, map))
+		return_0;
+
+	dm_list_init(&seg_copy->thin_messages);
+	dm_list_iterate_items(tmsg, &seg->thin_messages) {
+		if (!(tmsg_copy = dm_pool_alloc(mem, sizeof(*tmsg_copy))))
+			return_0;
+
+		*tmsg_copy = *tmsg;
+		if ((tmsg->type == DM_THIN_MESSAGE_CREATE_SNAP ||
+		     tmsg->type == DM_THIN_MESSAGE_CREATE_THIN) &&
+		    !_clone_lookup(map, tmsg->u.lv, &tmsg_copy->u.lv))
+			return_0;
+
+		dm_list_add(&seg_copy->thin_messages, &tmsg_copy->list);
+	}
+
+	dm_list_add(&lv_copy->segments, &seg_copy->list);
+
+	return _clone_map(map, seg, seg_copy);
+}
+
+/*
+ * Links between LVs through their segments, once every segment exists.
+ */
+static int _clone_lv_links(const struct logical_volume *lv, struct dm_hash_table *map)
+{
+	struct logical_volume *lv_copy;
+	struct lv_segment *seg, *seg_copy;
+	struct seg_list *sl, *sl_copy;
+
+	if (!_clone_lookup(map, lv, &lv_copy) ||
+	    !_clone_lookup(map, lv->snapshot, &lv_copy->snapshot))
+		return_0;
+
+	dm_list_iterate_items_gen(seg, &lv->snapshot_segs, origin_list) {
+		if (!_clone_lookup(map, seg, &seg_copy))
+			return_0;
+		dm_list_add(&lv_copy->snapshot_segs, &seg_copy->origin_list);
+	}
+
+	dm_list_iterate_items(sl, &lv->segs_using_this_lv) {
+		if (!(sl_copy = dm_pool_zalloc(lv_copy->vg->vgmem, sizeof(*sl_copy))) ||
+		    !_clone_lookup(map, sl->seg, &sl_copy->seg))
+			return_0;
+		sl_copy->count = sl->count;
+		dm_list_add(&lv_copy->segs_using_this_lv, &sl_copy->list);
+	}
+
+	return 1;
+}
+
+static int _clone_vg_contents(struct volume_group *vg_copy, const struct volume_group *vg,
+			      struct dm_hash_table *map)
+{
+	struct dm_pool *mem = vg_copy->vgmem;
+	const struct pv_list *pvl;
+	const struct lv_list *lvl;
+	const struct lv_segment *seg;
+	struct logical_volume *lv_copy;
+
+	vg_copy->id = vg->id;
+	vg_copy->seqno = vg->seqno;
+	/* Set while the VG is processed, never stored */
+	vg_copy->status = vg->status & ~(PARTIAL_VG | PRECOMMITTED | ARCHIVED_VG);
+	vg_copy->alloc = vg->alloc;
+	vg_copy->profile = vg->profile;
+	vg_copy->extent_size = vg->extent_size;
+	vg_copy->max_lv = vg->max_lv;
+	vg_copy->max_pv = vg->max_pv;
+	vg_copy->mda_copies = vg->mda_copies;
+
+	if (!(vg_copy->system_id = dm_pool_zalloc(mem, NAME_LEN + 1)))
+		return_0;
+
+	if (vg->system_id)
+		strncpy(vg_copy->system_id, vg->system_id, NAME_LEN);
+
+	if (!str_list_dup(mem, &vg_copy->tags, &vg->tags))
+		return_0;
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		if (!_clone_pv(vg_copy, pvl->pv, map))
+			return_0;
+
+	vg_copy->extent_count = vg->extent_count;
+	vg_copy->free_count = vg->free_count;
+
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (!_clone_lv(vg_copy, lvl->lv, map))
+			return_0;
+
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		if (!_clone_lookup(map, lvl->lv, &lv_copy))
+			return_0;
+
+		dm_list_iterate_items(seg, &lvl->lv->segments)
+			if (!_clone_lv_segment(lv_copy, seg, map))
+				return_0;
+	}
+
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (!_clone_lv_links(lvl->lv, map))
+			return_0;
+
+	return _clone_lookup(map, vg->pool_metadata_spare_lv,
+			     &vg_copy->pool_metadata_spare_lv);
+}
+
+/*
+ * Fallback for VGs we can't copy structure by structure.
+ */
+static struct volume_group *_vg_clone_by_text(struct volume_group *vg,
+					      struct format_instance *fid)
+{
+	struct dm_config_tree *cft;
+	struct volume_group *vg_copy = NULL;
+	int pool_locked;
+
+	pool_locked = dm_pool_locked(vg->vgmem);
+	if (pool_locked && !dm_pool_unlock(vg->vgmem, 0))
+		return_NULL;
+
+	if ((cft = export_vg_to_config_tree(vg))) {
+		vg_copy = import_vg_from_config_tree(cft, fid);
+		dm_config_destroy(cft);
+	}
+
+	/* recompute the pool crc */
+	if (pool_locked && !dm_pool_lock(vg->vgmem, detect_internal_vg_cache_corruption())) {
+		release_vg(vg_copy);
+		return_NULL;
+	}
+
+	return vg_copy;
+}
+
+struct volume_group *vg_clone(struct volume_group *vg, struct format_instance *fid)
+{
+	struct dm_hash_table *map;
+	struct volume_group *vg_copy;
+	unsigned objects;
+
+	if (!(objects = _vg_clone_objects(vg)))
+		return _vg_clone_by_text(vg, fid);
+
+	if (!(map = dm_hash_create(objects))) {
+		log_error("Failed to allocate VG clone map.");
+		return NULL;
+	}
+
+	if ((vg_copy = alloc_vg("clone_vg", vg->cmd, vg->name))) {
+		if (_clone_vg_contents(vg_copy, vg, map) &&
+		    (!vg_missing_pv_count(vg_copy) || vg_mark_partial_lvs(vg_copy, 1)))
+			vg_set_fid(vg_copy, fid);
+		else {
+			release_vg(vg_copy);
+			vg_copy = NULL;
+		}
+	}
+
+	dm_hash_destroy(map);
+
+	return vg_copy;
+}
+
 char *vg_fmt_dup(const struct volume_group *vg)
 {
 	if (!vg->fid || !vg->fid->fmt)
@@ -44,7 +44,6 @@ struct volume_group {
 	struct cmd_context *cmd;
 	struct dm_pool *vgmem;
 	struct format_instance *fid;
-	struct lvmcache_vginfo *vginfo;
 	struct dm_list *cmd_vgs;/* List of wanted/locked and opened VGs */
 	uint32_t cmd_missing_vgs;/* Flag marks missing VG */
 	uint32_t seqno;		/* Metadata sequence number */
@@ -122,6 +121,24 @@ struct volume_group {
 	uint32_t mda_copies; /* target number of mdas for this VG */
 
 	struct dm_hash_table *hostnames; /* map of creation hostnames */
+
+	/*
+	 * Indexes of lvs by name and lvid and of pvs by id, built on the
+	 * first lookup.  See find_lv_in_vg().
+	 */
+	struct dm_hash_table *lv_names;
+	struct dm_hash_table *lv_ids;
+	struct dm_hash_table *pv_ids;
+	unsigned lv_index_size;		/* LVs the lv indexes were sized for */
+	unsigned lv_name_dups;		/* LVs left out of lv_names as duplicates */
+	unsigned lv_id_dups;		/* LVs left out of lv_ids as duplicates */
+
+	/*
+	 * Set once the VG passed vg_validate() or the checks made on read.
+	 * Later validations only re-check the LVs and PVs changed since.
+	 */
+	unsigned validated;
+
 	struct logical_volume *pool_metadata_spare_lv; /* one per VG */
 };
 
@@ -135,6 +152,12 @@ struct volume_group *alloc_vg(const char *pool_name, struct cmd_context *cmd,
 void release_vg(struct volume_group *vg);
 void free_orphan_vg(struct volume_group *vg);
 
+/*
+ * Returns a copy of the VG in its own memory pool using format instance
+ * fid and sharing only devices and segment types with the original.
+ */
+struct volume_group *vg_clone(struct volume_group *vg, struct format_instance *fid);
+
 char *vg_fmt_dup(const struct volume_group *vg);
 char *vg_name_dup(const struct volume_group *vg);
 char *vg_system_id_dup(const struct volume_group *vg);
@@ -18,6 +18,16 @@
 
 #define INITIAL_CRC 0xf597a6cf
 
+typedef uint32_t (*crc_fn_t) (uint32_t initial, const uint8_t *buf, uint32_t size);
+
+/* Uses CPU CRC instructions where available, table lookups otherwise */
 uint32_t calc_crc(uint32_t initial, const uint8_t *buf, uint32_t size);
 
+/*
+ * The two implementations behind calc_crc(), for tests and benchmarks.
+ * calc_crc_accelerated() returns NULL if this CPU has no usable support.
+ */
+uint32_t calc_crc_sliced(uint32_t initial, const uint8_t *buf, uint32_t size);
+crc_fn_t calc_crc_accelerated(const char **name);
+
 #endif
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "lib.h"
+#include "lvm-compress.h"
+#include "lvm-string.h"
+
+#include <ctype.h>
+
+#ifdef METADATA_COMPRESSION_SUPPORT
+#include <zlib.h>
+
+/* Longest header: VG name, compression name and a 32-bit size */
+#define HEADER_MAX (NAME_LEN + sizeof(METADATA_COMPRESSION_NAME) + 14)
+
+int metadata_compression_supported(void)
+{
+	return 1;
+}
+
+int compress_metadata(const char *vgname, const char *text, uint32_t size,
+		      char **buf, uint32_t *buf_size)
+{
+	char header[HEADER_MAX];
+	int header_len;
+	uLongf len;
+	char *b;
+	int r;
+
+	if ((header_len = dm_snprintf(header, sizeof(header), "%s %s %" PRIu32 "\n",
+				      vgname, METADATA_COMPRESSION_NAME, size)) < 0) {
+		log_error(INTERNAL_ERROR "Compressed metadata header too long.");
+		return 0;
+	}
+
+	len = compressBound(size);
+	if (!(b = dm_malloc(header_len + len))) {
+		log_error("Failed to allocate buffer for compressed metadata.");
+		return 0;
+	}
+
+	memcpy(b, header, header_len);
+
+	if ((r = compress2((Bytef *) b + header_len, &len, (const Bytef *) text,
+			   size, Z_BEST_SPEED)) != Z_OK) {
+		log_error("Metadata compression failed: %s.", zError(r));
+		dm_free(b);
+		return 0;
+	}
+
+	*buf = b;
+	*buf_size = header_len + len;
+
+	return 1;
+}
+
+int uncompress_metadata(struct dm_pool *mem, const char *buf, size_t size,
+			char **text, size_t *text_size)
+{
+	const char *p = buf, *end = buf + (size < HEADER_MAX ? size : HEADER_MAX);
+	const size_t name_len = sizeof(METADATA_COMPRESSION_NAME) - 1;
+	unsigned long expected;
+	char *t, *e;
+	uLongf len;
+	int r;
+
+	/* Skip VG name */
+	while (p < end && !isspace(*p))
+		p++;
+
+	if ((end - p) < (ptrdiff_t) name_len + 3 || *p++ != ' ' ||
+	    strncmp(p, METADATA_COMPRESSION_NAME, name_len) ||
+	    p[name_len] != ' ' || !isdigit(p[name_len + 1])) {
+		log_error("Unrecognised compressed metadata header.");
+		return 0;
+	}
+
+	p += name_len + 1;
+	errno = 0;
+	expected = strtoul(p, &e, 10);
+	if (errno || e >= end || *e != '\n' || expected > UINT32_MAX) {
+		log_error("Invalid compressed metadata size.");
+		return 0;
+	}
+
+	p = e + 1;
+
+	if (!(t = dm_pool_alloc(mem, expected ? : 1))) {
+		log_error("Failed to allocate buffer for uncompressed metadata.");
+		return 0;
+	}
+
+	len = expected;
+	if ((r = uncompress((Bytef *) t, &len, (const Bytef *) p,
+			    size - (p - buf))) != Z_OK || len != expected) {
+		log_error("Metadata decompression failed: %s.",
+			  r == Z_OK ? "size mismatch" : zError(r));
+		dm_pool_free(mem, t);
+		return 0;
+	}
+
+	*text = t;
+	*text_size = len;
+
+	return 1;
+}
+
+#else /* METADATA_COMPRESSION_SUPPORT */
+
+static const char _not_compiled_msg[] = "Compressed metadata support not compiled in.";
+
+int metadata_compression_supported(void)
+{
+	return 0;
+}
+
+int compress_metadata(const char *vgname __attribute__((unused)),
+		      const char *text __attribute__((unused)),
+		      uint32_t size __attribute__((unused)),
+		      char **buf __attribute__((unused)),
+		      uint32_t *buf_size __attribute__((unused)))
+{
+	log_error(_not_compiled_msg);
+	return 0;
+}
+
+int uncompress_metadata(struct dm_pool *mem __attribute__((unused)),
+			const char *buf __attribute__((unused)),
+			size_t size __attribute__((unused)),
+			char **text __attribute__((unused)),
+			size_t *text_size __attribute__((unused)))
+{
+	log_error(_not_compiled_msg);
+	return 0;
+}
+
+#endif /* METADATA_COMPRESSION_SUPPORT */
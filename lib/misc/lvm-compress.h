@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _LVM_COMPRESS_H
+#define _LVM_COMPRESS_H
+
+/*
+ * Compressed metadata text starts with a plain header line
+ * "<vgname> zlib <uncompressed size>\n" followed by the zlib stream,
+ * so the VG name can still be found by looking at the first bytes.
+ */
+#define METADATA_COMPRESSION_NAME "zlib"
+
+int metadata_compression_supported(void);
+
+/*
+ * Returns dm_malloc'd buffer holding the header and compressed text.
+ */
+int compress_metadata(const char *vgname, const char *text, uint32_t size,
+		      char **buf, uint32_t *buf_size);
+
+/*
+ * Returns the uncompressed text allocated from mem.
+ */
+int uncompress_metadata(struct dm_pool *mem, const char *buf, size_t size,
+			char **text, size_t *text_size);
+
+#endif
@@ -47,9 +47,12 @@ static int _retry_deactivation = DEFAULT_RETRY_DEACTIVATION;
 static int _activation_checks = 0;
 static char _sysfs_dir_path[PATH_MAX] = "";
 static int _dev_disable_after_error_count = DEFAULT_DISABLE_AFTER_ERROR_COUNT;
+static int _dev_block_cache_size = DEFAULT_BLOCK_CACHE_SIZE_KB;
+static int _dev_keep_open = 0;	/* Set by tools for each command */
 static uint64_t _pv_min_size = (DEFAULT_PV_MIN_SIZE_KB * 1024L >> SECTOR_SHIFT);
 static int _detect_internal_vg_cache_corruption =
 	DEFAULT_DETECT_INTERNAL_VG_CACHE_CORRUPTION;
+static int _full_vg_validation = DEFAULT_FULL_VG_VALIDATION;
 
 void init_verbose(int level)
 {
@@ -159,6 +162,16 @@ void init_dev_disable_after_error_count(int value)
 	_dev_disable_after_error_count = value;
 }
 
+void init_dev_block_cache_size(int kb)
+{
+	_dev_block_cache_size = kb;
+}
+
+void init_dev_keep_open(int keep_open)
+{
+	_dev_keep_open = keep_open;
+}
+
 void init_pv_min_size(uint64_t sectors)
 {
 	_pv_min_size = sectors;
@@ -169,6 +182,11 @@ void init_detect_internal_vg_cache_corruption(int detect)
 	_detect_internal_vg_cache_corruption = detect;
 }
 
+void init_full_vg_validation(int full)
+{
+	_full_vg_validation = full;
+}
+
 void set_cmd_name(const char *cmd)
 {
 	strncpy(_cmd_name, cmd, sizeof(_cmd_name) - 1);
@@ -323,6 +341,16 @@ int dev_disable_after_error_count(void)
 	return _dev_disable_after_error_count;
 }
 
+int dev_block_cache_size(void)
+{
+	return _dev_block_cache_size;
+}
+
+int dev_keep_open(void)
+{
+	return _dev_keep_open;
+}
+
 uint64_t pv_min_size(void)
 {
 	return _pv_min_size;
@@ -332,3 +360,8 @@ int detect_internal_vg_cache_corruption(void)
 {
 	return _detect_internal_vg_cache_corruption;
 }
+
+int full_vg_validation(void)
+{
+	return _full_vg_validation;
+}
@@ -42,9 +42,12 @@ void init_error_message_produced(int produced);
 void init_is_static(unsigned value);
 void init_udev_checking(int checking);
 void init_dev_disable_after_error_count(int value);
+void init_dev_block_cache_size(int kb);
+void init_dev_keep_open(int keep_open);
 void init_pv_min_size(uint64_t sectors);
 void init_activation_checks(int checks);
 void init_detect_internal_vg_cache_corruption(int detect);
+void init_full_vg_validation(int full);
 void init_retry_deactivation(int retry);
 
 void set_cmd_name(const char *cmd_name);
@@ -73,6 +76,7 @@ const char *sysfs_dir_path(void);
 uint64_t pv_min_size(void);
 int activation_checks(void);
 int detect_internal_vg_cache_corruption(void);
+int full_vg_validation(void);
 int retry_deactivation(void);
 
 #define DMEVENTD_MONITOR_IGNORE -1
@@ -80,5 +84,7 @@ int dmeventd_monitor_mode(void);
 
 #define NO_DEV_ERROR_COUNT_LIMIT 0
 int dev_disable_after_error_count(void);
+int dev_block_cache_size(void);
+int dev_keep_open(void);
 
 #endif
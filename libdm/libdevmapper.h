@@ -1454,6 +1454,15 @@ struct dm_regex *dm_regex_create(struct dm_pool *mem, const char * const *patter
  */
 int dm_regex_match(struct dm_regex *regex, const char *s);
 
+/*
+ * Calculate the whole automaton now and make dm_regex_match() use a
+ * flat transition table instead of building states as it goes.
+ * Worthwhile when the same patterns are matched many times.
+ * Returns 0 if the automaton is too large, in which case matching
+ * carries on as before.
+ */
+int dm_regex_compile(struct dm_regex *regex);
+
 /*
  * This is useful for regression testing only.  The idea is if two
  * fingerprints are different, then the two dfas are certainly not
@@ -1600,6 +1609,31 @@ struct dm_config_tree *dm_config_create(void);
 struct dm_config_tree *dm_config_from_string(const char *config_settings);
 int dm_config_parse(struct dm_config_tree *cft, const char *start, const char *end);
 
+/*
+ * Like dm_config_parse(), but string values are terminated in place and
+ * point into the buffer, which must therefore be writable and outlive
+ * the tree (e.g. allocated from dm_config_memory(cft)).  Identical keys
+ * share one copy.
+ */
+int dm_config_parse_in_place(struct dm_config_tree *cft, char *start, char *end);
+
+/*
+ * Called as each section (a node with children) has been parsed, with
+ * its parent and any preceding siblings already in place.  Return 0 to
+ * abort the parse, DM_CONFIG_SECTION_KEEP to leave the section in the
+ * tree or DM_CONFIG_SECTION_DROP to discard it and release its memory.
+ */
+#define DM_CONFIG_SECTION_KEEP	1
+#define DM_CONFIG_SECTION_DROP	2
+typedef int (*dm_config_section_fn) (const struct dm_config_node *cn, void *baton);
+
+/*
+ * Like dm_config_parse_in_place(), but hands each section to section_fn
+ * so callers can consume large files without holding the whole tree.
+ */
+int dm_config_parse_sections(struct dm_config_tree *cft, char *start, char *end,
+			     dm_config_section_fn section_fn, void *baton);
+
 void *dm_config_get_custom(struct dm_config_tree *cft);
 void dm_config_set_custom(struct dm_config_tree *cft, void *custom);
 
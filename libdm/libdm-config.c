@@ -46,8 +46,42 @@ struct parser {
 	const char *tb, *te;
 
 	int line;		/* line number we are on */
+	int escaped;		/* last string token contained a backslash */
 
 	struct dm_pool *mem;
+
+	/*
+	 * Set by dm_config_parse_in_place(): strings are terminated and
+	 * left in the source buffer, keys are shared and nodes and values
+	 * are handed out from arrays of chunk_size.
+	 */
+	int in_place;
+	struct dm_hash_table *keys;
+	unsigned chunk_size;
+	struct dm_config_node *nodes;
+	unsigned nodes_left;
+	struct dm_config_value *values;
+	unsigned values_left;
+
+	/*
+	 * Set by dm_config_parse_sections().  Interned keys are also kept
+	 * in the order they were added so a dropped section can take its
+	 * own back out of the table.
+	 */
+	dm_config_section_fn section_fn;
+	void *baton;
+	const char **interned;
+	unsigned interned_count, interned_size;
+};
+
+/* Parser state to return to when a section is dropped */
+struct parser_mark {
+	void *mem;
+	struct dm_config_node *nodes;
+	unsigned nodes_left;
+	struct dm_config_value *values;
+	unsigned values_left;
+	unsigned interned_count;
 };
 
 struct config_output {
@@ -60,13 +94,17 @@ struct config_output {
 static void _get_token(struct parser *p, int tok_prev);
 static void _eat_space(struct parser *p);
 static struct dm_config_node *_file(struct parser *p);
-static struct dm_config_node *_section(struct parser *p);
+static struct dm_config_node *_section(struct parser *p,
+				       struct dm_config_node *parent);
 static struct dm_config_value *_value(struct parser *p);
 static struct dm_config_value *_type(struct parser *p);
 static int _match_aux(struct parser *p, int t);
 static struct dm_config_value *_create_value(struct dm_pool *mem);
 static struct dm_config_node *_create_node(struct dm_pool *mem);
+static struct dm_config_value *_parser_value(struct parser *p);
+static struct dm_config_node *_parser_node(struct parser *p);
 static char *_dup_tok(struct parser *p);
+static const char *_key_tok(struct parser *p);
 
 static const int sep = '/';
 
@@ -152,35 +190,89 @@ struct dm_config_tree *dm_config_insert_cascaded_tree(struct dm_config_tree *fir
 	return first_cft;
 }
 
-int dm_config_parse(struct dm_config_tree *cft, const char *start, const char *end)
+/* Roughly one node and one value per line of typical metadata */
+#define PARSE_CHUNK_MIN	16
+#define PARSE_CHUNK_MAX	1024
+
+static int _parse(struct dm_config_tree *cft, const char *start, const char *end,
+		  int in_place, dm_config_section_fn section_fn, void *baton)
 {
 	/* TODO? if (start == end) return 1; */
 
-	struct parser *p;
-	if (!(p = dm_pool_alloc(cft->mem, sizeof(*p))))
-		return_0;
+	struct parser p = { 0 };
+	int r = 1;
+
+	p.mem = cft->mem;
+	p.fb = start;
+	p.fe = end;
+	p.tb = p.te = p.fb;
+	p.line = 1;
+	p.section_fn = section_fn;
+	p.baton = baton;
+
+	if ((p.in_place = in_place)) {
+		p.chunk_size = (unsigned) ((end - start) / 32);
+		if (p.chunk_size < PARSE_CHUNK_MIN)
+			p.chunk_size = PARSE_CHUNK_MIN;
+		else if (p.chunk_size > PARSE_CHUNK_MAX)
+			p.chunk_size = PARSE_CHUNK_MAX;
+
+		/* The table does not grow: allow for a unique name per LV */
+		if (!(p.keys = dm_hash_create((unsigned) ((end - start) / 256) + 64))) {
+			log_error("Failed to allocate config key table.");
+			return 0;
+		}
+	}
 
-	p->mem = cft->mem;
-	p->fb = start;
-	p->fe = end;
-	p->tb = p->te = p->fb;
-	p->line = 1;
+	_get_token(&p, TOK_SECTION_E);
+	if (!(cft->root = _file(&p))) {
+		stack;
+		r = 0;
+	}
 
-	_get_token(p, TOK_SECTION_E);
-	if (!(cft->root = _file(p)))
-		return_0;
+	if (p.keys)
+		dm_hash_destroy(p.keys);
 
-	return 1;
+	dm_free(p.interned);
+
+	return r;
+}
+
+int dm_config_parse(struct dm_config_tree *cft, const char *start, const char *end)
+{
+	return _parse(cft, start, end, 0, NULL, NULL);
+}
+
+int dm_config_parse_in_place(struct dm_config_tree *cft, char *start, char *end)
+{
+	return _parse(cft, start, end, 1, NULL, NULL);
+}
+
+int dm_config_parse_sections(struct dm_config_tree *cft, char *start, char *end,
+			     dm_config_section_fn section_fn, void *baton)
+{
+	return _parse(cft, start, end, 1, section_fn, baton);
 }
 
 struct dm_config_tree *dm_config_from_string(const char *config_settings)
 {
 	struct dm_config_tree *cft;
+	size_t len = strlen(config_settings);
+	char *buf;
 
 	if (!(cft = dm_config_create()))
 		return_NULL;
 
-	if (!dm_config_parse(cft, config_settings, config_settings + strlen(config_settings))) {
+	/* The tree keeps its own copy to parse in place */
+	if (!(buf = dm_pool_alloc(cft->mem, len + 1))) {
+		log_error("Failed to allocate config string.");
+		dm_config_destroy(cft);
+		return NULL;
+	}
+
+	memcpy(buf, config_settings, len + 1);
+
+	if (!dm_config_parse_in_place(cft, buf, buf + len)) {
 		dm_config_destroy(cft);
 		return_NULL;
 	}
@@ -404,7 +496,11 @@ static char *_dup_string_tok(struct parser *p)
 		return NULL;
 	}
 
-	if (!(str = _dup_tok(p)))
+	if (p->in_place) {
+		/* Terminate the string over its closing quote */
+		str = (char *) p->tb;
+		*(char *) p->te = '\0';
+	} else if (!(str = _dup_tok(p)))
 		return_NULL;
 
 	p->te++;
@@ -412,13 +508,81 @@ static char *_dup_string_tok(struct parser *p)
 	return str;
 }
 
+static int _mark(struct parser *p, struct parser_mark *m)
+{
+	/* Anchors the pool position: a zero-sized object could sit at a chunk end */
+	if (!(m->mem = dm_pool_alloc(p->mem, 1)))
+		return_0;
+
+	m->nodes = p->nodes;
+	m->nodes_left = p->nodes_left;
+	m->values = p->values;
+	m->values_left = p->values_left;
+	m->interned_count = p->interned_count;
+
+	return 1;
+}
+
+static void _rollback(struct parser *p, const struct parser_mark *m)
+{
+	const char *key;
+
+	while (p->interned_count > m->interned_count) {
+		key = p->interned[--p->interned_count];
+		dm_hash_remove_binary(p->keys, key, strlen(key));
+	}
+
+	/* Chunks begun inside the section go; the rest of the old ones are reused */
+	dm_pool_free(p->mem, m->mem);
+	p->nodes = m->nodes;
+	p->nodes_left = m->nodes_left;
+	p->values = m->values;
+	p->values_left = m->values_left;
+}
+
+/*
+ * Parses the next section under parent and, if there is a section_fn,
+ * offers it for consumption.  *result is left NULL if it was dropped.
+ */
+static int _next_section(struct parser *p, struct dm_config_node *parent,
+			 struct dm_config_node **result)
+{
+	struct parser_mark m = { 0 };
+	struct dm_config_node *n;
+	int r;
+
+	if (p->section_fn && !_mark(p, &m))
+		return_0;
+
+	if (!(n = _section(p, parent)))
+		return_0;
+
+	*result = n;
+
+	if (!p->section_fn || n->v)
+		return 1;
+
+	if (!(r = p->section_fn(n, p->baton)))
+		return_0;
+
+	if (r == DM_CONFIG_SECTION_DROP) {
+		_rollback(p, &m);
+		*result = NULL;
+	}
+
+	return 1;
+}
+
 static struct dm_config_node *_file(struct parser *p)
 {
 	struct dm_config_node *root = NULL, *n, *l = NULL;
 	while (p->t != TOK_EOF) {
-		if (!(n = _section(p)))
+		if (!_next_section(p, NULL, &n))
 			return_NULL;
 
+		if (!n)
+			continue;
+
 		if (!root)
 			root = n;
 		else
@@ -429,16 +593,19 @@ static struct dm_config_node *_file(struct parser *p)
 	return root;
 }
 
-static struct dm_config_node *_section(struct parser *p)
+static struct dm_config_node *_section(struct parser *p,
+				       struct dm_config_node *parent)
 {
 	/* IDENTIFIER SECTION_B_CHAR VALUE* SECTION_E_CHAR */
 	struct dm_config_node *root, *n, *l = NULL;
-	if (!(root = _create_node(p->mem))) {
+	if (!(root = _parser_node(p))) {
 		log_error("Failed to allocate section node");
 		return NULL;
 	}
 
-	if (!(root->key = _dup_tok(p)))
+	root->parent = parent;
+
+	if (!(root->key = _key_tok(p)))
 		return_NULL;
 
 	match(TOK_IDENTIFIER);
@@ -446,14 +613,16 @@ static struct dm_config_node *_section(struct parser *p)
 	if (p->t == TOK_SECTION_B) {
 		match(TOK_SECTION_B);
 		while (p->t != TOK_SECTION_E) {
-			if (!(n = _section(p)))
+			if (!_next_section(p, root, &n))
 				return_NULL;
 
+			if (!n)
+				continue;
+
 			if (!l)
 				root->child = n;
 			else
 				l->sib = n;
-			n->parent = root;
 			l = n;
 		}
 		match(TOK_SECTION_E);
@@ -490,7 +659,7 @@ static struct dm_config_value *_value(struct parser *p)
 		 * Special case for an empty array.
 		 */
 		if (!h) {
-			if (!(h = _create_value(p->mem))) {
+			if (!(h = _parser_value(p))) {
 				log_error("Failed to allocate value");
 				return NULL;
 			}
@@ -508,7 +677,7 @@ static struct dm_config_value *_value(struct parser *p)
 static struct dm_config_value *_type(struct parser *p)
 {
 	/* [+-]{0,1}[0-9]+ | [0-9]*\.[0-9]* | ".*" */
-	struct dm_config_value *v = _create_value(p->mem);
+	struct dm_config_value *v = _parser_value(p);
 	char *str;
 
 	if (!v) {
@@ -543,7 +712,8 @@ static struct dm_config_value *_type(struct parser *p)
 
 		if (!(str = _dup_string_tok(p)))
 			return_NULL;
-		dm_unescape_double_quotes(str);
+		if (p->escaped)
+			dm_unescape_double_quotes(str);
 		v->v.str = str;
 		match(TOK_STRING_ESCAPED);
 		break;
@@ -568,6 +738,13 @@ static int _match_aux(struct parser *p, int t)
 /*
  * tokeniser
  */
+/* Characters that end an identifier: NUL, whitespace, '#', '=', '{' and '}' */
+static const char _ident_end[256] = {
+	[0] = 1, [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1,
+	['\r'] = 1, ['#'] = 1, ['='] = 1,
+	[SECTION_B_CHAR] = 1, [SECTION_E_CHAR] = 1
+};
+
 static void _get_token(struct parser *p, int tok_prev)
 {
 	int values_allowed = 0;
@@ -623,11 +800,14 @@ static void _get_token(struct parser *p, int tok_prev)
 
 	case '"':
 		p->t = TOK_STRING_ESCAPED;
+		p->escaped = 0;
 		te++;
 		while ((te != p->fe) && (*te) && (*te != '"')) {
-			if ((*te == '\\') && (te + 1 != p->fe) &&
-			    *(te + 1))
-				te++;
+			if (*te == '\\') {
+				p->escaped = 1;
+				if ((te + 1 != p->fe) && *(te + 1))
+					te++;
+			}
 			te++;
 		}
 
@@ -678,10 +858,7 @@ static void _get_token(struct parser *p, int tok_prev)
 
 	default:
 		p->t = TOK_IDENTIFIER;
-		while ((te != p->fe) && (*te) && !isspace(*te) &&
-		       (*te != '#') && (*te != '=') &&
-		       (*te != SECTION_B_CHAR) &&
-		       (*te != SECTION_E_CHAR))
+		while ((te != p->fe) && !_ident_end[(unsigned char) *te])
 			te++;
 		break;
 	}
@@ -691,22 +868,27 @@ static void _get_token(struct parser *p, int tok_prev)
 
 static void _eat_space(struct parser *p)
 {
-	while (p->tb != p->fe) {
-		if (*p->te == '#')
-			while ((p->te != p->fe) && (*p->te != '\n') && (*p->te))
-				++p->te;
+	/* Work on locals: stores through p would force reloads per byte */
+	const char *te = p->te, *fe = p->fe;
+	int line = p->line;
+
+	while (te != fe) {
+		if (*te == '#')
+			while ((te != fe) && (*te != '\n') && (*te))
+				++te;
 
-		else if (!isspace(*p->te))
+		else if (!isspace(*te))
 			break;
 
-		while ((p->te != p->fe) && isspace(*p->te)) {
-			if (*p->te == '\n')
-				++p->line;
-			++p->te;
+		while ((te != fe) && isspace(*te)) {
+			if (*te == '\n')
+				++line;
+			++te;
 		}
-
-		p->tb = p->te;
 	}
+
+	p->tb = p->te = te;
+	p->line = line;
 }
 
 /*
@@ -735,6 +917,84 @@ static char *_dup_tok(struct parser *p)
 	return str;
 }
 
+static struct dm_config_node *_parser_node(struct parser *p)
+{
+	if (!p->in_place)
+		return _create_node(p->mem);
+
+	if (!p->nodes_left) {
+		if (!(p->nodes = dm_pool_alloc(p->mem, sizeof(*p->nodes) *
+					       p->chunk_size)))
+			return_NULL;
+		p->nodes_left = p->chunk_size;
+	}
+
+	/* Cleared here as slots are reused after a dropped section */
+	memset(p->nodes, 0, sizeof(*p->nodes));
+	p->nodes_left--;
+
+	return p->nodes++;
+}
+
+static struct dm_config_value *_parser_value(struct parser *p)
+{
+	if (!p->in_place)
+		return _create_value(p->mem);
+
+	if (!p->values_left) {
+		if (!(p->values = dm_pool_alloc(p->mem, sizeof(*p->values) *
+						p->chunk_size)))
+			return_NULL;
+		p->values_left = p->chunk_size;
+	}
+
+	memset(p->values, 0, sizeof(*p->values));
+	p->values_left--;
+
+	return p->values++;
+}
+
+/*
+ * Keys repeat on every PV, LV and segment, so when parsing in place
+ * each distinct key is stored only once.
+ */
+static const char *_key_tok(struct parser *p)
+{
+	size_t len = p->te - p->tb;
+	const char **interned;
+	unsigned size;
+	char *str;
+
+	if (!p->in_place)
+		return _dup_tok(p);
+
+	if ((str = dm_hash_lookup_binary(p->keys, p->tb, len)))
+		return str;
+
+	if (!(str = _dup_tok(p)))
+		return_NULL;
+
+	if (!dm_hash_insert_binary(p->keys, str, len, str)) {
+		log_error("Failed to intern config key.");
+		return NULL;
+	}
+
+	if (p->section_fn) {
+		if (p->interned_count == p->interned_size) {
+			size = p->interned_size ? p->interned_size * 2 : 64;
+			if (!(interned = dm_realloc(p->interned, sizeof(*interned) * size))) {
+				log_error("Failed to allocate config key list.");
+				return NULL;
+			}
+			p->interned = interned;
+			p->interned_size = size;
+		}
+		p->interned[p->interned_count++] = str;
+	}
+
+	return str;
+}
+
 /*
  * Utility functions
  */
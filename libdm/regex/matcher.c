@@ -21,12 +21,29 @@
 struct dfa_state {
 	struct dfa_state *next;
 	int final;
+	unsigned id;		/* 1-based; 0 is the dead state in a dfa_table */
 	dm_bitset_t bits;
 	struct dfa_state *lookup[256];
 };
 
+/*
+ * The whole automaton as one flat transition table.  Bytes that lead
+ * to the same transitions from every state share a class, so each
+ * row only needs one column per class.
+ */
+#define DFA_TABLE_MAX_STATES 4096
+
+struct dfa_table {
+	unsigned num_classes;
+	uint8_t classes[256];
+	uint16_t *trans;	/* [state * num_classes + class] */
+	int *final;		/* [state] */
+};
+
 struct dm_regex {		/* Instance variables for the lexer */
 	struct dfa_state *start;
+	struct dfa_table *table;	/* Set by dm_regex_compile() */
+	unsigned num_states;
 	unsigned num_nodes;
         unsigned num_charsets;
 	int nodes_entered;
@@ -203,9 +220,14 @@ static void _calc_functions(struct dm_regex *m)
 	}
 }
 
-static struct dfa_state *_create_dfa_state(struct dm_pool *mem)
+static struct dfa_state *_create_dfa_state(struct dm_regex *m)
 {
-	return dm_pool_zalloc(mem, sizeof(struct dfa_state));
+	struct dfa_state *dfa;
+
+	if ((dfa = dm_pool_zalloc(m->mem, sizeof(struct dfa_state))))
+		dfa->id = ++m->num_states;
+
+	return dfa;
 }
 
 static struct dfa_state *_create_state_queue(struct dm_pool *mem,
@@ -242,7 +264,7 @@ static int _calc_state(struct dm_regex *m, struct dfa_state *dfa, int a)
                 struct dfa_state *ldfa = ttree_lookup(m->tt, m->bs + 1);
                 if (!ldfa) {
                         /* push */
-			if (!(ldfa = _create_dfa_state(m->mem)))
+			if (!(ldfa = _create_dfa_state(m)))
 				return_0;
 
 			ttree_insert(m->tt, m->bs + 1, ldfa);
@@ -292,7 +314,7 @@ static int _calc_states(struct dm_regex *m, struct rx_node *rx)
         }
 
 	/* create first state */
-	if (!(dfa = _create_dfa_state(m->mem)))
+	if (!(dfa = _create_dfa_state(m)))
 		return_0;
 
 	m->start = dfa;
@@ -311,14 +333,18 @@ static int _calc_states(struct dm_regex *m, struct rx_node *rx)
 /*
  * Forces all the dfa states to be calculated up front, ie. what
  * _calc_states() used to do before we switched to calculating on demand.
+ * Gives up once there are more than max_states states, if that is set.
  */
-static int _force_states(struct dm_regex *m)
+static int _force_states(struct dm_regex *m, unsigned max_states)
 {
         int a;
 
         /* keep processing until there's nothing in the queue */
         struct dfa_state *s;
         while ((s = m->h)) {
+		if (max_states && m->num_states > max_states)
+			return 0;
+
                 /* pop state off front of the queue */
                 m->h = m->h->next;
 
@@ -418,11 +444,144 @@ static struct dfa_state *_step_matcher(struct dm_regex *m, int c, struct dfa_sta
 	return ns;
 }
 
+/*
+ * Bytes are in the same class if they belong to exactly the same
+ * charsets, and so take every state to the same place.
+ */
+static unsigned _calc_classes(struct dm_regex *m, uint8_t *classes)
+{
+	size_t len = (m->num_charsets / DM_BITS_PER_INT + 1) * sizeof(int);
+	unsigned a, b, num_classes = 0;
+
+	for (a = 0; a < 256; a++) {
+		for (b = 0; b < a; b++)
+			if (!memcmp(m->charmap[a] + 1, m->charmap[b] + 1, len))
+				break;
+
+		classes[a] = (b < a) ? classes[b] : num_classes++;
+	}
+
+	return num_classes;
+}
+
+/* Index every state by id, walking the transitions from the start */
+static int _collect_states(struct dm_regex *m, struct dfa_state **states)
+{
+	struct dfa_state **pending, *s, *ns;
+	unsigned sp = 0;
+	int a;
+
+	if (!(pending = dm_malloc(sizeof(*pending) * m->num_states)))
+		return_0;
+
+	states[m->start->id] = m->start;
+	pending[sp++] = m->start;
+
+	while (sp) {
+		s = pending[--sp];
+		for (a = 0; a < 256; a++)
+			if ((ns = s->lookup[a]) && !states[ns->id]) {
+				states[ns->id] = ns;
+				pending[sp++] = ns;
+			}
+	}
+
+	dm_free(pending);
+
+	return 1;
+}
+
+int dm_regex_compile(struct dm_regex *regex)
+{
+	struct dfa_table *t;
+	struct dfa_state **states = NULL, *s;
+	unsigned i, rows;
+	int a, r = 0;
+
+	if (regex->table)
+		return 1;
+
+	dm_bit_clear_all(regex->bs);
+	if (!_force_states(regex, DFA_TABLE_MAX_STATES)) {
+		log_debug("Regex automaton has over %u states: "
+			  "not compiling it.", DFA_TABLE_MAX_STATES);
+		return 0;
+	}
+
+	rows = regex->num_states + 1;
+
+	if (!(t = dm_pool_zalloc(regex->mem, sizeof(*t))))
+		return_0;
+
+	t->num_classes = _calc_classes(regex, t->classes);
+
+	if (!(t->trans = dm_pool_zalloc(regex->mem, sizeof(*t->trans) *
+					rows * t->num_classes)) ||
+	    !(t->final = dm_pool_zalloc(regex->mem, sizeof(*t->final) * rows)) ||
+	    !(states = dm_zalloc(sizeof(*states) * rows)) ||
+	    !_collect_states(regex, states))
+		goto_out;
+
+	/* Row 0 is the dead state: all zero */
+	for (i = 1; i < rows; i++) {
+		if (!(s = states[i]))
+			continue;
+
+		t->final[i] = (s->final > 0) ? s->final : 0;
+
+		for (a = 0; a < 256; a++)
+			if (s->lookup[a])
+				t->trans[i * t->num_classes + t->classes[a]] =
+					(uint16_t) s->lookup[a]->id;
+	}
+
+	regex->table = t;
+	r = 1;
+out:
+	dm_free(states);
+
+	return r;
+}
+
+static int _match_table(const struct dfa_table *t, unsigned start,
+			const unsigned char *s)
+{
+	const uint16_t *trans = t->trans;
+	const uint8_t *classes = t->classes;
+	const int *final = t->final;
+	unsigned nc = t->num_classes;
+	unsigned cs;
+	int r;
+
+	/*
+	 * Stepping a dfa is inherently serial, so the loop is kept free
+	 * of branches instead: the dead state loops back to itself and
+	 * is never final.
+	 */
+	cs = trans[start * nc + classes[HAT_CHAR]];
+	r = final[cs];
+
+	for (; *s; s++) {
+		cs = trans[cs * nc + classes[*s]];
+		r = (final[cs] > r) ? final[cs] : r;
+	}
+
+	cs = trans[cs * nc + classes[DOLLAR_CHAR]];
+	r = (final[cs] > r) ? final[cs] : r;
+
+	/* subtract 1 to get back to zero index */
+	return r - 1;
+}
+
 int dm_regex_match(struct dm_regex *regex, const char *s)
 {
 	struct dfa_state *cs = regex->start;
 	int r = 0;
 
+	if (regex->table)
+		return _match_table(regex->table, regex->start->id,
+				    (const unsigned char *) s);
+
         dm_bit_clear_all(regex->bs);
 	if (!(cs = _step_matcher(regex, HAT_CHAR, cs, &r)))
 		goto out;
@@ -556,7 +715,7 @@ uint32_t dm_regex_fingerprint(struct dm_regex *regex)
 	if (!mem)
 		return_0;
 
-	if (!_force_states(regex))
+	if (!_force_states(regex, 0))
 		goto_out;
 
         p.mem = mem;
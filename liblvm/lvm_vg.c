@@ -145,6 +145,8 @@ int lvm_vg_write(vg_t vg)
 	if (!vg_write(vg) || !vg_commit(vg))
 		return -1;
 
+	archive_expire(vg->cmd);
+
 	if (! dm_list_empty(&vg->removed_pvs)) {
 		dm_list_iterate_items(pvl, &vg->removed_pvs) {
 			pv_write_orphan(vg->cmd, pvl->pv);
@@ -164,6 +166,7 @@ int lvm_vg_close(vg_t vg)
 		release_vg(vg);
 	else
 		unlock_and_release_vg(vg->cmd, vg, vg->name);
+	dev_close_all();
 	return 0;
 }
 
@@ -383,5 +386,6 @@ int lvm_scan(lvm_t libh)
 {
 	if (!lvmcache_label_scan((struct cmd_context *)libh, 2))
 		return -1;
+	dev_close_all();
 	return 0;
 }
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/*
+ * Reopens a VG through the same handle, so that lvmcache hands out
+ * copies of the VG it keeps, while the VG is changed on disk by the
+ * command given as the second argument.
+ */
+
+#undef NDEBUG
+
+#include "lvm2app.h"
+#include "assert.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int _has_tag(vg_t vg, const char *tag)
+{
+	struct dm_list *tags;
+	struct lvm_str_list *strl;
+
+	tags = lvm_vg_get_tags(vg);
+	assert(tags);
+
+	dm_list_iterate_items(strl, tags)
+		if (!strcmp(strl->str, tag))
+			return 1;
+
+	return 0;
+}
+
+static int _lv_count(vg_t vg)
+{
+	struct dm_list *lvs;
+
+	if (!(lvs = lvm_vg_list_lvs(vg)))
+		return 0;
+
+	return dm_list_size(lvs);
+}
+
+int main(int argc, char *argv[])
+{
+	lvm_t handle;
+	vg_t vg;
+	uint64_t seqno;
+	int lvs;
+
+	assert(argc == 3);
+
+	handle = lvm_init(NULL);
+	assert(handle);
+
+	vg = lvm_vg_open(handle, argv[1], "r", 0);
+	assert(vg);
+	seqno = lvm_vg_get_seqno(vg);
+	lvs = _lv_count(vg);
+	lvm_vg_close(vg);
+
+	/* Changes that are not written stay in the caller's copy */
+	vg = lvm_vg_open(handle, argv[1], "w", 0);
+	assert(vg);
+	assert(!lvm_vg_add_tag(vg, "unwritten"));
+	assert(_has_tag(vg, "unwritten"));
+	lvm_vg_close(vg);
+
+	vg = lvm_vg_open(handle, argv[1], "r", 0);
+	assert(vg);
+	assert(lvm_vg_get_seqno(vg) == seqno);
+	assert(!_has_tag(vg, "unwritten"));
+	assert(_lv_count(vg) == lvs);
+	lvm_vg_close(vg);
+
+	/* Another process changes the VG behind the cached copy */
+	assert(!system(argv[2]));
+
+	vg = lvm_vg_open(handle, argv[1], "r", 0);
+	assert(vg);
+	fprintf(stderr, "seqno %d -> %d\n", (int) seqno,
+		(int) lvm_vg_get_seqno(vg));
+	assert(lvm_vg_get_seqno(vg) > seqno);
+	assert(_has_tag(vg, "changed"));
+	assert(_lv_count(vg) == lvs + 1);
+	lvm_vg_close(vg);
+
+	lvm_quit(handle);
+
+	return 0;
+}
@@ -0,0 +1,26 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This file is part of LVM2.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+. lib/test
+
+aux prepare_vg 2
+
+lvcreate -l1 -n $lv1 $vg
+
+aux apitest vgcache $vg "vgchange --addtag changed $vg && lvcreate -l1 -n $lv2 $vg"
+
+check lv_exists $vg $lv2
+vgs -o tags --noheadings $vg | grep changed
+not vgs -o tags --noheadings $vg | grep unwritten
+
+vgremove -ff $vg
@@ -0,0 +1,47 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Metadata archives are tracked by a per-VG index'
+
+. lib/test
+
+aux prepare_pvs 2
+vgcreate -c n $vg "$dev1" "$dev2"
+
+ARCHIVE=$(pwd)/archive
+aux lvmconf 'backup/archive = 1' \
+	    "backup/archive_dir = \"$ARCHIVE\"" \
+	    'backup/retain_min = 3' \
+	    'backup/retain_days = 0'
+
+for i in 1 2 3 4 5; do
+	vgchange --addtag tag$i $vg
+done
+
+# Only retain_min archives are left and the index lists just those
+test $(ls "$ARCHIVE"/${vg}_*.vg | wc -l) -eq 3
+test $(wc -l < "$ARCHIVE/.$vg.index") -eq 3
+for f in "$ARCHIVE"/${vg}_*.vg; do
+	grep " ${f##*/}\$" "$ARCHIVE/.$vg.index"
+done
+
+# Index is rebuilt when missing or stale
+rm -f "$ARCHIVE/.$vg.index"
+vgchange --addtag tag6 $vg
+test $(wc -l < "$ARCHIVE/.$vg.index") -eq 3
+rm -f "$ARCHIVE"/${vg}_*.vg
+vgchange --addtag tag7 $vg
+test $(ls "$ARCHIVE"/${vg}_*.vg | wc -l) -eq 1
+test $(wc -l < "$ARCHIVE/.$vg.index") -eq 1
+
+vgcfgrestore -l $vg | grep "$ARCHIVE/${vg}_"
+
+vgremove -ff $vg
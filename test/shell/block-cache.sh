@@ -0,0 +1,46 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Cached device blocks follow writes and survive evictions'
+
+. lib/test
+
+aux prepare_pvs 4
+vgcreate -c n $vg "$dev1" "$dev2" "$dev3"
+
+aux lvmconf 'devices/keep_devices_open = 1'
+
+# 16 KiB holds four blocks, so metadata reads keep evicting each other
+for size in 16 64 4096; do
+	aux lvmconf "devices/block_cache_size = $size"
+
+	lvcreate -an -Zn -l1 -n lv$size $vg
+	# One process writes the VG once per PV and rereads what it wrote
+	pvchange --addtag pv$size "$dev1" "$dev2" "$dev3"
+	vgextend $vg "$dev4"
+	vgreduce $vg "$dev4"
+	vgchange --addtag vg$size $vg
+	vgck $vg
+
+	pvs -o pv_name,pv_tags,vg_name,vg_seqno --noheadings > cached
+	lvs -o lv_name,vg_tags --noheadings $vg >> cached
+
+	aux lvmconf 'devices/block_cache_size = 0'
+	pvs -o pv_name,pv_tags,vg_name,vg_seqno --noheadings > uncached
+	lvs -o lv_name,vg_tags --noheadings $vg >> uncached
+	diff -u cached uncached
+
+	grep "pv$size" uncached
+	grep "vg$size" uncached
+	vgck $vg
+done
+
+vgremove -ff $vg
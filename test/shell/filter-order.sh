@@ -0,0 +1,32 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Reordered and memoized filters must give the same verdicts'
+
+. lib/test
+
+aux prepare_devs 5
+
+pvcreate "$dev1" "$dev2" "$dev3"
+
+# Reject one PV by name: the regex verdict must not be reused for it
+aux lvmconf "devices/filter = [ \"r|$dev2|\", \"a|.*|\" ]"
+pvs -o pv_name --noheadings > out
+grep "$dev1" out
+not grep "$dev2" out
+grep "$dev3" out
+
+vgscan -v 2>err
+grep "Filter regex:" err
+
+aux lvmconf "devices/filter = [ \"a|.*|\" ]"
+pvs -o pv_name --noheadings > out
+grep "$dev2" out
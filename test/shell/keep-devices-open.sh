@@ -0,0 +1,37 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Devices are opened once per command and LVs are not held open'
+
+. lib/test
+
+aux prepare_vg 2
+
+aux lvmconf "devices/keep_devices_open = 1"
+
+# Scan and metadata read share one descriptor
+vgs -vvvv $vg 2>err
+test $(grep -c "Opened $dev1 " err) -eq 1
+
+# Read-only open is upgraded once for the commit
+lvcreate -an -Zn -l1 -n $lv1 $vg -vvvv 2>err
+test $(grep -c "Opened $dev1 RW" err) -eq 1
+
+# An active LV scanned by the command can still be deactivated
+lvcreate -l1 -n $lv2 $vg
+lvchange -an $vg/$lv2
+lvremove -f $vg
+
+aux lvmconf "devices/keep_devices_open = 0"
+vgs -vvvv $vg 2>err
+test $(grep -c "Opened $dev1 " err) -gt 1
+
+vgremove -ff $vg
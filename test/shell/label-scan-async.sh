@@ -0,0 +1,37 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Batched label scan must find the same PVs as the serial scan'
+
+. lib/test
+
+aux prepare_devs 5
+
+pvcreate "$dev1" "$dev2" "$dev3"
+vgcreate $vg "$dev1" "$dev2"
+
+aux lvmconf 'devices/async_label_scan = 0'
+pvs -o pv_name,vg_name,pv_uuid --noheadings > serial
+vgs -o vg_name,vg_uuid,pv_count --noheadings >> serial
+
+aux lvmconf 'devices/async_label_scan = 1'
+pvs -o pv_name,vg_name,pv_uuid --noheadings > batched
+vgs -o vg_name,vg_uuid,pv_count --noheadings >> batched
+
+diff -u serial batched
+
+# Devices that vanish must still be handled
+aux disable_dev "$dev3"
+pvs -o pv_name --noheadings > out
+not grep "$dev3" out
+aux enable_dev "$dev3"
+
+vgremove -ff $vg
@@ -0,0 +1,44 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Compressed metadata areas read back like plain ones'
+
+. lib/test
+
+aux prepare_pvs 3
+vgcreate -c n $vg "$dev1" "$dev2" "$dev3"
+for i in 1 2 3 4 5 6 7 8 9 10; do
+	vgchange --addtag tag$i $vg
+done
+vgs -o vg_name,vg_uuid,vg_tags,pv_count --noheadings > plain
+
+aux lvmconf 'metadata/compress = 1'
+vgchange --addtag compressed $vg 2> err
+grep "not compiled in" err && skip
+
+vgs -o vg_tags --noheadings $vg | grep compressed
+vgchange --deltag compressed $vg
+vgs -o vg_name,vg_uuid,vg_tags,pv_count --noheadings > compressed
+diff -u plain compressed
+
+# Reading does not depend on the setting
+aux lvmconf 'metadata/compress = 0'
+vgs -o vg_name,vg_uuid,vg_tags,pv_count --noheadings > compressed
+diff -u plain compressed
+pvs "$dev1" "$dev2" "$dev3"
+
+# The next write stores plain text again
+vgchange --addtag plain $vg
+vgchange --deltag plain $vg
+vgs -o vg_name,vg_uuid,vg_tags,pv_count --noheadings > compressed
+diff -u plain compressed
+
+vgremove -ff $vg
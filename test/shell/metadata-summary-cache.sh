@@ -0,0 +1,33 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Metadata summaries must not hide changes made behind their back'
+
+. lib/test
+
+test -e LOCAL_LVMETAD && skip
+
+aux prepare_pvs 2
+
+vgcreate $vg "$dev1" "$dev2"
+vgs $vg
+test -f $TESTDIR/etc/.cache.mda
+
+# Rename without updating the summaries
+aux lvmconf 'devices/metadata_summary_cache = 0'
+vgrename $vg $vg1
+aux lvmconf 'devices/metadata_summary_cache = 1'
+
+vgs $vg1
+not vgs $vg
+check pv_field "$dev1" vg_name $vg1
+
+vgremove -ff $vg1
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Metadata written to many PVs in one batch must reach every metadata area'
+
+. lib/test
+
+aux prepare_devs 4
+
+pvcreate --metadatacopies 2 "$dev1" "$dev2" "$dev3"
+pvcreate --metadatacopies 0 "$dev4"
+vgcreate $vg "$dev1" "$dev2" "$dev3" "$dev4"
+check vg_field $vg vg_mda_count 6
+
+# The header writes of a commit go out together
+lvcreate -an -Zn -l1 -n $lv1 $vg -vvvv 2>err
+grep "Wrote [0-9]* queued region(s)" err
+
+for i in 2 3 4 5; do
+	lvcreate -an -Zn -l1 -n lv$i $vg
+done
+vgck $vg
+seqno=$(get vg_field $vg vg_seqno)
+
+# Each PV with metadata holds the latest copy on its own
+aux hide_dev "$dev2" "$dev3"
+test $(get vg_field $vg vg_seqno -P) -eq $seqno
+test $(get vg_field $vg lv_count -P) -eq 5
+aux unhide_dev "$dev2" "$dev3"
+
+aux hide_dev "$dev1" "$dev3"
+test $(get vg_field $vg vg_seqno -P) -eq $seqno
+aux unhide_dev "$dev1" "$dev3"
+
+aux hide_dev "$dev1" "$dev2"
+test $(get vg_field $vg vg_seqno -P) -eq $seqno
+aux unhide_dev "$dev1" "$dev2"
+
+vgck $vg
+vgremove -ff $vg
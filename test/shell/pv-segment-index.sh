@@ -0,0 +1,60 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='PV segments stay consistent through splits, merges and resizes'
+
+. lib/test
+
+aux prepare_pvs 2
+vgcreate -c n -s 128k $vg "$dev1" "$dev2"
+
+# Interleave extensions so every PV segment gets split repeatedly
+for i in 1 2 3 4 5 6; do
+	lvcreate -an -Zn -l1 -n lv$i $vg "$dev1"
+done
+for j in 1 2 3; do
+	for i in 1 2 3 4 5 6; do
+		lvextend -l+1 $vg/lv$i "$dev1"
+	done
+done
+vgck $vg
+
+# Freeing every other LV merges the holes between its areas
+lvremove -f $vg/lv2 $vg/lv4 $vg/lv6
+vgck $vg
+
+lvcreate -an -Zn -l6 -n lv7 $vg "$dev1"
+lvreduce -f -l-2 $vg/lv1
+vgck $vg
+
+# The layout survives a metadata round trip
+pvs --noheadings --segments -o pv_name,pvseg_start,pvseg_size,lv_name "$dev1" > before
+vgcfgbackup -f backup $vg
+vgcfgrestore -f backup $vg
+pvs --noheadings --segments -o pv_name,pvseg_start,pvseg_size,lv_name "$dev1" > after
+diff before after
+
+# Shrinking and growing the PV trims and extends its last free segment
+pe_count=$(get pv_field "$dev1" pv_pe_count)
+alloc=$(get pv_field "$dev1" pv_pe_alloc_count)
+pvresize --setphysicalvolumesize 8M "$dev1"
+vgck $vg
+check pv_field "$dev1" pv_pe_alloc_count $alloc
+test $(get pv_field "$dev1" pv_pe_count) -lt $pe_count
+pvresize "$dev1"
+vgck $vg
+check pv_field "$dev1" pv_pe_count $pe_count
+check pv_field "$dev1" pv_pe_alloc_count $alloc
+
+lvextend -l+4 $vg/lv1 "$dev1"
+vgck $vg
+
+vgremove -ff $vg
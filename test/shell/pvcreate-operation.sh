@@ -137,3 +137,12 @@ blkid -c /dev/null "$dev1" | grep "swap"
 pvcreate -f "$dev1"
 # blkid cannot make up its mind whether not finding anything it knows is a failure or not
 (blkid -c /dev/null "$dev1" || true) | not grep "swap"
+
+# pvcreate wipes every signature found by a single probe
+dd if=/dev/zero of="$dev1" bs=1024 count=64
+printf 'LUKS\272\276' | dd of="$dev1" conv=notrunc
+printf 'SWAPSPACE2' | dd of="$dev1" bs=1 seek=4086 conv=notrunc
+pvcreate -f "$dev1" 2>err
+grep "Wiping swap signature" err
+grep "Wiping LUKS signature" err
+pvremove -f "$dev1"
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Device list read from sysfs must name devices like the directory scan'
+
+. lib/test
+
+aux prepare_pvs 3
+vgcreate $vg "$dev1" "$dev2"
+lvcreate -l1 -n $lv1 $vg
+
+aux lvmconf 'devices/obtain_device_list_from_sysfs = 0'
+pvs -o pv_name,vg_name,pv_uuid --noheadings > scanned
+lvs -o lv_name,devices --noheadings $vg >> scanned
+
+aux lvmconf 'devices/obtain_device_list_from_sysfs = 1'
+pvs -o pv_name,vg_name,pv_uuid --noheadings > sysfs
+lvs -o lv_name,devices --noheadings $vg >> sysfs
+
+diff -u scanned sysfs
+
+# Lookups by name and by device number
+pvs "$dev3"
+vgextend $vg "$dev3"
+check pv_field "$dev3" vg_name $vg
+
+# Persistent names in /dev/disk are only seen through the links there
+mkdir -p "$DM_DEV_DIR/disk/by-id"
+ln -s "$dev1" "$DM_DEV_DIR/disk/by-id/lvm-test-pv1"
+ln -s "$dev2" "$DM_DEV_DIR/disk/by-id/lvm-test-pv2"
+ln -s "$dev3" "$DM_DEV_DIR/disk/by-id/lvm-test-pv3"
+aux lvmconf 'devices/obtain_device_list_from_udev = 0' \
+	    "devices/filter = [ \"a|$DM_DEV_DIR/disk/by-id/lvm-test-|\", \"r|.*|\" ]"
+pvs -o pv_name --noheadings > by-id
+test $(grep -c "$DM_DEV_DIR/disk/by-id/lvm-test-pv" by-id) -eq 3
+check pv_field "$DM_DEV_DIR/disk/by-id/lvm-test-pv3" vg_name $vg
+vgck $vg
+
+aux lvmconf 'devices/filter = [ "a|.*|" ]'
+rm -rf "$DM_DEV_DIR/disk"
+
+vgremove -ff $vg
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='A PV must be found while udev still reports an old filesystem on it'
+
+. lib/test
+
+which mkfs.ext2 || skip
+which udevadm || skip
+
+aux prepare_devs 2
+aux lvmconf 'devices/obtain_device_info_from_udev = 1'
+
+mkfs.ext2 "$dev1"
+aux udev_wait
+udevadm info --query=property --name="$dev1" | grep "^ID_FS_TYPE=ext2" || skip
+
+# Hold back udev's events so its database keeps the filesystem
+udevadm control --stop-exec-queue
+pvcreate -y -ff "$dev1" && vgcreate $vg "$dev1" "$dev2" && \
+	udevadm info --query=property --name="$dev1" > props && \
+	pvs -o pv_name,vg_name --noheadings > stale || true
+udevadm control --start-exec-queue
+aux udev_wait
+
+grep "^ID_FS_TYPE=ext2" props
+grep "$dev1 *$vg" stale
+
+check pv_field "$dev1" vg_name $vg
+vgremove -ff $vg
@@ -0,0 +1,37 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Classifying devices from udev must not lose any PVs'
+
+. lib/test
+
+aux prepare_devs 3
+
+pvcreate "$dev1" "$dev2"
+vgcreate $vg "$dev1" "$dev2"
+lvcreate -l1 -n $lv1 $vg
+
+aux lvmconf 'devices/obtain_device_info_from_udev = 0'
+pvs -o pv_name,vg_name,pv_uuid --noheadings > read
+vgs -o vg_name,vg_uuid,pv_count,lv_count --noheadings >> read
+
+aux lvmconf 'devices/obtain_device_info_from_udev = 1'
+pvs -o pv_name,vg_name,pv_uuid --noheadings > udev
+vgs -o vg_name,vg_uuid,pv_count,lv_count --noheadings >> udev
+
+diff -u read udev
+
+# A PV created while the option is set must be found straight away
+pvcreate "$dev3"
+vgextend $vg "$dev3"
+check pv_field "$dev3" vg_name $vg
+
+vgremove -ff $vg
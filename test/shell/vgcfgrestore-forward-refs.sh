@@ -0,0 +1,56 @@
+#!/bin/sh
+# Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+test_description='Metadata whose LVs refer to LVs listed after them must survive backup and restore'
+
+. lib/test
+
+aux target_at_least dm-raid 1 1 0 || skip
+aux have_thin 1 0 0 || skip
+
+aux prepare_vg 5
+
+# The top-level LVs name sub-LVs that are created (and listed) later
+lvcreate -aey --type mirror -l2 -m1 --nosync -n mirror $vg "$dev1" "$dev2" "$dev3"
+lvcreate --type raid1 -m1 -l2 -n raid $vg "$dev1" "$dev2"
+lvcreate -l2 -n origin $vg "$dev3"
+lvcreate -s -l1 -n snap $vg/origin
+lvcreate -T -l4 $vg/pool "$dev4"
+lvcreate -V4m -T $vg/pool -n thin
+lvcreate -l1 -n last $vg "$dev5"
+vgchange -an $vg
+
+lvs -a -o lv_name,lv_attr,segtype,devices,pool_lv,origin --noheadings $vg > lvs1
+vgcfgbackup -f backup1 $vg
+vgcfgrestore -f backup1 $vg
+vgck $vg
+lvs -a -o lv_name,lv_attr,segtype,devices,pool_lv,origin --noheadings $vg > lvs2
+vgcfgbackup -f backup2 $vg
+
+diff -u lvs1 lvs2
+sed -e '/^description/d' -e '/^creation_/d' -e '/seqno/d' -e '/^#/d' backup1 > b1
+sed -e '/^description/d' -e '/^creation_/d' -e '/seqno/d' -e '/^#/d' backup2 > b2
+diff -u b1 b2
+
+# A partial VG is read with the same LVs, and backed up and restored
+aux disable_dev "$dev5"
+lvs -a -o lv_name,segtype --noheadings -P $vg > partial
+test $(wc -l < partial) -eq $(wc -l < lvs1)
+vgcfgbackup -f backup3 $vg
+grep MISSING backup3
+aux enable_dev "$dev5"
+sed 's/flags = \[\"MISSING\"\]/flags = \[\]/' backup3 > backup4
+vgcfgrestore -f backup4 $vg
+vgck $vg
+lvs -a -o lv_name,lv_attr,segtype,devices,pool_lv,origin --noheadings $vg > lvs3
+diff -u lvs1 lvs3
+
+vgremove -ff $vg
@@ -148,9 +148,60 @@ static void test_cascade(void)
 	dm_config_destroy(t2);
 }
 
+static int _drop_pv1(const struct dm_config_node *cn, void *baton)
+{
+	int *sections = baton;
+
+	(*sections)++;
+
+	if (!strcmp(cn->key, "pv1")) {
+		/* Parent and earlier siblings are already linked */
+		CU_ASSERT(cn->parent && !strcmp(cn->parent->key, "physical_volumes"));
+		CU_ASSERT(cn->parent->child && !strcmp(cn->parent->child->key, "pv0"));
+		return DM_CONFIG_SECTION_DROP;
+	}
+
+	return DM_CONFIG_SECTION_KEEP;
+}
+
+static void test_parse_sections(void)
+{
+	static const char sections[] =
+		"physical_volumes {\n"
+		"    pv0 {\n"
+		"        id = \"abcd-efgh\"\n"
+		"    }\n"
+		"    pv1 {\n"
+		"        id = \"bbcd-efgh\"\n"
+		"        dropped_key = 1\n"
+		"    }\n"
+		"    pv2 {\n"
+		"        id = \"cbcd-efgh\"\n"
+		"        dropped_key = 2\n"
+		"    }\n"
+		"}\n";
+	struct dm_config_tree *tree = dm_config_create();
+	char *buf = dm_pool_strdup(dm_config_memory(tree), sections);
+	int count = 0;
+
+	CU_ASSERT(dm_config_parse_sections(tree, buf, buf + strlen(buf),
+					   _drop_pv1, &count));
+	CU_ASSERT(count == 4);
+
+	CU_ASSERT(dm_config_has_node(tree->root, "physical_volumes/pv0/id"));
+	CU_ASSERT(!dm_config_has_node(tree->root, "physical_volumes/pv1"));
+	CU_ASSERT(!strcmp(dm_config_find_str(tree->root, "physical_volumes/pv2/id", "foo"), "cbcd-efgh"));
+
+	/* The key first seen in the dropped section must still be valid */
+	CU_ASSERT(dm_config_find_int(tree->root, "physical_volumes/pv2/dropped_key", 0) == 2);
+
+	dm_config_destroy(tree);
+}
+
 CU_TestInfo config_list[] = {
 	{ (char*)"parse", test_parse },
 	{ (char*)"clone", test_clone },
 	{ (char*)"cascade", test_cascade },
+	{ (char*)"parse_sections", test_parse_sections },
 	CU_TEST_INFO_NULL
 };
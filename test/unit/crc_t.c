@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "libdevmapper.h"
+#include "crc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+
+int crc_init(void);
+int crc_fini(void);
+
+#define BUF_SIZE 4096
+
+static uint8_t *buf = NULL;
+
+int crc_init(void)
+{
+	unsigned i;
+
+	if (!(buf = malloc(BUF_SIZE)))
+		return 1;
+
+	srand(1);
+	for (i = 0; i < BUF_SIZE; i++)
+		buf[i] = (uint8_t) rand();
+
+	return 0;
+}
+
+int crc_fini(void)
+{
+	free(buf);
+
+	return 0;
+}
+
+/* One bit at a time, straight from the polynomial */
+static uint32_t _crc_bitwise(uint32_t crc, const uint8_t *p, uint32_t size)
+{
+	int i;
+
+	while (size--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+	}
+
+	return crc;
+}
+
+static void _check(crc_fn_t fn)
+{
+	uint32_t offset, size;
+
+	/* Every alignment, short lengths and the block boundaries */
+	for (offset = 0; offset < 16; offset++)
+		for (size = 0; size < 300; size++)
+			CU_ASSERT_EQUAL(fn(INITIAL_CRC, buf + offset, size),
+					_crc_bitwise(INITIAL_CRC, buf + offset, size));
+
+	CU_ASSERT_EQUAL(fn(INITIAL_CRC, buf, BUF_SIZE),
+			_crc_bitwise(INITIAL_CRC, buf, BUF_SIZE));
+	CU_ASSERT_EQUAL(fn(0, buf + 3, BUF_SIZE - 3),
+			_crc_bitwise(0, buf + 3, BUF_SIZE - 3));
+
+	/* Chained calls, as done for wrapped metadata */
+	CU_ASSERT_EQUAL(fn(fn(INITIAL_CRC, buf, 1000), buf + 1000, BUF_SIZE - 1000),
+			_crc_bitwise(INITIAL_CRC, buf, BUF_SIZE));
+}
+
+static void test_known_value(void)
+{
+	const char check[] = "123456789";
+
+	/* The standard CRC-32 check value, with its pre/post inversion */
+	CU_ASSERT_EQUAL(~calc_crc(~0U, (const uint8_t *) check, 9), 0xcbf43926);
+	CU_ASSERT_EQUAL(calc_crc(INITIAL_CRC, (const uint8_t *) check, 0), INITIAL_CRC);
+}
+
+static void test_sliced(void)
+{
+	_check(calc_crc_sliced);
+}
+
+static void test_accelerated(void)
+{
+	crc_fn_t fn;
+
+	if ((fn = calc_crc_accelerated(NULL)))
+		_check(fn);
+}
+
+static void test_calc_crc(void)
+{
+	_check(calc_crc);
+}
+
+CU_TestInfo crc_list[] = {
+	{ (char*)"known_value", test_known_value },
+	{ (char*)"sliced", test_sliced },
+	{ (char*)"accelerated", test_accelerated },
+	{ (char*)"calc_crc", test_calc_crc },
+	CU_TEST_INFO_NULL
+};
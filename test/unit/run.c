@@ -11,12 +11,14 @@ DECL(bitset);
 DECL(regex);
 DECL(config);
 DECL(string);
+DECL(crc);
 
 CU_SuiteInfo suites[] = {
 	USE(bitset),
 	USE(regex),
 	USE(config),
 	USE(string),
+	USE(crc),
 	CU_SUITE_INFO_NULL
 };
 
@@ -708,7 +708,7 @@ static int _swap_lv_identifiers(struct cmd_context *cmd,
 	b->lvid = lvid;
 
 	name = a->name;
-	a->name = b->name;
+	lv_set_name(a, b->name);
 	if (!lv_rename_update(cmd, b, name, 0))
 		return_0;
 
@@ -1173,10 +1173,25 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 		goto_out;
 	}
 
+	/*
+	 * Devices are only kept open for the duration of a command: other
+	 * processes linking the library (clvmd, liblvm2app) would otherwise
+	 * hold them open indefinitely.
+	 */
+	init_dev_keep_open(find_config_tree_bool(cmd, devices_keep_devices_open_CFG, NULL));
+
 	ret = cmd->command->fn(cmd, argc, argv);
 
 	fin_locking();
 
+	archive_expire(cmd);
+
+	init_dev_keep_open(0);
+	dev_close_all();
+
+	if (cmd->filter && cmd->filter->report)
+		cmd->filter->report(cmd->filter);
+
       out:
 	if (test_mode()) {
 		log_verbose("Test mode: Wiping internal cache");
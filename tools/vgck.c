@@ -23,6 +23,9 @@ static int vgck_single(struct cmd_context *cmd __attribute__((unused)),
 	if (!vg_check_status(vg, EXPORTED_VG))
 		return_ECMD_FAILED;
 
+	/* Check everything, not only what changed since the last validation */
+	vg->validated = 0;
+
 	if (!vg_validate(vg))
 		return_ECMD_FAILED;
 
@@ -141,6 +141,10 @@ static int _vgmerge_single(struct cmd_context *cmd, const char *vg_name_to,
 		dm_list_move(&vg_to->lvs, lvh);
 	}
 
+	/* LVs were moved and may have new lvids */
+	vg_index_destroy(vg_from);
+	vg_index_destroy(vg_to);
+
 	while (!dm_list_empty(&vg_from->fid->metadata_areas_in_use)) {
 		struct dm_list *mdah = vg_from->fid->metadata_areas_in_use.n;
 
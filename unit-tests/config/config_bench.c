@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Times dm_config_parse() against dm_config_parse_in_place() on VG
+ * metadata, either read from a file (e.g. vgcfgbackup output) or
+ * generated with the given number of LVs:
+ *
+ *   ./config_bench -f /etc/lvm/backup/vg00 [iterations]
+ *   ./config_bench -n 5000 [iterations]
+ */
+
+#include "libdevmapper.h"
+
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define BENCH_PVS 4
+
+struct buffer {
+	char *mem;
+	size_t used, size;
+};
+
+static int _append(struct buffer *b, const char *fmt, ...)
+	__attribute__ ((format(printf, 2, 3)));
+
+static int _append(struct buffer *b, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	while (1) {
+		va_start(ap, fmt);
+		n = vsnprintf(b->mem + b->used, b->size - b->used, fmt, ap);
+		va_end(ap);
+
+		if (n < 0)
+			return 0;
+
+		if ((size_t) n < b->size - b->used) {
+			b->used += n;
+			return 1;
+		}
+
+		b->size = b->size ? b->size * 2 : 65536;
+		if (!(b->mem = realloc(b->mem, b->size)))
+			return 0;
+	}
+}
+
+static const char *_uuid(unsigned n)
+{
+	static char uuid[40];
+
+	snprintf(uuid, sizeof(uuid), "AbCdEf-%04u-gHiJ-kLmN-oPqR-sTuV-%06u",
+		 n % 10000, n);
+
+	return uuid;
+}
+
+/* Metadata laid out the way format_text/export.c writes it */
+static int _generate(struct buffer *b, unsigned lvs)
+{
+	unsigned i;
+
+	if (!_append(b, "vg {\n\tid = \"%s\"\n\tseqno = %u\n"
+		     "\tformat = \"lvm2\" # informational\n"
+		     "\tstatus = [\"RESIZEABLE\", \"READ\", \"WRITE\"]\n"
+		     "\tflags = []\n\textent_size = 8192\n\tmax_lv = 0\n"
+		     "\tmax_pv = 0\n\tmetadata_copies = 0\n\n"
+		     "\tphysical_volumes {\n", _uuid(0), lvs))
+		return 0;
+
+	for (i = 0; i < BENCH_PVS; i++)
+		if (!_append(b, "\n\t\tpv%u {\n\t\t\tid = \"%s\"\n"
+			     "\t\t\tdevice = \"/dev/sd%c\"\t# Hint only\n\n"
+			     "\t\t\tstatus = [\"ALLOCATABLE\"]\n\t\t\tflags = []\n"
+			     "\t\t\tdev_size = 2147483648\n\t\t\tpe_start = 2048\n"
+			     "\t\t\tpe_count = 262143\t# 1023.99 Gigabytes\n\t\t}\n",
+			     i, _uuid(i + 1), 'a' + i))
+			return 0;
+
+	if (!_append(b, "\t}\n\n\tlogical_volumes {\n"))
+		return 0;
+
+	for (i = 0; i < lvs; i++)
+		if (!_append(b, "\n\t\tlvol%u {\n\t\t\tid = \"%s\"\n"
+			     "\t\t\tstatus = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+			     "\t\t\tflags = []\n"
+			     "\t\t\tcreation_host = \"host.example.com\"\n"
+			     "\t\t\tcreation_time = %u\t# 2013-09-01 12:00:00 +0000\n"
+			     "\t\t\tsegment_count = 1\n\n"
+			     "\t\t\tsegment1 {\n\t\t\t\tstart_extent = 0\n"
+			     "\t\t\t\textent_count = 25\t# 100 Megabytes\n\n"
+			     "\t\t\t\ttype = \"striped\"\n"
+			     "\t\t\t\tstripe_count = 1\t# linear\n\n"
+			     "\t\t\t\tstripes = [\n\t\t\t\t\t\"pv%u\", %u\n"
+			     "\t\t\t\t]\n\t\t\t}\n\t\t}\n",
+			     i, _uuid(i + 100), 1378036800 + i,
+			     i % BENCH_PVS, (i / BENCH_PVS) * 25))
+			return 0;
+
+	return _append(b, "\t}\n}\n");
+}
+
+static int _read_file(struct buffer *b, const char *file)
+{
+	struct stat info;
+	FILE *fp;
+
+	if (stat(file, &info) || !(fp = fopen(file, "r"))) {
+		perror(file);
+		return 0;
+	}
+
+	b->size = info.st_size + 1;
+	if (!(b->mem = malloc(b->size)) ||
+	    fread(b->mem, 1, info.st_size, fp) != (size_t) info.st_size) {
+		fprintf(stderr, "Failed to read %s\n", file);
+		fclose(fp);
+		return 0;
+	}
+
+	b->used = info.st_size;
+	b->mem[b->used] = '\0';
+	fclose(fp);
+
+	return 1;
+}
+
+static int _same_values(const struct dm_config_value *a,
+			const struct dm_config_value *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (a->type != b->type)
+			return 0;
+		if (a->type == DM_CFG_STRING && strcmp(a->v.str, b->v.str))
+			return 0;
+		if (a->type == DM_CFG_INT && a->v.i != b->v.i)
+			return 0;
+	}
+
+	return !a && !b;
+}
+
+static int _same_nodes(const struct dm_config_node *a,
+		       const struct dm_config_node *b)
+{
+	for (; a && b; a = a->sib, b = b->sib)
+		if (strcmp(a->key, b->key) || !_same_values(a->v, b->v) ||
+		    !_same_nodes(a->child, b->child))
+			return 0;
+
+	return !a && !b;
+}
+
+static struct dm_config_tree *_parse(const struct buffer *b, int in_place)
+{
+	struct dm_config_tree *cft;
+	char *copy;
+
+	if (!(cft = dm_config_create()))
+		return NULL;
+
+	if (in_place) {
+		if (!(copy = dm_pool_alloc(dm_config_memory(cft), b->used)))
+			goto bad;
+		memcpy(copy, b->mem, b->used);
+		if (!dm_config_parse_in_place(cft, copy, copy + b->used))
+			goto bad;
+	} else if (!dm_config_parse(cft, b->mem, b->mem + b->used))
+		goto bad;
+
+	return cft;
+
+bad:
+	dm_config_destroy(cft);
+
+	return NULL;
+}
+
+/* Bytes of heap in use, or 0 where that cannot be measured */
+static size_t _heap_used(void)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 mi = mallinfo2();
+
+	return mi.uordblks + mi.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static double _run(const struct buffer *b, int in_place, unsigned iterations)
+{
+	struct dm_config_tree *cft;
+	double start = _now();
+	unsigned i;
+
+	for (i = 0; i < iterations; i++) {
+		if (!(cft = _parse(b, in_place))) {
+			fprintf(stderr, "Parse failed\n");
+			exit(3);
+		}
+		dm_config_destroy(cft);
+	}
+
+	return _now() - start;
+}
+
+int main(int argc, char **argv)
+{
+	struct buffer b = { 0 };
+	struct dm_config_tree *copied, *in_place;
+	unsigned iterations = 20;
+	double copied_secs, in_place_secs;
+	size_t heap, copied_heap, in_place_heap;
+	int ret = 1;
+
+	if (argc < 3 || (strcmp(argv[1], "-f") && strcmp(argv[1], "-n"))) {
+		fprintf(stderr, "Usage : %s -f <metadata_file> | -n <lvs> "
+			"[iterations]\n", argv[0]);
+		exit(1);
+	}
+
+	if (argc > 3)
+		iterations = (unsigned) atoi(argv[3]);
+
+	if (!strcmp(argv[1], "-f") ? !_read_file(&b, argv[2]) :
+	    !_generate(&b, (unsigned) atoi(argv[2]))) {
+		fprintf(stderr, "Couldn't prepare metadata\n");
+		exit(2);
+	}
+
+	/*
+	 * The copying parse leaves the text with the caller; the in-place
+	 * tree includes it.  Count it in both so the figures compare the
+	 * peak while a VG is read.
+	 */
+	heap = _heap_used();
+	if (!(copied = _parse(&b, 0)))
+		goto out;
+	copied_heap = _heap_used() - heap + b.used;
+
+	heap = _heap_used();
+	if (!(in_place = _parse(&b, 1)))
+		goto out;
+	in_place_heap = _heap_used() - heap;
+
+	if (!_same_nodes(copied->root, in_place->root)) {
+		fprintf(stderr, "Parsed trees differ\n");
+		goto out;
+	}
+
+	dm_config_destroy(copied);
+	dm_config_destroy(in_place);
+
+	copied_secs = _run(&b, 0, iterations);
+	in_place_secs = _run(&b, 1, iterations);
+
+	printf("%zu bytes of metadata, %u iterations\n", b.used, iterations);
+	printf("copying:  %8.3f s %8.2f ms/parse %8zu KiB\n",
+	       copied_secs, copied_secs * 1000 / iterations, copied_heap >> 10);
+	printf("in place: %8.3f s %8.2f ms/parse %8zu KiB\n",
+	       in_place_secs, in_place_secs * 1000 / iterations, in_place_heap >> 10);
+
+	ret = 0;
+out:
+	free(b.mem);
+
+	return ret;
+}
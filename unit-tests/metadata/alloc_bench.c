@@ -0,0 +1,526 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Runs the extent allocator against synthetic in-memory VGs with no
+ * devices behind them and reports, for each segment type and allocation
+ * policy, how long the allocation took, how many segments and PVs the
+ * new LV ended up with and a hash of its layout:
+ *
+ *   ./alloc_bench [-p pvs] [-e extents_per_pv] [-l lvs] [-u used_percent]
+ *                 [-f max_hole] [-t tags] [-x extents] [-s seed] [-n]
+ *
+ * Existing LVs fill used_percent of every PV, leaving the free space in
+ * holes of up to max_hole extents, or at the end of each PV with -f 0.
+ * PVs get one of -t tags, which the cling_by_tags runs list in
+ * allocation/cling_tag_list.
+ *
+ * Each LV is allocated in two halves so cling and contiguous have an
+ * existing segment to follow.  Every run starts from a freshly built VG,
+ * so the output only depends on the options and the allocator; -n leaves
+ * out the timings to make the output suitable for diffing between builds
+ * (see check_layouts).  Segment types this build lacks are reported as
+ * unavailable.
+ *
+ * Exits non-zero if a policy fails an allocation that a stricter policy
+ * managed, as each policy tries the stricter ones first.  Internal errors
+ * abort.
+ * RAID timings include the VG write RAID creation does, with the metadata
+ * discarded.
+ */
+
+#include "lib.h"
+#include "toolcontext.h"
+#include "metadata.h"
+#include "segtype.h"
+#include "activate.h"
+#include "locking.h"
+#include "pv_alloc.h"
+#include "lv_alloc.h"
+#include "str_list.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+
+struct bench_params {
+	unsigned pv_count;
+	uint32_t pv_extents;
+	unsigned lv_count;
+	unsigned used_percent;
+	uint32_t max_hole;
+	unsigned tag_count;
+	uint32_t extents;
+	unsigned seed;
+	int timings;
+	char *cling_tag_config;
+};
+
+struct bench_type {
+	const char *name;
+	const char *segtype;
+	uint32_t stripes;
+	uint32_t mirrors;
+	int extendable;
+};
+
+struct bench_policy {
+	const char *name;
+	alloc_policy_t alloc;
+	int cling_tags;		/* Set allocation/cling_tag_list */
+};
+
+struct bench_result {
+	unsigned segments;
+	unsigned pvs;
+	uint32_t layout;
+};
+
+static const struct bench_type _types[] = {
+	{ "linear", "striped", 1, 1, 1 },
+	{ "striped", "striped", 4, 1, 1 },
+	{ "mirror", "mirror", 1, 2, 1 },
+	{ "raid1", "raid1", 1, 2, 1 },
+	{ "raid5", "raid5", 3, 1, 1 },
+	{ "thin-pool", "thin-pool", 1, 1, 0 },
+};
+
+static const struct bench_policy _policies[] = {
+	{ "contiguous", ALLOC_CONTIGUOUS, 0 },
+	{ "cling", ALLOC_CLING, 0 },
+	{ "cling_by_tags", ALLOC_CLING, 1 },
+	{ "normal", ALLOC_NORMAL, 0 },
+	{ "anywhere", ALLOC_ANYWHERE, 0 },
+};
+
+/*
+ * RAID creation writes and commits the VG before clearing its metadata
+ * LVs, so give the VG a metadata area that accepts and discards writes.
+ */
+static int _discard_vg_write(struct format_instance *fid __attribute__((unused)),
+			     struct volume_group *vg __attribute__((unused)),
+			     struct metadata_area *mda __attribute__((unused)))
+{
+	return 1;
+}
+
+static struct metadata_area_ops _discard_mda_ops = {
+	.vg_write = _discard_vg_write,
+};
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static unsigned _random(unsigned *state)
+{
+	*state = *state * 1103515245 + 12345;
+
+	return (*state >> 16) & 0x7fff;
+}
+
+static uint32_t _hash(uint32_t h, uint32_t v)
+{
+	return (h ^ v) * 16777619u;
+}
+
+static int _add_pvs(struct volume_group *vg, const struct bench_params *bp,
+		    struct device *devs)
+{
+	struct physical_volume *pv;
+	struct pv_list *pvl;
+	char name[32];
+	unsigned i;
+
+	memset(devs, 0, bp->pv_count * sizeof(*devs));
+
+	for (i = 0; i < bp->pv_count; i++) {
+		dm_list_init(&devs[i].aliases);
+		if (dm_snprintf(name, sizeof(name), "/dev/bench%u", i) < 0 ||
+		    !str_list_add(vg->vgmem, &devs[i].aliases,
+				  dm_pool_strdup(vg->vgmem, name)))
+			return_0;
+
+		if (!(pvl = dm_pool_zalloc(vg->vgmem, sizeof(*pvl))) ||
+		    !(pv = dm_pool_zalloc(vg->vgmem, sizeof(*pv))) ||
+		    !id_create(&pv->id))
+			return_0;
+
+		dm_list_init(&pv->tags);
+		dm_list_init(&pv->segments);
+		pv->dev = &devs[i];
+		pv->fmt = vg->fid->fmt;
+		pv->vg_name = vg->name;
+		pv->status = ALLOCATABLE_PV;
+		pv->pe_size = vg->extent_size;
+		pv->pe_start = 2048;
+		pv->pe_count = bp->pv_extents;
+
+		if (bp->tag_count) {
+			if (dm_snprintf(name, sizeof(name), "bench%u", i % bp->tag_count) < 0 ||
+			    !str_list_add(vg->vgmem, &pv->tags,
+					  dm_pool_strdup(vg->vgmem, name)))
+				return_0;
+		}
+
+		if (!alloc_pv_segment_whole_pv(vg->vgmem, pv))
+			return_0;
+
+		pvl->pv = pv;
+		add_pvl_to_vgs(vg, pvl);
+		vg->extent_count += pv->pe_count;
+		vg->free_count += pv->pe_count;
+	}
+
+	return 1;
+}
+
+/*
+ * Hand out used runs on each PV to the existing LVs in turn.  Segments
+ * are added directly rather than through the allocator, which would
+ * make building large VGs as slow as what is being measured.
+ */
+static int _add_used_space(struct volume_group *vg, const struct bench_params *bp)
+{
+	const struct segment_type *striped;
+	struct logical_volume **lvs;
+	struct lv_segment *seg;
+	struct pv_list *pvl;
+	char name[32];
+	unsigned i, next_lv = 0, state = bp->seed;
+	uint32_t pe, used, hole;
+
+	if (!bp->lv_count || !bp->used_percent)
+		return 1;
+
+	if (!(striped = get_segtype_from_string(vg->cmd, "striped")) ||
+	    !(lvs = dm_pool_alloc(vg->vgmem, bp->lv_count * sizeof(*lvs))))
+		return_0;
+
+	for (i = 0; i < bp->lv_count; i++)
+		if (dm_snprintf(name, sizeof(name), "fill%u", i) < 0 ||
+		    !(lvs[i] = lv_create_empty(name, NULL, LVM_READ | LVM_WRITE | VISIBLE_LV,
+					       ALLOC_INHERIT, vg)))
+			return_0;
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		for (pe = 0; pe < bp->pv_extents; pe += used + hole) {
+			if (bp->max_hole) {
+				hole = 1 + _random(&state) % bp->max_hole;
+				used = hole * bp->used_percent / (100 - bp->used_percent);
+				if (!used)
+					used = 1;
+			} else {
+				used = bp->pv_extents * bp->used_percent / 100;
+				hole = bp->pv_extents - used;
+				if (!used)
+					break;
+			}
+
+			if (used > bp->pv_extents - pe)
+				used = bp->pv_extents - pe;
+
+			i = next_lv++ % bp->lv_count;
+			if (!(seg = alloc_lv_segment(striped, lvs[i], lvs[i]->le_count,
+						     used, 0, 0, NULL, NULL, 1, used,
+						     0, 0, 0, NULL)) ||
+			    !set_lv_segment_area_pv(seg, 0, pvl->pv, pe))
+				return_0;
+
+			dm_list_add(&lvs[i]->segments, &seg->list);
+			lvs[i]->le_count += used;
+			lvs[i]->size += (uint64_t) used * vg->extent_size;
+		}
+
+	return 1;
+}
+
+static struct volume_group *_build_vg(struct cmd_context *cmd,
+				      const struct bench_params *bp,
+				      struct device *devs)
+{
+	struct format_instance_ctx fic = {
+		.type = FMT_INSTANCE_MDAS | FMT_INSTANCE_AUX_MDAS,
+		.context.vg_ref.vg_name = "alloc_bench",
+	};
+	struct format_instance *fid;
+	struct metadata_area *mda;
+	struct volume_group *vg;
+
+	if (!(vg = alloc_vg("alloc_bench", cmd, "alloc_bench")))
+		return_NULL;
+
+	if (!id_create(&vg->id) ||
+	    !(vg->system_id = dm_pool_zalloc(vg->vgmem, NAME_LEN + 1)) ||
+	    !(fid = cmd->fmt->ops->create_instance(cmd->fmt, &fic)) ||
+	    !(mda = dm_pool_zalloc(fid->mem, sizeof(*mda))))
+		goto_bad;
+
+	vg_set_fid(vg, fid);
+	mda->ops = &_discard_mda_ops;
+	if (!fid_add_mda(fid, mda, NULL, 0, 0))
+		goto_bad;
+	vg->status = RESIZEABLE_VG | LVM_READ | LVM_WRITE;
+	vg->extent_size = 8192;
+	vg->alloc = ALLOC_NORMAL;
+
+	if (!_add_pvs(vg, bp, devs) || !_add_used_space(vg, bp))
+		goto_bad;
+
+	return vg;
+bad:
+	release_vg(vg);
+
+	return NULL;
+}
+
+static void _add_layout(const struct logical_volume *lv, const struct device *devs,
+			unsigned char *touched, struct bench_result *res)
+{
+	const struct lv_segment *seg;
+	uint32_t s;
+
+	dm_list_iterate_items(seg, &lv->segments) {
+		res->segments++;
+		res->layout = _hash(_hash(res->layout, seg->le), seg->len);
+
+		for (s = 0; s < seg->area_count; s++) {
+			if (seg_type(seg, s) == AREA_PV) {
+				touched[seg_dev(seg, s) - devs] = 1;
+				res->layout = _hash(_hash(res->layout,
+							  seg_dev(seg, s) - devs),
+						    seg_pe(seg, s));
+			} else if (seg_type(seg, s) == AREA_LV)
+				_add_layout(seg_lv(seg, s), devs, touched, res);
+
+			if (seg->meta_areas && seg_metatype(seg, s) == AREA_LV)
+				_add_layout(seg_metalv(seg, s), devs, touched, res);
+		}
+
+		if (seg->log_lv)
+			_add_layout(seg->log_lv, devs, touched, res);
+		if (seg->metadata_lv)
+			_add_layout(seg->metadata_lv, devs, touched, res);
+	}
+}
+
+/* Returns 0 if the allocation failed */
+static int _run(struct cmd_context *cmd, const struct bench_params *bp,
+		const struct bench_type *type, const struct segment_type *segtype,
+		const struct bench_policy *policy, struct device *devs,
+		unsigned char *touched, double *secs, struct bench_result *res)
+{
+	struct dm_config_tree *old_cft;
+	struct volume_group *vg;
+	struct logical_volume *lv;
+	/* Striped allocations need a multiple of the stripe count */
+	uint32_t extents = bp->extents - bp->extents % type->stripes;
+	uint32_t first = type->extendable ?
+		extents / 2 - (extents / 2) % type->stripes : extents;
+	uint32_t stripe_size = (type->stripes > 1) ? 128 : 0;
+	uint32_t region_size;
+	double start;
+	unsigned i;
+	int r = 0;
+
+	if (!lock_vol(cmd, "alloc_bench", LCK_VG_WRITE, NULL) ||
+	    !(vg = _build_vg(cmd, bp, devs))) {
+		fprintf(stderr, "Couldn't build VG\n");
+		exit(3);
+	}
+
+	if (policy->cling_tags &&
+	    !override_config_tree_from_string(cmd, bp->cling_tag_config)) {
+		fprintf(stderr, "Couldn't set cling_tag_list\n");
+		exit(3);
+	}
+
+	region_size = (segtype_is_mirrored(segtype) || segtype_is_raid(segtype)) ?
+		1024 : 0;
+
+	if (!first ||
+	    !(lv = lv_create_empty("lvol0", NULL, LVM_READ | LVM_WRITE | VISIBLE_LV,
+				   ALLOC_INHERIT, vg)))
+		goto_out;
+
+	start = _now();
+	if (!lv_extend(lv, segtype, type->stripes, stripe_size, type->mirrors,
+		       region_size, first, NULL, &vg->pvs, policy->alloc) ||
+	    ((extents > first) &&
+	     !lv_extend(lv, segtype, type->stripes, stripe_size, type->mirrors,
+			region_size, extents - first, NULL, &vg->pvs, policy->alloc)))
+		goto out;
+	*secs = _now() - start;
+
+	memset(res, 0, sizeof(*res));
+	memset(touched, 0, bp->pv_count);
+	res->layout = 2166136261u;
+	_add_layout(lv, devs, touched, res);
+	for (i = 0; i < bp->pv_count; i++)
+		res->pvs += touched[i];
+
+	r = 1;
+out:
+	if (policy->cling_tags &&
+	    (old_cft = remove_config_tree_by_source(cmd, CONFIG_STRING)))
+		dm_config_destroy(old_cft);
+	release_vg(vg);
+	unlock_vg(cmd, "alloc_bench");
+
+	return r;
+}
+
+static char *_cling_tag_config(unsigned tag_count)
+{
+	char *config, *p;
+	unsigned i;
+
+	if (!(config = p = dm_malloc(48 + tag_count * 16)))
+		return_NULL;
+
+	p += sprintf(p, "allocation { cling_tag_list = [");
+	for (i = 0; i < tag_count; i++)
+		p += sprintf(p, "%s\"@bench%u\"", i ? ", " : "", i);
+	sprintf(p, "] }");
+
+	return config;
+}
+
+static void _usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-p pvs] [-e extents_per_pv] [-l lvs] "
+		"[-u used_percent] [-f max_hole] [-t tags] [-x extents] "
+		"[-s seed] [-n]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_params bp = {
+		.pv_count = 32,
+		.pv_extents = 4096,
+		.lv_count = 64,
+		.used_percent = 50,
+		.max_hole = 8,
+		.tag_count = 4,
+		.extents = 1024,
+		.seed = 1,
+		.timings = 1,
+	};
+	struct cmd_context *cmd;
+	const struct segment_type *segtype;
+	alloc_policy_t succeeded;
+	struct bench_result res;
+	struct device *devs;
+	unsigned char *touched;
+	unsigned t, p, failed = 0, unexpected = 0;
+	double secs = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "p:e:l:u:f:t:x:s:n")) != -1)
+		switch (c) {
+		case 'p': bp.pv_count = atoi(optarg); break;
+		case 'e': bp.pv_extents = atoi(optarg); break;
+		case 'l': bp.lv_count = atoi(optarg); break;
+		case 'u': bp.used_percent = atoi(optarg); break;
+		case 'f': bp.max_hole = atoi(optarg); break;
+		case 't': bp.tag_count = atoi(optarg); break;
+		case 'x': bp.extents = atoi(optarg); break;
+		case 's': bp.seed = atoi(optarg); break;
+		case 'n': bp.timings = 0; break;
+		default: _usage(argv[0]);
+		}
+
+	if (optind != argc || !bp.pv_count || !bp.pv_extents ||
+	    bp.used_percent > 95 || !bp.extents)
+		_usage(argv[0]);
+
+	if (!(devs = dm_zalloc(bp.pv_count * sizeof(*devs))) ||
+	    !(touched = dm_zalloc(bp.pv_count)))
+		exit(2);
+
+	if (!(cmd = create_toolcontext(0, NULL, 0, 0)))
+		exit(2);
+
+	/* Nothing is activated or written to disk */
+	set_activation(0);
+	init_test(1);
+	init_abort_on_internal_errors(1);
+
+	if (!init_locking(0, cmd, 1))
+		exit(2);
+
+	if (bp.tag_count && !(bp.cling_tag_config = _cling_tag_config(bp.tag_count)))
+		exit(2);
+
+	printf("%u PVs x %u extents, %u LVs using %u%%, holes up to %u, %u tags,"
+	       " allocating %u extents\n", bp.pv_count, bp.pv_extents,
+	       bp.lv_count, bp.used_percent, bp.max_hole, bp.tag_count,
+	       bp.extents);
+
+	for (t = 0; t < DM_ARRAY_SIZE(_types); t++) {
+		if (!(segtype = get_segtype_from_string(cmd, _types[t].segtype)))
+			exit(2);
+
+		/* Not compiled into this build */
+		if (segtype->flags & SEG_UNKNOWN) {
+			printf("%-9s unavailable\n", _types[t].name);
+			continue;
+		}
+
+		/* Loosest policy that has succeeded so far */
+		succeeded = ALLOC_INVALID;
+
+		for (p = 0; p < DM_ARRAY_SIZE(_policies); p++) {
+			if (_policies[p].cling_tags && !bp.tag_count)
+				continue;
+
+			printf("%-9s %-13s ", _types[t].name, _policies[p].name);
+			fflush(stdout);
+
+			if (!_run(cmd, &bp, &_types[t], segtype, &_policies[p],
+				  devs, touched, &secs, &res)) {
+				failed++;
+				if (succeeded != ALLOC_INVALID &&
+				    succeeded < _policies[p].alloc) {
+					printf("failed unexpectedly\n");
+					unexpected++;
+				} else
+					printf("failed\n");
+				continue;
+			}
+
+			succeeded = _policies[p].alloc;
+
+			if (bp.timings)
+				printf("%10.3f ms ", secs * 1000);
+			printf("%6u segs %5u PVs layout %08x\n",
+			       res.segments, res.pvs, res.layout);
+		}
+	}
+
+	printf("%u allocations failed, %u unexpectedly\n", failed, unexpected);
+
+	fin_locking();
+	destroy_toolcontext(cmd);
+	dm_free(bp.cling_tag_config);
+	dm_free(touched);
+	dm_free(devs);
+
+	return unexpected ? 4 : 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Times the calc_crc() implementations against the single table lookup
+ * one they replaced, on a label sized and a metadata sized buffer:
+ *
+ *   ./crc_bench [megabytes]
+ */
+
+#include "lib.h"
+#include "crc.h"
+
+#include <sys/time.h>
+
+static uint32_t _crctab[256];
+
+static void _init_table(void)
+{
+	uint32_t crc, i, j;
+
+	for (i = 0; i < 256; i++) {
+		for (crc = i, j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+		_crctab[i] = crc;
+	}
+}
+
+/* The previous implementation: one table lookup per byte */
+static uint32_t _calc_crc_bytewise(uint32_t initial, const uint8_t *buf, uint32_t size)
+{
+	uint32_t crc = initial;
+
+	while (size--) {
+		crc = crc ^ *buf++;
+		crc = _crctab[crc & 0xff] ^ crc >> 8;
+	}
+
+	return crc;
+}
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void _run(const char *name, crc_fn_t fn, const uint8_t *buf,
+		 uint32_t size, uint64_t total)
+{
+	uint64_t i, iterations = total / size;
+	uint32_t crc = INITIAL_CRC;
+	double secs, start = _now();
+
+	for (i = 0; i < iterations; i++)
+		crc = fn(crc, buf, size);
+
+	secs = _now() - start;
+	printf("%-9s %8u bytes: %8.1f MB/s  (0x%08x)\n", name, size,
+	       iterations * size / secs / 1000000, crc);
+}
+
+int main(int argc, char **argv)
+{
+	static const uint32_t sizes[] = { 512, 1024 * 1024 };
+	uint64_t total = 256;
+	const char *name = NULL;
+	crc_fn_t accelerated;
+	uint8_t *buf;
+	unsigned i;
+
+	if (argc > 1)
+		total = (uint64_t) atoi(argv[1]);
+	total <<= 20;
+
+	if (!(buf = malloc(sizes[1]))) {
+		fprintf(stderr, "Allocation failed\n");
+		exit(1);
+	}
+
+	srand(1);
+	for (i = 0; i < sizes[1]; i++)
+		buf[i] = (uint8_t) rand();
+
+	_init_table();
+	accelerated = calc_crc_accelerated(&name);
+
+	for (i = 0; i < DM_ARRAY_SIZE(sizes); i++) {
+		if (calc_crc(INITIAL_CRC, buf, sizes[i]) !=
+		    _calc_crc_bytewise(INITIAL_CRC, buf, sizes[i])) {
+			fprintf(stderr, "CRC mismatch\n");
+			exit(2);
+		}
+
+		_run("bytewise", _calc_crc_bytewise, buf, sizes[i], total);
+		_run("sliced", calc_crc_sliced, buf, sizes[i], total);
+		if (accelerated)
+			_run(name, accelerated, buf, sizes[i], total);
+	}
+
+	free(buf);
+
+	return 0;
+}
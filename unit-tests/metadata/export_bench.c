@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Times the raw metadata exporter used for on-disk metadata and lvmcache
+ * against the printf based one it replaced, on a VG read from a metadata
+ * file such as vgcfgbackup output:
+ *
+ *   ./export_bench /etc/lvm/backup/vg00 [iterations]
+ */
+
+#include "lib.h"
+#include "toolcontext.h"
+#include "archiver.h"
+#include "metadata.h"
+#include "import-export.h"
+
+#include <sys/time.h>
+
+typedef size_t (*export_fn_t) (struct volume_group *vg, const char *desc,
+			       char **buf);
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static double _run(struct volume_group *vg, export_fn_t fn, unsigned iterations)
+{
+	double start = _now();
+	char *buf;
+	unsigned i;
+
+	for (i = 0; i < iterations; i++) {
+		if (!fn(vg, "", &buf)) {
+			fprintf(stderr, "Export failed\n");
+			exit(3);
+		}
+		dm_free(buf);
+	}
+
+	return _now() - start;
+}
+
+/* Compare up to the trailing "# Generated by" line, which has the time */
+static int _same_output(struct volume_group *vg)
+{
+	char *fast = NULL, *printf_buf = NULL, *end;
+	size_t fast_size, printf_size;
+	int r = 0;
+
+	if (!(fast_size = text_vg_export_raw(vg, "", &fast)) ||
+	    !(printf_size = text_vg_export_raw_printf(vg, "", &printf_buf)))
+		goto out;
+
+	if (fast_size != printf_size || !(end = strstr(fast, "\n# Generated by")))
+		goto out;
+
+	r = !memcmp(fast, printf_buf, end - fast);
+out:
+	dm_free(fast);
+	dm_free(printf_buf);
+
+	return r;
+}
+
+int main(int argc, char **argv)
+{
+	struct cmd_context *cmd;
+	struct volume_group *vg;
+	unsigned iterations = 100;
+	double fast_secs, printf_secs;
+	char *buf;
+	size_t size;
+	int ret = 1;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage : %s <metadata_file> [iterations]\n", argv[0]);
+		exit(1);
+	}
+
+	if (argc > 2)
+		iterations = (unsigned) atoi(argv[2]);
+
+	if (!(cmd = create_toolcontext(0, NULL, 0, 0)))
+		exit(2);
+
+	if (!(vg = backup_read_vg(cmd, NULL, argv[1]))) {
+		fprintf(stderr, "Couldn't read VG from %s\n", argv[1]);
+		goto out;
+	}
+
+	if (!_same_output(vg)) {
+		fprintf(stderr, "Exported metadata differs\n");
+		goto out_vg;
+	}
+
+	if (!(size = text_vg_export_raw(vg, "", &buf)))
+		goto out_vg;
+	dm_free(buf);
+
+	printf_secs = _run(vg, text_vg_export_raw_printf, iterations);
+	fast_secs = _run(vg, text_vg_export_raw, iterations);
+
+	printf("%zu bytes of metadata, %d LVs, %u iterations\n",
+	       size, dm_list_size(&vg->lvs), iterations);
+	printf("printf: %8.3f s %8.2f ms/export\n",
+	       printf_secs, printf_secs * 1000 / iterations);
+	printf("direct: %8.3f s %8.2f ms/export\n",
+	       fast_secs, fast_secs * 1000 / iterations);
+
+	ret = 0;
+out_vg:
+	release_vg(vg);
+out:
+	destroy_toolcontext(cmd);
+
+	return ret;
+}
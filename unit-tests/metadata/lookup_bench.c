@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Times LV and PV lookups in growing in-memory VGs, looking up every
+ * LV by name and by lvid and every PV by uuid, with the VG indexes and
+ * with the list walks they replaced:
+ *
+ *   ./lookup_bench [lv_count...]
+ */
+
+#include "lib.h"
+#include "toolcontext.h"
+#include "metadata.h"
+
+#include <sys/time.h>
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static struct lv_list *_scan_lv_name(struct volume_group *vg, const char *name)
+{
+	struct lv_list *lvl;
+
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (!strcmp(lvl->lv->name, name))
+			return lvl;
+
+	return NULL;
+}
+
+static struct lv_list *_scan_lvid(struct volume_group *vg, const union lvid *lvid)
+{
+	struct lv_list *lvl;
+
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (!strncmp(lvl->lv->lvid.s, lvid->s, sizeof(*lvid)))
+			return lvl;
+
+	return NULL;
+}
+
+static struct pv_list *_scan_pv_uuid(struct volume_group *vg, const struct id *id)
+{
+	struct pv_list *pvl;
+
+	dm_list_iterate_items(pvl, &vg->pvs)
+		if (id_equal(&pvl->pv->id, id))
+			return pvl;
+
+	return NULL;
+}
+
+static struct volume_group *_build_vg(struct cmd_context *cmd,
+				      unsigned lv_count, unsigned pv_count)
+{
+	struct volume_group *vg;
+	struct logical_volume *lv;
+	struct pv_list *pvl;
+	char name[NAME_LEN];
+	unsigned i;
+
+	if (!(vg = alloc_vg("lookup_bench", cmd, "bench")) ||
+	    !id_create(&vg->id))
+		goto_bad;
+
+	for (i = 0; i < pv_count; i++) {
+		if (!(pvl = dm_pool_zalloc(vg->vgmem, sizeof(*pvl))) ||
+		    !(pvl->pv = dm_pool_zalloc(vg->vgmem, sizeof(*pvl->pv))) ||
+		    !id_create(&pvl->pv->id))
+			goto_bad;
+		dm_list_init(&pvl->pv->tags);
+		dm_list_init(&pvl->pv->segments);
+		add_pvl_to_vgs(vg, pvl);
+	}
+
+	for (i = 0; i < lv_count; i++) {
+		if (dm_snprintf(name, sizeof(name), "lvol%u", i) < 0 ||
+		    !(lv = alloc_lv(vg->vgmem)) ||
+		    !(lv->name = dm_pool_strdup(vg->vgmem, name)) ||
+		    !lvid_create(&lv->lvid, &vg->id) ||
+		    !link_lv_to_vg(vg, lv))
+			goto_bad;
+	}
+
+	return vg;
+bad:
+	release_vg(vg);
+
+	return NULL;
+}
+
+/* Returns 0 if any lookup finds something other than the list walk */
+static int _run(struct volume_group *vg, unsigned lv_count)
+{
+	struct lv_list *lvl;
+	struct pv_list *pvl;
+	double start, name_secs, lvid_secs, pv_secs;
+	double scan_name_secs, scan_lvid_secs, scan_pv_secs;
+
+	start = _now();
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (find_lv_in_vg(vg, lvl->lv->name) != lvl)
+			return 0;
+	name_secs = _now() - start;
+
+	start = _now();
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (find_lv_in_vg_by_lvid(vg, &lvl->lv->lvid) != lvl)
+			return 0;
+	lvid_secs = _now() - start;
+
+	start = _now();
+	dm_list_iterate_items(pvl, &vg->pvs)
+		if (find_pv_in_vg_by_uuid(vg, &pvl->pv->id) != pvl)
+			return 0;
+	pv_secs = _now() - start;
+
+	start = _now();
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (_scan_lv_name(vg, lvl->lv->name) != lvl)
+			return 0;
+	scan_name_secs = _now() - start;
+
+	start = _now();
+	dm_list_iterate_items(lvl, &vg->lvs)
+		if (_scan_lvid(vg, &lvl->lv->lvid) != lvl)
+			return 0;
+	scan_lvid_secs = _now() - start;
+
+	start = _now();
+	dm_list_iterate_items(pvl, &vg->pvs)
+		if (_scan_pv_uuid(vg, &pvl->pv->id) != pvl)
+			return 0;
+	scan_pv_secs = _now() - start;
+
+	if (find_lv_in_vg(vg, "no_such_lv") || _scan_lv_name(vg, "no_such_lv"))
+		return 0;
+
+	printf("%7u LVs %5u PVs | name %8.3f ms %9.3f ms | lvid %8.3f ms %9.3f ms"
+	       " | pv uuid %7.3f ms %8.3f ms\n",
+	       lv_count, vg->pv_count,
+	       name_secs * 1000, scan_name_secs * 1000,
+	       lvid_secs * 1000, scan_lvid_secs * 1000,
+	       pv_secs * 1000, scan_pv_secs * 1000);
+
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	static const unsigned _default_counts[] = { 1000, 4000, 16000 };
+	struct cmd_context *cmd;
+	struct volume_group *vg;
+	unsigned i, lv_count, runs;
+	int ret = 1;
+
+	runs = (argc > 1) ? (unsigned) argc - 1 : DM_ARRAY_SIZE(_default_counts);
+
+	if (!(cmd = create_toolcontext(0, NULL, 0, 0)))
+		exit(2);
+
+	printf("Looking up every LV and PV once: indexed vs list walk\n");
+
+	for (i = 0; i < runs; i++) {
+		lv_count = (argc > 1) ? (unsigned) atoi(argv[i + 1]) :
+			   _default_counts[i];
+
+		if (!(vg = _build_vg(cmd, lv_count, lv_count / 8 + 1))) {
+			fprintf(stderr, "Couldn't build VG with %u LVs\n", lv_count);
+			goto out;
+		}
+
+		if (!_run(vg, lv_count)) {
+			fprintf(stderr, "Lookup mismatch with %u LVs\n", lv_count);
+			release_vg(vg);
+			goto out;
+		}
+
+		release_vg(vg);
+	}
+
+	ret = 0;
+out:
+	destroy_toolcontext(cmd);
+
+	return ret;
+}
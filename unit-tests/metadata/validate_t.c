@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * vg_validate() only re-checks what the mutators marked as changed.
+ * Corrupts an LV segment behind their back in a synthetic VG and checks
+ * that the first validation of a VG, global/full_vg_validation, -vvvv
+ * and vgck still catch it.  Validating only what changed may miss such
+ * a change and nothing here relies on whether it does.
+ */
+
+#include "lib.h"
+#include "toolcontext.h"
+#include "metadata.h"
+#include "segtype.h"
+#include "activate.h"
+#include "locking.h"
+#include "pv_alloc.h"
+#include "str_list.h"
+
+#include <assert.h>
+
+#define PV_COUNT 4
+#define PV_EXTENTS 1024
+
+static struct device _devs[PV_COUNT];
+
+static struct volume_group *_build_vg(struct cmd_context *cmd)
+{
+	struct format_instance_ctx fic = {
+		.type = FMT_INSTANCE_MDAS | FMT_INSTANCE_AUX_MDAS,
+		.context.vg_ref.vg_name = "validate_t",
+	};
+	struct format_instance *fid;
+	struct physical_volume *pv;
+	struct pv_list *pvl;
+	struct volume_group *vg;
+	char name[32];
+	unsigned i;
+
+	assert((vg = alloc_vg("validate_t", cmd, "validate_t")));
+	assert(id_create(&vg->id));
+	assert((vg->system_id = dm_pool_zalloc(vg->vgmem, NAME_LEN + 1)));
+	assert((fid = cmd->fmt->ops->create_instance(cmd->fmt, &fic)));
+	vg_set_fid(vg, fid);
+	vg->status = RESIZEABLE_VG | LVM_READ | LVM_WRITE;
+	vg->extent_size = 8192;
+	vg->alloc = ALLOC_NORMAL;
+
+	for (i = 0; i < PV_COUNT; i++) {
+		dm_list_init(&_devs[i].aliases);
+		assert(dm_snprintf(name, sizeof(name), "/dev/validate%u", i) > 0);
+		assert(str_list_add(vg->vgmem, &_devs[i].aliases,
+				    dm_pool_strdup(vg->vgmem, name)));
+
+		assert((pvl = dm_pool_zalloc(vg->vgmem, sizeof(*pvl))));
+		assert((pv = dm_pool_zalloc(vg->vgmem, sizeof(*pv))));
+		assert(id_create(&pv->id));
+		dm_list_init(&pv->tags);
+		dm_list_init(&pv->segments);
+		pv->dev = &_devs[i];
+		pv->fmt = fid->fmt;
+		pv->vg_name = vg->name;
+		pv->status = ALLOCATABLE_PV;
+		pv->pe_size = vg->extent_size;
+		pv->pe_start = 2048;
+		pv->pe_count = PV_EXTENTS;
+		assert(alloc_pv_segment_whole_pv(vg->vgmem, pv));
+
+		pvl->pv = pv;
+		add_pvl_to_vgs(vg, pvl);
+		vg->extent_count += pv->pe_count;
+		vg->free_count += pv->pe_count;
+	}
+
+	return vg;
+}
+
+static struct logical_volume *_create_lv(struct volume_group *vg,
+					 const char *name, uint32_t extents)
+{
+	const struct segment_type *striped;
+	struct logical_volume *lv;
+
+	assert((striped = get_segtype_from_string(vg->cmd, "striped")));
+	assert((lv = lv_create_empty(name, NULL, LVM_READ | LVM_WRITE | VISIBLE_LV,
+				     ALLOC_INHERIT, vg)));
+	assert(lv_extend(lv, striped, 1, 0, 1, 0, extents, NULL, &vg->pvs,
+			 ALLOC_INHERIT));
+
+	return lv;
+}
+
+int main(void)
+{
+	struct cmd_context *cmd;
+	struct volume_group *vg;
+	struct logical_volume *lv;
+
+	assert((cmd = create_toolcontext(0, NULL, 0, 0)));
+	set_activation(0);
+	init_test(1);
+	/* The corruption is reported as an internal error */
+	init_abort_on_internal_errors(0);
+	assert(init_locking(0, cmd, 1));
+	assert(lock_vol(cmd, "validate_t", LCK_VG_WRITE, NULL));
+
+	vg = _build_vg(cmd);
+	_create_lv(vg, "lvol0", 100);
+	lv = _create_lv(vg, "lvol1", 100);
+	_create_lv(vg, "lvol2", 100);
+
+	/* Nothing has been validated yet, so everything is checked */
+	first_seg(lv)->area_len++;
+	assert(!vg_validate(vg));
+	first_seg(lv)->area_len--;
+	assert(vg_validate(vg));
+
+	/* Changes made through the mutators are checked */
+	_create_lv(vg, "lvol3", 100);
+	assert(vg_validate(vg));
+
+	/* A field no mutator or fingerprint covers */
+	first_seg(lv)->area_len++;
+
+	init_full_vg_validation(1);
+	assert(!vg_validate(vg));
+	init_full_vg_validation(0);
+
+	init_verbose(VERBOSE_BASE_LEVEL + 4);	/* -vvvv */
+	assert(!vg_validate(vg));
+	init_verbose(VERBOSE_BASE_LEVEL);
+
+	/* As vgck does */
+	vg->validated = 0;
+	assert(!vg_validate(vg));
+
+	first_seg(lv)->area_len--;
+	assert(vg_validate(vg));
+
+	release_vg(vg);
+	unlock_vg(cmd, "validate_t");
+	fin_locking();
+	destroy_toolcontext(cmd);
+
+	return 0;
+}
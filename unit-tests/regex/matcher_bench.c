@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Times dm_regex_match() with states built on demand against the
+ * compiled transition table, e.g.:
+ *
+ *   ./matcher_bench dev_patterns devices.list 1000
+ */
+
+#include "libdevmapper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+static int _read_lines(const char *file, struct dm_pool *mem, char ***lines,
+		       unsigned *count, int quoted)
+{
+	char buffer[1024], *ptr, *end;
+	unsigned asize = 64, nr = 0;
+	char **l;
+	FILE *fp;
+
+	if (!(fp = fopen(file, "r"))) {
+		perror(file);
+		return 0;
+	}
+
+	l = dm_malloc(sizeof(*l) * asize);
+
+	while (l && fgets(buffer, sizeof(buffer), fp)) {
+		if ((ptr = strchr(buffer, '\n')))
+			*ptr = '\0';
+
+		ptr = buffer;
+		if (quoted) {
+			/* "<regex>" as in matcher_t pattern files */
+			if (*ptr != '\"' || !(end = strrchr(++ptr, '\"')))
+				continue;
+			*end = '\0';
+		}
+
+		if (nr == asize) {
+			asize *= 2;
+			l = dm_realloc(l, sizeof(*l) * asize);
+		}
+
+		if (l && !(l[nr++] = dm_pool_strdup(mem, ptr)))
+			l = NULL;
+	}
+
+	if (fclose(fp))
+		perror(file);
+
+	if (!l) {
+		fprintf(stderr, "Out of memory reading %s\n", file);
+		return 0;
+	}
+
+	*lines = l;
+	*count = nr;
+
+	return 1;
+}
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static double _run(struct dm_regex *rx, char **input, unsigned count,
+		   unsigned iterations, int *results)
+{
+	double start = _now();
+	unsigned i, j;
+
+	for (i = 0; i < iterations; i++)
+		for (j = 0; j < count; j++)
+			results[j] = dm_regex_match(rx, input[j]);
+
+	return _now() - start;
+}
+
+int main(int argc, char **argv)
+{
+	struct dm_pool *mem;
+	struct dm_regex *lazy, *compiled;
+	char **patterns = NULL, **input = NULL;
+	unsigned npatterns, ninput, iterations = 1000, i;
+	int *lazy_results = NULL, *compiled_results = NULL;
+	double lazy_secs, compiled_secs, matches;
+	int ret = 1;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage : %s <pattern_file> <input_file> [iterations]\n",
+			argv[0]);
+		exit(1);
+	}
+
+	if (argc > 3)
+		iterations = (unsigned) atoi(argv[3]);
+
+	if (!(mem = dm_pool_create("matcher_bench", 10 * 1024))) {
+		fprintf(stderr, "Couldn't create pool\n");
+		exit(2);
+	}
+
+	if (!_read_lines(argv[1], mem, &patterns, &npatterns, 1) ||
+	    !_read_lines(argv[2], mem, &input, &ninput, 0))
+		goto out;
+
+	if (!(lazy = dm_regex_create(mem, (const char * const *) patterns, npatterns)) ||
+	    !(compiled = dm_regex_create(mem, (const char * const *) patterns, npatterns))) {
+		fprintf(stderr, "Couldn't build the matchers\n");
+		goto out;
+	}
+
+	if (!dm_regex_compile(compiled)) {
+		fprintf(stderr, "Couldn't compile the matcher\n");
+		goto out;
+	}
+
+	if (!(lazy_results = dm_malloc(sizeof(int) * ninput)) ||
+	    !(compiled_results = dm_malloc(sizeof(int) * ninput)))
+		goto out;
+
+	lazy_secs = _run(lazy, input, ninput, iterations, lazy_results);
+	compiled_secs = _run(compiled, input, ninput, iterations, compiled_results);
+
+	for (i = 0; i < ninput; i++)
+		if (lazy_results[i] != compiled_results[i]) {
+			fprintf(stderr, "Mismatch on %s: %d != %d\n", input[i],
+				lazy_results[i], compiled_results[i]);
+			goto out;
+		}
+
+	matches = (double) ninput * iterations;
+	printf("%u patterns, %u names, %u iterations\n",
+	       npatterns, ninput, iterations);
+	printf("on demand: %8.3f s %8.1f ns/match\n",
+	       lazy_secs, lazy_secs * 1e9 / matches);
+	printf("compiled:  %8.3f s %8.1f ns/match\n",
+	       compiled_secs, compiled_secs * 1e9 / matches);
+
+	ret = 0;
+out:
+	dm_free(lazy_results);
+	dm_free(compiled_results);
+	dm_free(patterns);
+	dm_free(input);
+	dm_pool_destroy(mem);
+
+	return ret;
+}
@@ -109,18 +109,21 @@ int main(int argc, char **argv)
 	char **regex;
 	int nregex;
 	int ret = 0;
-	int want_finger_print = 0, i;
+	int want_finger_print = 0, want_compile = 0, i;
 	const char *pattern_file = NULL;
 
 	for (i = 1; i < argc; i++)
 		if (!strcmp(argv[i], "--fingerprint"))
 			want_finger_print = 1;
 
+		else if (!strcmp(argv[i], "--compile"))
+			want_compile = 1;
+
 		else
 			pattern_file = argv[i];
 
 	if (!pattern_file) {
-		fprintf(stderr, "Usage : %s [--fingerprint] <pattern_file>\n", argv[0]);
+		fprintf(stderr, "Usage : %s [--fingerprint] [--compile] <pattern_file>\n", argv[0]);
 		exit(1);
 	}
 
@@ -146,6 +149,13 @@ int main(int argc, char **argv)
 
 	if (want_finger_print)
 		printf("fingerprint: %x\n", dm_regex_fingerprint(scanner));
+
+	if (want_compile && !dm_regex_compile(scanner)) {
+		fprintf(stderr, "Couldn't compile the lexer\n");
+		ret = 5;
+		goto err;
+	}
+
 	_scan_input(scanner, regex);
 	_free_regex(regex, nregex);
 